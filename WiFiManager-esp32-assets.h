@@ -0,0 +1,89 @@
+// Generated by extras/parse.js from WiFiManager.template.html; do not edit
+
+#ifndef WiFiManager_assets_h
+#define WiFiManager_assets_h
+
+const char WM_ASSET_STYLE_ETAG[] PROGMEM = "\"38b22bbb94a05cfa\"";
+const uint8_t WM_ASSET_STYLE_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x6d, 0x92, 0x6f, 0x6f, 0xa2, 0x40,
+    0x10, 0xc6, 0xbf, 0x0a, 0xe9, 0xe5, 0x92, 0xbb, 0xa4, 0x2a, 0x2a, 0xda, 0x02, 0xe9, 0x8b, 0x85,
+    0xa2, 0xd5, 0xfa, 0x9f, 0x42, 0x2d, 0xef, 0x16, 0x76, 0x59, 0x56, 0x60, 0x17, 0xd7, 0x55, 0x50,
+    0xe3, 0x77, 0xbf, 0xa0, 0xbd, 0x9c, 0x2f, 0xee, 0xdd, 0x3c, 0x33, 0xf3, 0x4c, 0x7e, 0x93, 0x99,
+    0x66, 0x74, 0x96, 0xb8, 0x92, 0x0d, 0x98, 0x51, 0xc2, 0x0c, 0x25, 0xc2, 0x4c, 0x62, 0x61, 0x5e,
+    0x14, 0x44, 0x0f, 0x8f, 0x94, 0x15, 0x7b, 0x79, 0x2e, 0x20, 0x42, 0x94, 0x11, 0xa3, 0x57, 0x54,
+    0x66, 0xcc, 0x99, 0x6c, 0xec, 0xe8, 0x09, 0x1b, 0x6d, 0x9c, 0x9b, 0x17, 0xe5, 0xd6, 0x51, 0x52,
+    0x24, 0x13, 0x43, 0xef, 0xfd, 0x34, 0x2f, 0x4a, 0xc8, 0xd1, 0xf1, 0x7f, 0x13, 0xaf, 0xce, 0x18,
+    0xe6, 0x34, 0x3b, 0x1a, 0x07, 0x2c, 0x10, 0x64, 0xb0, 0xee, 0xde, 0x4b, 0xc9, 0xd9, 0x39, 0xe4,
+    0x02, 0x61, 0x61, 0xa8, 0xe6, 0x2d, 0x68, 0x08, 0x88, 0xe8, 0x7e, 0x67, 0xa8, 0xcd, 0xae, 0xc0,
+    0xb9, 0x19, 0xc2, 0x28, 0x25, 0x82, 0xef, 0x19, 0x6a, 0x44, 0x3c, 0xe3, 0xc2, 0xf8, 0xd1, 0x8e,
+    0x61, 0x17, 0x47, 0xe6, 0xb7, 0x8a, 0xe3, 0xd8, 0xcc, 0x28, 0xc3, 0x8d, 0x04, 0x53, 0x92, 0x48,
+    0xa3, 0xd3, 0xd4, 0x6a, 0xdb, 0x1d, 0x6b, 0xb3, 0x53, 0x27, 0x6e, 0x98, 0x6d, 0x55, 0xad, 0x39,
+    0x9b, 0xdb, 0x73, 0x9c, 0x71, 0x28, 0x0d, 0x45, 0xd4, 0xa6, 0xef, 0xa2, 0xd2, 0xd7, 0x8a, 0xca,
+    0xbc, 0xc7, 0xbf, 0x55, 0x2f, 0x4a, 0x33, 0x3b, 0xff, 0xe3, 0x30, 0x94, 0xbd, 0xc8, 0x7e, 0x3d,
+    0x20, 0x28, 0xa1, 0x41, 0x73, 0x48, 0x70, 0xab, 0x60, 0xc4, 0x0c, 0xe1, 0x0e, 0xf7, 0xb5, 0x47,
+    0xea, 0x5b, 0xf3, 0x55, 0xa9, 0xbe, 0x0f, 0x09, 0x07, 0x00, 0x80, 0x99, 0xeb, 0x25, 0x8e, 0x47,
+    0x00, 0x00, 0x76, 0x2d, 0x01, 0xb1, 0xc1, 0x14, 0x00, 0x60, 0x39, 0xc5, 0x48, 0x0c, 0xeb, 0xc4,
+    0xc4, 0xb7, 0xa6, 0xbe, 0xb3, 0x6e, 0xb5, 0x5a, 0xcf, 0x8e, 0x55, 0xc6, 0x56, 0xb9, 0x9b, 0x94,
+    0xcf, 0x0b, 0x70, 0x9a, 0x6d, 0xa0, 0x4d, 0xb4, 0xd9, 0x87, 0xef, 0x7b, 0x9b, 0x31, 0x0d, 0x5e,
+    0x57, 0x9e, 0xe7, 0x0d, 0x2a, 0x44, 0x83, 0xa1, 0x9b, 0xf0, 0xfe, 0xdc, 0x4d, 0x7b, 0x0b, 0xa2,
+    0xe1, 0xc1, 0x11, 0xbd, 0x7d, 0xd8, 0x1b, 0x18, 0x77, 0xeb, 0x59, 0x81, 0x93, 0x39, 0x4b, 0x7f,
+    0xa9, 0x6d, 0x70, 0x67, 0xe6, 0x96, 0x4f, 0x60, 0x04, 0x12, 0xc7, 0x82, 0xf9, 0x3b, 0xd3, 0x9f,
+    0x5a, 0xfb, 0xe9, 0xda, 0x19, 0x5a, 0x07, 0x7e, 0x4a, 0x3f, 0x43, 0xdd, 0xee, 0x04, 0x95, 0x56,
+    0x9d, 0x3e, 0x8f, 0xa9, 0x95, 0x0c, 0x00, 0xfe, 0x2a, 0x74, 0x92, 0x4e, 0x8e, 0x81, 0xa3, 0x9e,
+    0x46, 0x53, 0xc6, 0x75, 0xa6, 0x91, 0xb6, 0x9e, 0xe4, 0xe8, 0xab, 0xab, 0xef, 0xa2, 0x72, 0xeb,
+    0xa7, 0xf3, 0x35, 0xac, 0x8a, 0x44, 0x0d, 0xec, 0xf5, 0x32, 0xda, 0x56, 0x6e, 0x41, 0x96, 0xc5,
+    0x7c, 0x06, 0x7b, 0x7a, 0x99, 0xae, 0x5e, 0xe7, 0x13, 0xbd, 0x8b, 0xc1, 0xfa, 0x40, 0xf3, 0x32,
+    0x0b, 0x17, 0x61, 0x59, 0xfa, 0x00, 0x93, 0x89, 0xdb, 0x7e, 0x1b, 0xc6, 0xc1, 0x75, 0x65, 0x6b,
+    0xbc, 0xf2, 0x7a, 0x8e, 0x48, 0xc7, 0x84, 0x90, 0x97, 0x97, 0x87, 0xdf, 0x0a, 0xe3, 0x0d, 0x81,
+    0x0b, 0x0c, 0xa5, 0x92, 0xe1, 0x58, 0xfe, 0x7d, 0x91, 0xbb, 0x3b, 0x5f, 0xcf, 0xa6, 0x5c, 0x7f,
+    0xec, 0x0f, 0x67, 0xd4, 0xca, 0xf1, 0xa1, 0x02, 0x00, 0x00};
+
+const char WM_ASSET_SCRIPT_ETAG[] PROGMEM = "\"46b8a7b01edc619b\"";
+const uint8_t WM_ASSET_SCRIPT_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x85, 0x94, 0xdd, 0x72, 0xdb, 0x36,
+    0x10, 0x85, 0x5f, 0x05, 0x51, 0x27, 0x5d, 0x60, 0xa8, 0x42, 0x74, 0x3a, 0xbd, 0x09, 0x04, 0x79,
+    0xfa, 0xe3, 0x26, 0xed, 0xd8, 0xc9, 0x4c, 0xe2, 0x8b, 0xde, 0xc2, 0xe4, 0x52, 0x44, 0xc3, 0x2c,
+    0x28, 0x60, 0x29, 0x4b, 0x43, 0xf3, 0xdd, 0x3b, 0x90, 0x2c, 0x5b, 0x4d, 0x9b, 0xf6, 0x0e, 0x04,
+    0xf6, 0xdb, 0x3d, 0x67, 0xb1, 0x60, 0x33, 0x50, 0xc5, 0x3e, 0x90, 0xa8, 0x64, 0xa7, 0xc6, 0x3a,
+    0x54, 0xc3, 0x67, 0x24, 0xd6, 0x6b, 0xe4, 0xab, 0x0e, 0xf3, 0xf2, 0xa7, 0xfd, 0x6f, 0xb5, 0x84,
+    0x04, 0x4a, 0x6f, 0x5d, 0x37, 0xa0, 0xed, 0xb4, 0x27, 0xc2, 0x78, 0x8b, 0x3b, 0x7e, 0x78, 0xe8,
+    0x34, 0xe3, 0x8e, 0x7f, 0x0e, 0xc4, 0x48, 0x6c, 0xbe, 0x4a, 0xf7, 0xa0, 0x74, 0x13, 0xaa, 0x21,
+    0x49, 0x65, 0x26, 0xd1, 0x9c, 0x4a, 0xa2, 0x64, 0x35, 0x6e, 0x5d, 0x14, 0xb5, 0x7d, 0x42, 0xab,
+    0x88, 0x8e, 0xf1, 0x91, 0x96, 0x50, 0xfb, 0x2d, 0x28, 0x53, 0x9f, 0x97, 0xb1, 0x6c, 0x22, 0xf2,
+    0x10, 0x49, 0xd4, 0x47, 0x29, 0x6f, 0x6f, 0x6f, 0xae, 0xcf, 0xd3, 0xde, 0x4b, 0x9a, 0x6f, 0xe6,
+    0xac, 0x46, 0x91, 0x73, 0xef, 0x2c, 0xe1, 0xbd, 0xf8, 0xe3, 0xe6, 0xfa, 0x2d, 0x73, 0xff, 0x01,
+    0x37, 0x03, 0x26, 0x96, 0xca, 0x3c, 0x87, 0x37, 0x52, 0x8d, 0x82, 0xad, 0xe4, 0x87, 0x87, 0x52,
+    0x15, 0x17, 0x46, 0xf8, 0x46, 0xf2, 0xea, 0x7b, 0x35, 0xd2, 0x73, 0x7a, 0x0b, 0x1f, 0x2b, 0x47,
+    0xa2, 0x71, 0xbe, 0xc3, 0x5a, 0x8b, 0x0f, 0xd8, 0x44, 0x4c, 0xad, 0xe0, 0x20, 0x38, 0xee, 0x85,
+    0x5b, 0x3b, 0x4f, 0x1a, 0x1e, 0x65, 0x99, 0x49, 0xfc, 0x83, 0x24, 0x4f, 0x6b, 0xad, 0xb5, 0x90,
+    0x11, 0x33, 0x00, 0x05, 0x17, 0xa0, 0xc0, 0x24, 0xe4, 0x5b, 0xff, 0x19, 0xc3, 0xc0, 0xf2, 0x24,
+    0x47, 0xaa, 0xf1, 0xa4, 0xdf, 0x4c, 0xf3, 0x57, 0x65, 0x59, 0x2a, 0x23, 0x26, 0xb1, 0xd3, 0x81,
+    0xba, 0xe0, 0x6a, 0x7b, 0x16, 0x77, 0xb0, 0x17, 0xe7, 0xed, 0x41, 0xf1, 0x4e, 0x27, 0x76, 0x3c,
+    0xa4, 0x17, 0xf6, 0x55, 0x59, 0xaa, 0xb1, 0x91, 0xea, 0x59, 0x0e, 0xc7, 0xfd, 0x18, 0xed, 0xef,
+    0x1f, 0xdf, 0xbf, 0xd3, 0xbd, 0x8b, 0x09, 0xe5, 0x4e, 0x47, 0x4c, 0x7d, 0xa0, 0x84, 0xf9, 0x1a,
+    0x95, 0x99, 0x2a, 0xc7, 0x55, 0x2b, 0x31, 0xc6, 0x2f, 0x48, 0xdf, 0xc8, 0xa8, 0xef, 0x86, 0xb4,
+    0xff, 0x97, 0x6e, 0x9c, 0x3c, 0x41, 0x11, 0x75, 0x1f, 0xc3, 0x3a, 0x62, 0x4a, 0x05, 0xbc, 0xfc,
+    0x2f, 0x57, 0x65, 0xf6, 0xf4, 0x43, 0xb6, 0x74, 0x5e, 0xe1, 0x45, 0xd4, 0x84, 0x7c, 0x1f, 0xe2,
+    0xa7, 0xa4, 0x3b, 0xa4, 0x35, 0xb7, 0x6a, 0x6c, 0x2d, 0xbc, 0x0b, 0xe2, 0xb4, 0x2d, 0x9a, 0x30,
+    0xd0, 0xdf, 0xfb, 0x9e, 0xf2, 0x7d, 0x9c, 0x1a, 0x3f, 0x09, 0xec, 0x12, 0x66, 0xe8, 0xd7, 0x1c,
+    0x28, 0xb8, 0x45, 0xd1, 0x84, 0xae, 0x0b, 0xf7, 0x9e, 0xd6, 0x4f, 0x59, 0x5e, 0x83, 0x39, 0xab,
+    0xd4, 0x84, 0x78, 0xe5, 0xaa, 0xf6, 0x59, 0xa2, 0x53, 0x63, 0x5b, 0xd8, 0xd9, 0xb2, 0xf6, 0xdb,
+    0xd5, 0xd2, 0x89, 0x36, 0x62, 0x63, 0xe1, 0x9b, 0x1e, 0x44, 0xa0, 0xaa, 0xf3, 0xd5, 0x27, 0x0b,
+    0x95, 0xe4, 0xd6, 0x27, 0x05, 0xab, 0x59, 0x81, 0xd2, 0xe9, 0x94, 0x7c, 0xad, 0x8a, 0xd9, 0x72,
+    0xe1, 0x56, 0xdf, 0xd2, 0x5d, 0xea, 0xcd, 0x32, 0xf5, 0x8e, 0x44, 0xd5, 0xb9, 0x94, 0x2c, 0x6c,
+    0xc4, 0xac, 0x90, 0x4e, 0xbb, 0x81, 0xdb, 0x4b, 0xe8, 0xe0, 0x35, 0x80, 0x2a, 0x66, 0x19, 0x75,
+    0x7a, 0x33, 0xb8, 0xce, 0xf3, 0xbe, 0x98, 0xbd, 0x5c, 0x2e, 0x32, 0xb2, 0x5a, 0x2e, 0x72, 0xd1,
+    0x99, 0x99, 0x94, 0x69, 0x0b, 0x0b, 0xcb, 0xbb, 0xb8, 0x58, 0xc1, 0x17, 0x73, 0x74, 0xbc, 0xe6,
+    0xa8, 0xd3, 0x63, 0xeb, 0xd5, 0xf8, 0x3f, 0x7d, 0x3e, 0xce, 0xce, 0x24, 0x26, 0x73, 0x98, 0x1e,
+    0x8c, 0x31, 0x44, 0x9b, 0x57, 0x7c, 0x84, 0x6c, 0x73, 0x38, 0xe8, 0x91, 0x24, 0xbc, 0xb9, 0xba,
+    0x85, 0x39, 0x2c, 0x72, 0x6e, 0xfd, 0x67, 0x0a, 0x04, 0x85, 0xdc, 0x5c, 0xc2, 0x65, 0xfe, 0xb6,
+    0x17, 0x07, 0xed, 0x2a, 0x07, 0x9f, 0xc8, 0x8b, 0xb2, 0x2c, 0xcb, 0xbc, 0x91, 0x90, 0x6a, 0x79,
+    0x18, 0xd0, 0xa7, 0x07, 0xec, 0xea, 0xfa, 0x6a, 0x8b, 0xc4, 0xd7, 0x3e, 0x31, 0x12, 0x46, 0x09,
+    0xbf, 0xbc, 0xbf, 0x79, 0x7c, 0xba, 0xd7, 0xc1, 0xd5, 0x58, 0xc3, 0xfc, 0x4c, 0x6e, 0x9e, 0x61,
+    0xb2, 0x5f, 0xfd, 0x73, 0x10, 0x28, 0xe3, 0x1b, 0x49, 0x47, 0x5f, 0x94, 0xcf, 0x7f, 0x64, 0x8e,
+    0xfe, 0x6e, 0x60, 0x94, 0x50, 0x3b, 0x76, 0xdf, 0x65, 0x91, 0xa0, 0xac, 0x85, 0x0b, 0x50, 0x66,
+    0x9a, 0x94, 0xf9, 0x0b, 0x55, 0x54, 0x95, 0xc7, 0xd3, 0x04, 0x00, 0x00};
+
+const char WM_HTTP_ASSETS[] PROGMEM = "<link rel=\"stylesheet\" href=\"/wm.css?v=38b22bbb94a05cfa\"><script src=\"/wm.js?v=46b8a7b01edc619b\"></script>";
+
+#endif
@@ -12,13 +12,279 @@
 
 #include <Preferences.h>
 
+#include <new>
+
 #include "WiFiManager-esp32.h"
+#include "WiFiManager-esp32-assets.h"
 
 #define DEFAULT_TIMEOUT 300
 
-int n_wifi_networks = 0;
+// all in milliseconds
+#define DEFAULT_CONNECT_TIMEOUT 10000
+#define AP_SETTLE_TIME 500
+#define CONNECT_DELAY 2000
+#define RESET_DELAY 5000
+
+// bits in _wifiEvents
+#define WIFI_EVENT_CONNECTED_BIT (1 << 0)
+#define WIFI_EVENT_GOT_IP_BIT (1 << 1)
+#define WIFI_EVENT_FAILED_BIT (1 << 2)
+
+// disconnect reasons (wifi_err_reason_t) after which the driver gives up; the
+// driver keeps retrying after any other reason until the connect timeout
+#define WIFI_DISCONNECT_REASON_4WAY_HANDSHAKE_TIMEOUT 15
+#define WIFI_DISCONNECT_REASON_AUTH_FAIL 202
+#define WIFI_DISCONNECT_REASON_ASSOC_FAIL 203
+#define WIFI_DISCONNECT_REASON_HANDSHAKE_TIMEOUT 204
+// after a directed connect: the AP is no longer on the cached channel
+#define WIFI_DISCONNECT_REASON_NO_AP_FOUND 201
+
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 2
+#define WM_EVENT_STA_CONNECTED ARDUINO_EVENT_WIFI_STA_CONNECTED
+#define WM_EVENT_STA_GOT_IP ARDUINO_EVENT_WIFI_STA_GOT_IP
+#define WM_EVENT_STA_DISCONNECTED ARDUINO_EVENT_WIFI_STA_DISCONNECTED
+#define WM_DISCONNECT_REASON(info) ((info).wifi_sta_disconnected.reason)
+#else
+#define WM_EVENT_STA_CONNECTED SYSTEM_EVENT_STA_CONNECTED
+#define WM_EVENT_STA_GOT_IP SYSTEM_EVENT_STA_GOT_IP
+#define WM_EVENT_STA_DISCONNECTED SYSTEM_EVENT_STA_DISCONNECTED
+#define WM_DISCONNECT_REASON(info) ((info).disconnected.reason)
+#endif
+
+// blob config format; see WiFiManager::ConfigFormat
+#define CONFIG_MAGIC 0x46434d57  // "WMCF"
+#define CONFIG_VERSION 1
+#define CONFIG_MAX_SIZE 4096
+
+// stored in front of the blob. The CRC covers the rest of the header and the
+// payload:
+//   uint8_t useHostname, uint8_t length, hostname
+//   uint8_t count, WiFiManagerNetwork[count]
+//   uint8_t count, count * (uint8_t length, id, uint16_t length, value)
+struct WiFiManagerConfigHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t length;  // of the payload
+  uint32_t sequence;
+  uint32_t crc;
+};
+
+static const char *configSlotKeys[] = {"cfgA", "cfgB"};
+
+// labels of WiFiManager::Route in /metrics
+static const char *const routeNames[] = {
+    "/", "/wifi", "/0wifi", "/wifisave", "/scan.json", "/i", "/r",
+    "/changename", "/savename", "/fwlink", "asset", "/metrics", "probe",
+    "not_found"};
+
+// URLs requested by operating systems to find out if they are behind a
+// captive portal
+static const char *const probeUris[] = {
+    "/generate_204",        "/gen_204",          // Android, Chrome OS
+    "/hotspot-detect.html", "/library/test/success.html",  // iOS, macOS
+    "/connecttest.txt",     "/ncsi.txt",         // Windows
+    "/redirect",            "/canonical.html",   // Windows, Firefox
+    "/success.txt",                              // Firefox
+};
+
+// bounds of WiFiManager::RouteMetrics::latency, in us and as label
+static const uint32_t latencyBounds[] = {1000,   5000,   10000,  50000,
+                                         100000, 500000, 1000000};
+static const char *const latencyLabels[] = {"0.001", "0.005", "0.01", "0.05",
+                                            "0.1",   "0.5",   "1",    "+Inf"};
+
+// ring buffer of connect attempts; not initialized at boot, so it survives
+// soft resets
+#ifndef RTC_NOINIT_ATTR
+#define RTC_NOINIT_ATTR
+#endif
+#define CONNECT_LOG_MAGIC 0x4c434d57  // "WMCL"
+
+struct WiFiManagerConnectLog {
+  uint32_t magic;
+  uint32_t boot;
+  uint16_t head;  // next record to write
+  uint16_t count;
+  WiFiManagerConnectRecord records[WIFI_MANAGER_CONNECT_LOG_SIZE];
+};
+
+static RTC_NOINIT_ATTR WiFiManagerConnectLog connectLog;
+static bool connectLogChecked = false;
+
+/** Start over if the log holds garbage (after power on); count boots */
+static void checkConnectLog() {
+  if (connectLogChecked) {
+    return;
+  }
+  connectLogChecked = true;
+  if (connectLog.magic != CONNECT_LOG_MAGIC ||
+      connectLog.head >= WIFI_MANAGER_CONNECT_LOG_SIZE ||
+      connectLog.count > WIFI_MANAGER_CONNECT_LOG_SIZE) {
+    memset(&connectLog, 0, sizeof(connectLog));
+    connectLog.magic = CONNECT_LOG_MAGIC;
+  }
+  connectLog.boot++;
+}
+
+// response body bytes sent by the portal, for RouteMetrics::bytesSent
+static uint32_t responseBytes = 0;
+
+static uint32_t fnv1a(const uint8_t *data, size_t length,
+                      uint32_t hash = 2166136261u) {
+  while (length-- > 0) {
+    hash = (hash ^ *data++) * 16777619u;
+  }
+  return hash;
+}
+
+/** Copy src into dest of size bytes, cut to fit; always terminates dest */
+static void copyString(char *dest, const char *src, size_t size) {
+  size_t length = strnlen(src, size - 1);
+  memmove(dest, src, length);
+  dest[length] = 0;
+}
+
+// "255.255.255.255" and "00:00:00:00:00:00" with their terminating 0
+#define IP_STRING_SIZE 16
+#define MAC_STRING_SIZE 18
+
+/** IPAddress::toString() without the String */
+static void formatIp(char *dest, IPAddress ip) {
+  snprintf(dest, IP_STRING_SIZE, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+}
+
+/** Same format as WiFi.macAddress() */
+static void formatMac(char *dest, const uint8_t *mac) {
+  snprintf(dest, MAC_STRING_SIZE, "%02X:%02X:%02X:%02X:%02X:%02X", mac[0],
+           mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
 Preferences preferences;
 
+WiFiManagerArena::~WiFiManagerArena() { reset(); }
+
+char *WiFiManagerArena::allocate(size_t size) {
+  // keep the buffers aligned so they may hold any type
+  size = (size + 3) & ~3;
+  if (_blocks == NULL || _blocks->size - _blocks->used < size) {
+    size_t blockSize = size > WIFI_MANAGER_ARENA_BLOCK_SIZE
+                           ? size
+                           : WIFI_MANAGER_ARENA_BLOCK_SIZE;
+    Block *block = (Block *)malloc(sizeof(Block) + blockSize);
+    if (block == NULL) {
+      return NULL;
+    }
+    block->next = _blocks;
+    block->size = blockSize;
+    block->used = 0;
+    _blocks = block;
+  }
+  char *data = (char *)(_blocks + 1) + _blocks->used;
+  _blocks->used += size;
+  return data;
+}
+
+void WiFiManagerArena::reset() {
+  while (_blocks != NULL) {
+    Block *next = _blocks->next;
+    free(_blocks);
+    _blocks = next;
+  }
+}
+
+size_t WiFiManagerArena::getSize() {
+  size_t size = 0;
+  for (Block *block = _blocks; block != NULL; block = block->next) {
+    size += sizeof(Block) + block->size;
+  }
+  return size;
+}
+
+size_t WiFiManagerArena::getUsed() {
+  size_t used = 0;
+  for (Block *block = _blocks; block != NULL; block = block->next) {
+    used += block->used;
+  }
+  return used;
+}
+
+bool WiFiManagerDNS::start(uint16_t port, IPAddress ip) {
+  static const uint8_t answer[] = {
+      0xc0, HEADER_SIZE,  // name: pointer to the question
+      0x00, 0x01,         // type A
+      0x00, 0x01,         // class IN
+      0x00, 0x00, 0x00, 0x3c,  // TTL: 60 s
+      0x00, 0x04,              // address length
+  };
+
+  memcpy(_answer, answer, sizeof(answer));
+  for (int i = 0; i < 4; i++) {
+    _answer[sizeof(answer) + i] = ip[i];
+  }
+  return _udp.begin(port);
+}
+
+void WiFiManagerDNS::stop() { _udp.stop(); }
+
+int WiFiManagerDNS::process(int max) {
+  int count = 0;
+
+  while (count < max) {
+    int size = _udp.parsePacket();
+    if (size <= 0) {
+      break;
+    }
+    count++;
+    // anything beyond the question (EDNS records) is not needed
+    size = _udp.read(_packet, PACKET_SIZE);
+    _udp.flush();
+    if (size > 0) {
+      reply(size);
+    }
+  }
+  return count;
+}
+
+/** Turn the query in _packet into a reply and send it. Malformed queries and
+ * anything other than a standard query with one question are dropped */
+void WiFiManagerDNS::reply(size_t size) {
+  uint8_t *header = _packet;
+
+  if (size < HEADER_SIZE || (header[2] & 0xf8) != 0 || header[4] != 0 ||
+      header[5] != 1) {
+    return;  // a response, not a standard query, or not one question
+  }
+
+  // skip the name; questions do not use compression
+  size_t offset = HEADER_SIZE;
+  while (offset < size && _packet[offset] != 0) {
+    if ((_packet[offset] & 0xc0) != 0) {
+      return;
+    }
+    offset += _packet[offset] + 1;
+  }
+  offset += 1 + 4;  // terminating zero, type and class
+  if (offset > size) {
+    return;
+  }
+  bool isA = _packet[offset - 4] == 0 && _packet[offset - 3] == 1 &&
+             _packet[offset - 2] == 0 && _packet[offset - 1] == 1;
+
+  header[2] = 0x84 | (header[2] & 0x01);  // response, authoritative, RD
+  header[3] = 0x00;                        // no recursion, no error
+  header[6] = 0;
+  header[7] = isA ? 1 : 0;  // answer count
+  memset(header + 8, 0, 4);  // no authority or additional records
+  if (isA) {
+    memcpy(_packet + offset, _answer, ANSWER_SIZE);
+    offset += ANSWER_SIZE;
+  }
+
+  _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+  _udp.write(_packet, offset);
+  _udp.endPacket();
+}
+
 WiFiManagerParameter::WiFiManagerParameter(const char *custom) {
   _id = NULL;
   _placeholder = NULL;
@@ -48,25 +314,240 @@ void WiFiManagerParameter::init(const char *id, const char *placeholder,
   _id = id;
   _placeholder = placeholder;
   _length = length;
-  _value = new char[length + 1];
+  _defaultValue = defaultValue;
 
-  for (int i = 0; i < length; i++) {
-    _value[i] = 0;
-  }
-  if (defaultValue != NULL) {
-    strncpy(_value, defaultValue, length);
+  _customHTML = custom;
+}
+
+WiFiManagerParameter::~WiFiManagerParameter() {
+  if (_manager != NULL) {
+    _manager->removeParameter(this);
   }
+}
 
-  _customHTML = custom;
+WiFiManagerParameter::WiFiManagerParameter(WiFiManagerParameter &&other) {
+  _manager = NULL;
+  *this = std::move(other);
+}
+
+WiFiManagerParameter &WiFiManagerParameter::operator=(
+    WiFiManagerParameter &&other) {
+  if (this == &other) {
+    return *this;
+  }
+  if (_manager != NULL) {
+    _manager->removeParameter(this);
+  }
+  _id = other._id;
+  _placeholder = other._placeholder;
+  _defaultValue = other._defaultValue;
+  _value = other._value;
+  _length = other._length;
+  _customHTML = other._customHTML;
+  _group = other._group;
+  _manager = other._manager;
+  if (_manager != NULL) {
+    _manager->replaceParameter(&other, this);
+  }
+  other._value = NULL;
+  other._manager = NULL;
+  return *this;
 }
 
-const char *WiFiManagerParameter::getValue() { return _value; }
+const char *WiFiManagerParameter::getValue() {
+  if (_value != NULL || _id == NULL) {
+    return _value;
+  }
+  return _defaultValue != NULL ? _defaultValue : "";
+}
 const char *WiFiManagerParameter::getID() { return _id; }
 const char *WiFiManagerParameter::getPlaceholder() { return _placeholder; }
 int WiFiManagerParameter::getValueLength() { return _length; }
 const char *WiFiManagerParameter::getCustomHTML() { return _customHTML; }
+void WiFiManagerParameter::setGroup(const char *group) { _group = group; }
+const char *WiFiManagerParameter::getGroup() { return _group; }
+
+#ifdef ESP8266
+WiFiManagerPageWriter::WiFiManagerPageWriter(ESP8266WebServer *server) {
+#else
+WiFiManagerPageWriter::WiFiManagerPageWriter(WebServer *server) {
+#endif
+  _server = server;
+}
+
+WiFiManagerPageWriter::~WiFiManagerPageWriter() { free(_copy); }
+
+void WiFiManagerPageWriter::begin(int code, const char *contentType) {
+  // Unknown content length makes the web server use chunked transfer encoding
+  // (or close the connection when done for HTTP/1.0 clients)
+  _server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+  _server->send(code, contentType, "");
+}
+
+void WiFiManagerPageWriter::print(const char *str) {
+  if (str != NULL) {
+    write(str, strlen(str), false);
+  }
+}
+
+void WiFiManagerPageWriter::print(const String &str) {
+  write(str.c_str(), str.length(), false);
+}
+
+void WiFiManagerPageWriter::print(const __FlashStringHelper *str) {
+  print_P((PGM_P)str);
+}
+
+void WiFiManagerPageWriter::print(uint32_t value) {
+  char tmp[11];
+  int len = snprintf(tmp, sizeof(tmp), "%u", (unsigned)value);
+  write(tmp, len, false);
+}
+
+void WiFiManagerPageWriter::print(int32_t value) {
+  char tmp[12];
+  int len = snprintf(tmp, sizeof(tmp), "%d", (int)value);
+  write(tmp, len, false);
+}
+
+void WiFiManagerPageWriter::printJSON(const char *str) {
+  const char *run = str;
+
+  write("\"", 1, false);
+  for (; *str; str++) {
+    uint8_t c = *str;
+    if (c == '"' || c == '\\' || c < 0x20) {
+      char escaped[7];
+      int len;
+      write(run, str - run, false);
+      if (c < 0x20) {
+        len = snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      } else {
+        len = snprintf(escaped, sizeof(escaped), "\\%c", c);
+      }
+      write(escaped, len, false);
+      run = str + 1;
+    }
+  }
+  write(run, str - run, false);
+  write("\"", 1, false);
+}
+
+void WiFiManagerPageWriter::print_P(PGM_P str) {
+  write(str, strlen_P(str), true);
+}
+
+void WiFiManagerPageWriter::printTemplate(PGM_P tmpl,
+                                          const WiFiManagerSlot *slots,
+                                          size_t count) {
+  PGM_P literal = tmpl;
+  PGM_P p = tmpl;
+  char c;
+
+  while ((c = pgm_read_byte(p)) != 0) {
+    const WiFiManagerSlot *slot = NULL;
+    if (c == '{' && pgm_read_byte(p + 1) != 0 && pgm_read_byte(p + 2) == '}') {
+      char key = pgm_read_byte(p + 1);
+      for (size_t n = 0; n < count; n++) {
+        if (slots[n].key == key) {
+          slot = &slots[n];
+          break;
+        }
+      }
+    }
+    if (slot != NULL) {
+      write(literal, p - literal, true);
+      print(slot->value);
+      p += 3;
+      literal = p;
+    } else {
+      p++;
+    }
+  }
+  write(literal, p - literal, true);
+}
+
+void WiFiManagerPageWriter::write(const char *data, size_t len,
+                                  bool progmem) {
+  while (len > 0) {
+    size_t n = sizeof(_buffer) - _used;
+    if (n > len) {
+      n = len;
+    }
+    if (progmem) {
+      memcpy_P(_buffer + _used, data, n);
+    } else {
+      memcpy(_buffer + _used, data, n);
+    }
+    _used += n;
+    data += n;
+    len -= n;
+    if (_used == sizeof(_buffer)) {
+      flush();
+    }
+  }
+}
+
+void WiFiManagerPageWriter::flush() {
+  if (_used > 0 && _copyLimit > 0) {
+    size_t needed = _copyLength + _used;
+    if (needed > _copySize) {
+      size_t size = _copySize < 1024 ? 1024 : 2 * _copySize;
+      if (size < needed) {
+        size = needed;
+      }
+      if (size > _copyLimit) {
+        size = _copyLimit;
+      }
+      char *copy = size < needed ? NULL : (char *)realloc(_copy, size);
+      if (copy == NULL) {
+        // too big; give up on the copy
+        free(_copy);
+        _copy = NULL;
+        _copyLimit = 0;
+      } else {
+        _copy = copy;
+        _copySize = size;
+      }
+    }
+    if (_copy != NULL) {
+      memcpy(_copy + _copyLength, _buffer, _used);
+      _copyLength += _used;
+    }
+  }
+  if (_used > 0) {
+    _server->sendContent(_buffer, _used);
+    _sent += _used;
+    responseBytes += _used;
+    _used = 0;
+  }
+}
+
+void WiFiManagerPageWriter::end() {
+  flush();
+  // zero-length chunk terminates the response
+  _server->sendContent("", 0);
+}
+
+size_t WiFiManagerPageWriter::getBytesSent() { return _sent + _used; }
+
+void WiFiManagerPageWriter::keepCopy(size_t limit) { _copyLimit = limit; }
+
+char *WiFiManagerPageWriter::takeCopy(size_t *length) {
+  char *copy = _copyLimit > 0 ? _copy : NULL;
+  *length = _copyLength;
+  _copy = NULL;
+  _copyLimit = 0;
+  return copy;
+}
+
+void WiFiManager::configure(const String &hostname,
+                            void (*statusCb)(Status status)) {
+  configure(hostname.c_str(), statusCb);
+}
 
-void WiFiManager::configure(String hostname, void (*statusCb)(Status status)) {
+void WiFiManager::configure(const char *hostname,
+                            void (*statusCb)(Status status)) {
   // Open Preferences with my-app namespace. Each application module, library,
   // etc has to use a namespace name to prevent key name collisions. We will
   // open storage in RW-mode (second parameter has to be false). Note: Namespace
@@ -77,38 +558,178 @@ void WiFiManager::configure(String hostname, void (*statusCb)(Status status)) {
   _statusCb = statusCb;
 
   status.mode = CONNECTING;
-  if (_statusCb) {
-    _statusCb(status);
-  }
+  notifyStatus();
 
   appendMacToHostname(true);
   setDefaultHostname(hostname);
+  unsigned long start = micros();
+  loadConfig();
+  _configLoadTime = micros() - start;
   readHostname();
   readNetworkCredentials();
 }
 
 WiFiManager::WiFiManager() {}
 
+WiFiManager::~WiFiManager() {
+  // the values are freed with the arena
+  for (size_t i = 0; i < _params.size(); i++) {
+    _params[i]->_value = NULL;
+    _params[i]->_manager = NULL;
+  }
+  clearPageCache();
+  if (_wifiEvents != NULL) {
+    // the handler captures this
+    WiFi.removeEvent(_wifiEventId);
+    vEventGroupDelete(_wifiEvents);
+  }
+}
+
 void WiFiManager::addParameter(WiFiManagerParameter *p) {
-  if (_paramsCount + 1 > WIFI_MANAGER_MAX_PARAMS) {
-    // Max parameters exceeded!
-    DEBUG_WM(
-        F("WIFI_MANAGER_MAX_PARAMS exceeded, increase number (in "
-          "WiFiManager.h) before adding more parameters!"));
-    DEBUG_WM(F("Skipping parameter with ID: "));
-    DEBUG_WM(p->getID());
+  if (p->_manager != NULL) {
+    DEBUG_WM(F("Parameter already added"));
     return;
   }
-  _params[_paramsCount] = p;
-  _paramsCount++;
+  if (p->_id != NULL && p->_value == NULL) {
+    p->_value = _paramArena.allocate(p->_length + 1);
+    if (p->_value == NULL) {
+      DEBUG_WM(F("Out of memory; skipping parameter"));
+      return;
+    }
+    memset(p->_value, 0, p->_length + 1);
+    if (p->_defaultValue != NULL) {
+      strncpy(p->_value, p->_defaultValue, p->_length);
+    }
+  }
+
+  if (_params.empty()) {
+    _params.reserve(WIFI_MANAGER_MAX_PARAMS);
+  }
+  _params.push_back(p);
+  p->_manager = this;
+  invalidatePages();
   DEBUG_WM(F("Adding parameter: "));
   DEBUG_WM(p->getID());
+
+  if (_paramIndex.size() < 2 * _params.size()) {
+    rebuildParameterIndex();
+  } else {
+    indexParameter(_params.size() - 1);
+  }
+  restoreParameter(p);
+}
+
+void WiFiManager::rebuildParameterIndex() {
+  // keep the table at most half full
+  size_t size = 16;
+  while (size < 2 * _params.size()) {
+    size *= 2;
+  }
+  _paramIndex.assign(size, -1);
+  for (size_t i = 0; i < _params.size(); i++) {
+    indexParameter(i);
+  }
+}
+
+void WiFiManager::removeParameter(WiFiManagerParameter *p) {
+  for (size_t i = 0; i < _params.size(); i++) {
+    if (_params[i] == p) {
+      _params.erase(_params.begin() + i);
+      rebuildParameterIndex();
+      invalidatePages();
+      break;
+    }
+  }
+  // the buffer stays in the arena until it is reset
+  p->_value = NULL;
+  p->_manager = NULL;
+}
+
+void WiFiManager::replaceParameter(WiFiManagerParameter *from,
+                                   WiFiManagerParameter *to) {
+  for (size_t i = 0; i < _params.size(); i++) {
+    if (_params[i] == from) {
+      _params[i] = to;
+      invalidatePages();
+    }
+  }
+}
+
+void WiFiManager::resetParameters() {
+  for (size_t i = 0; i < _params.size(); i++) {
+    _params[i]->_value = NULL;
+    _params[i]->_manager = NULL;
+  }
+  _params.clear();
+  _paramIndex.clear();
+  _paramArena.reset();
+  invalidatePages();
+}
+
+size_t WiFiManager::getParameterArenaSize() { return _paramArena.getSize(); }
+
+size_t WiFiManager::getParameterArenaUsed() { return _paramArena.getUsed(); }
+
+void WiFiManager::addParameter(WiFiManagerParameter *p, const char *group) {
+  p->setGroup(group);
+  addParameter(p);
+}
+
+/** Add _params[index] to the id index. If the id is already there, the
+ * first parameter with that id keeps it */
+void WiFiManager::indexParameter(int index) {
+  const char *id = _params[index]->getID();
+  if (id == NULL) {
+    return;
+  }
+
+  size_t mask = _paramIndex.size() - 1;
+  size_t slot = fnv1a((const uint8_t *)id, strlen(id)) & mask;
+  while (_paramIndex[slot] >= 0) {
+    if (strcmp(_params[_paramIndex[slot]]->getID(), id) == 0) {
+      DEBUG_WM(F("Duplicate parameter ID"));
+      return;
+    }
+    slot = (slot + 1) & mask;
+  }
+  _paramIndex[slot] = index;
+}
+
+/** Index in _params of the parameter with this id, or -1 */
+int WiFiManager::findParameter(const char *id) {
+  if (_paramIndex.empty() || id == NULL) {
+    return -1;
+  }
+
+  size_t mask = _paramIndex.size() - 1;
+  size_t slot = fnv1a((const uint8_t *)id, strlen(id)) & mask;
+  while (_paramIndex[slot] >= 0) {
+    if (strcmp(_params[_paramIndex[slot]]->getID(), id) == 0) {
+      return _paramIndex[slot];
+    }
+    slot = (slot + 1) & mask;
+  }
+  return -1;
+}
+
+WiFiManagerParameter *WiFiManager::getParameter(const char *id) {
+  int i = findParameter(id);
+  return i < 0 ? NULL : _params[i];
+}
+
+int WiFiManager::getParameterCount() { return _params.size(); }
+
+WiFiManagerParameter *WiFiManager::getParameter(int index) {
+  if (index < 0 || index >= (int)_params.size()) {
+    return NULL;
+  }
+  return _params[index];
 }
 
 void WiFiManager::setupConfigPortal() {
   DEBUG_WM(F("Configuring access point... "));
 
-  dnsServer.reset(new DNSServer());
+  dnsServer.reset(new WiFiManagerDNS());
 #ifdef ESP8266
   server.reset(new ESP8266WebServer(80));
 #else
@@ -141,44 +762,58 @@ void WiFiManager::setupConfigPortal() {
     WiFi.softAP(_apName);
   }
 
-  delay(500);  // Without delay I've seen the IP address blank
-  DEBUG_WM(F("AP IP address: "));
-  DEBUG_WM(WiFi.softAPIP());
-
-  /* Setup the DNS server redirecting all the domains to the apIP */
-  dnsServer->setErrorReplyCode(DNSReplyCode::NoError);
-  dnsServer->start(DNS_PORT, "*", WiFi.softAPIP());
+  // The DNS server is started by processConfigPortal() once the AP has
+  // settled. Without a delay I've seen the IP address blank
+  setPortalPhase(PORTAL_PHASE_STARTING);
 
   /* Setup web pages: root, wifi config pages, SO captive portal detectors and
    * not found. */
   // server->on("/", std::bind(&WiFiManager::handleRoot, this));
-  server->on("/", std::bind(&WiFiManager::handleWifi, this, false));
-  server->on("/wifi", std::bind(&WiFiManager::handleWifi, this, true));
-  server->on("/0wifi", std::bind(&WiFiManager::handleWifi, this, false));
-  server->on("/wifisave", std::bind(&WiFiManager::handleWifiSave, this));
-  server->on("/i", std::bind(&WiFiManager::handleInfo, this));
-  server->on("/r", std::bind(&WiFiManager::handleReset, this));
-  server->on("/changename",
-             std::bind(&WiFiManager::handleChangeName, this, false));
-  server->on("/savename", std::bind(&WiFiManager::handleSaveName, this));
-  // server->on("/generate_204", std::bind(&WiFiManager::handle204, this));
-  // //Android/Chrome OS captive portal check. server->on("/fwlink",
-  // std::bind(&WiFiManager::handleRoot, this));  //Microsoft captive portal.
-  // Maybe not needed. Might be handled by notFound handler.
-  server->on("/fwlink",
-             std::bind(&WiFiManager::handleWifi, this,
-                       false));  // Microsoft captive portal. Maybe not needed.
-                                 // Might be handled by notFound handler.
-  server->onNotFound(std::bind(&WiFiManager::handleNotFound, this));
+  onRoute("/", ROUTE_ROOT, std::bind(&WiFiManager::handleWifi, this, false));
+  onRoute("/wifi", ROUTE_WIFI, std::bind(&WiFiManager::handleWifi, this, true));
+  onRoute("/0wifi", ROUTE_WIFI_NO_SCAN,
+          std::bind(&WiFiManager::handleWifi, this, false));
+  onRoute("/wifisave", ROUTE_WIFI_SAVE,
+          std::bind(&WiFiManager::handleWifiSave, this));
+  onRoute("/scan.json", ROUTE_SCAN_JSON,
+          std::bind(&WiFiManager::handleScanJSON, this));
+  onRoute("/i", ROUTE_INFO, std::bind(&WiFiManager::handleInfo, this));
+  onRoute("/r", ROUTE_RESET, std::bind(&WiFiManager::handleReset, this));
+  onRoute("/changename", ROUTE_CHANGE_NAME,
+          std::bind(&WiFiManager::handleChangeName, this, false));
+  onRoute("/savename", ROUTE_SAVE_NAME,
+          std::bind(&WiFiManager::handleSaveName, this));
+  // Microsoft captive portal. Maybe not needed. Might be handled by notFound
+  // handler.
+  onRoute("/fwlink", ROUTE_FWLINK,
+          std::bind(&WiFiManager::handleWifi, this, false));
+  onRoute("/wm.css", ROUTE_ASSET,
+          std::bind(&WiFiManager::handleAsset, this, WM_ASSET_STYLE_GZ,
+                    sizeof(WM_ASSET_STYLE_GZ), "text/css",
+                    WM_ASSET_STYLE_ETAG));
+  onRoute("/wm.js", ROUTE_ASSET,
+          std::bind(&WiFiManager::handleAsset, this, WM_ASSET_SCRIPT_GZ,
+                    sizeof(WM_ASSET_SCRIPT_GZ), "application/javascript",
+                    WM_ASSET_SCRIPT_ETAG));
+  onRoute("/metrics", ROUTE_METRICS,
+          std::bind(&WiFiManager::handleMetrics, this));
+  for (size_t i = 0; i < sizeof(probeUris) / sizeof(probeUris[0]); i++) {
+    onRoute(probeUris[i], ROUTE_PROBE,
+            std::bind(&WiFiManager::handleProbe, this));
+  }
+  server->onNotFound([this]() {
+    // a lambda that only holds this fits in the std::function; a bind
+    // expression would be copied to the heap on every request
+    handleRoute(ROUTE_NOT_FOUND, [this]() { handleNotFound(); });
+  });
+  // needed to answer asset requests with 304 Not Modified
+  const char *headerKeys[] = {"If-None-Match"};
+  server->collectHeaders(headerKeys, 1);
   server->begin();  // Web server start
   DEBUG_WM(F("HTTP server started"));
 }
 
-boolean WiFiManager::autoConnect() {
-  String ssid = getHostname();
-
-  return autoConnect(ssid.c_str(), NULL);
-}
+boolean WiFiManager::autoConnect() { return autoConnect(_hostname, NULL); }
 
 boolean WiFiManager::autoConnect(char const *apName, char const *apPassword) {
   bool connected = false;
@@ -188,8 +823,15 @@ boolean WiFiManager::autoConnect(char const *apName, char const *apPassword) {
   DEBUG_WM(F(""));
   DEBUG_WM(F("AutoConnect"));
 
-  String macStr = getMacAsString(true);
-  DEBUG_WM("MAC: " + macStr);
+  uint64_t mac64 = getMac();
+  uint8_t mac[6];
+  char address[MAC_STRING_SIZE];
+  for (int i = 0; i < 6; i++) {
+    mac[i] = mac64 >> (40 - 8 * i);
+  }
+  formatMac(address, mac);
+  DEBUG_WM(F("MAC: "));
+  DEBUG_WM(address);
 
   // attempt to connect; should it fail, fall back to AP
   WiFi.mode(WIFI_STA);
@@ -198,7 +840,15 @@ boolean WiFiManager::autoConnect(char const *apName, char const *apPassword) {
   // SSID and password, these settings are not always properly stored. Instead,
   // it is better to rely on the ssid and password stored in user preferences
   // (already loaded in _ssid and _pass)
-  if (_ssid != "") {
+  if (_networkCount > 1) {
+    if (connectKnownNetworks()) {
+      DEBUG_WM(F("IP Address:"));
+      DEBUG_WM(WiFi.localIP());
+      connected = true;
+    } else {
+      connected = startConfigPortal(apName, apPassword);
+    }
+  } else if (_ssid[0] != 0) {
     DEBUG_WM(F("Connecting to network: "));
     DEBUG_WM(_ssid);
     if (connectWifi(_ssid, _pass) == WL_CONNECTED) {
@@ -233,140 +883,393 @@ boolean WiFiManager::configPortalHasTimeout() {
 }
 
 boolean WiFiManager::startConfigPortal() {
-  String ssid = getHostname();
-
-  return startConfigPortal(ssid.c_str(), NULL);
+  return startConfigPortal(_hostname, NULL);
 }
 
 boolean WiFiManager::startConfigPortal(char const *apName,
                                        char const *apPassword) {
-  // First scan networks (so user doesn't have to wait)
-  // Scan does not seem to work without disconnecting first
-  WiFi.disconnect(true);
+  beginConfigPortal(apName, apPassword);
 
-  status.mode = SCANNING;
-  if (_statusCb) {
-    _statusCb(status);
+  while (processConfigPortal() == PORTAL_RUNNING) {
+    yield();
   }
 
-  n_wifi_networks = WiFi.scanNetworks();
-  DEBUG_WM(F("Scan done"));
+  return WiFi.status() == WL_CONNECTED;
+}
+
+void WiFiManager::beginConfigPortal() { beginConfigPortal(_hostname, NULL); }
+
+void WiFiManager::beginConfigPortal(char const *apName,
+                                    char const *apPassword) {
+  _portalBegin = millis();
+  _timeToPortal = 0;
+  _configChanges = {0, 0};
+
+  // The first scan is started once the AP is up (see processConfigPortal());
+  // the config page shows its progress meanwhile
+  WiFi.disconnect(true);
 
   // setup AP
   WiFi.mode(WIFI_AP_STA);
   DEBUG_WM("SET AP STA");
 
   status.mode = PORTAL;
-  if (_statusCb) {
-    _statusCb(status);
-  }
+  notifyStatus();
 
   _apName = apName;
   _apPassword = apPassword;
 
   // notify we entered AP mode
-  if (_apcallback != NULL) {
-    _apcallback(this);
-  }
+  notifyAPStarted();
 
   connect = false;
+  _resetRequested = false;
+  allocateScanTable();
   setupConfigPortal();
+}
+
+WiFiManager::PortalResult WiFiManager::processConfigPortal() {
+  if (_portalPhase == PORTAL_PHASE_IDLE) {
+    return PORTAL_IDLE;
+  }
+
+  if (_resetRequested && millis() - _resetRequestTime >= RESET_DELAY) {
+#if defined(ESP8266)
+    ESP.reset();
+#else
+    ESP.restart();
+#endif
+  }
+
+  // check if timeout
+  if (configPortalHasTimeout()) {
+    stopConfigPortal();
+    return PORTAL_TIMEOUT;
+  }
+
+  unsigned long elapsed = millis() - _portalPhaseStart;
+
+  switch (_portalPhase) {
+    case PORTAL_PHASE_STARTING:
+      if (elapsed >= AP_SETTLE_TIME) {
+        DEBUG_WM(F("AP IP address: "));
+        DEBUG_WM(WiFi.softAPIP());
+
+        /* Setup the DNS server redirecting all the domains to the apIP */
+        dnsServer->start(DNS_PORT, WiFi.softAPIP());
+        setPortalPhase(PORTAL_PHASE_SERVING);
+
+        _portalUrl = String("http://") + toStringIp(WiFi.softAPIP());
+
+        _timeToPortal = millis() - _portalBegin;
+        DEBUG_WM(F("Portal ready; time to portal (ms):"));
+        DEBUG_WM(_timeToPortal);
+
+        startScan(SCAN_PORTAL_START);
+      }
+      break;
 
-  while (1) {
-    // check if timeout
-    if (configPortalHasTimeout()) break;
+    case PORTAL_PHASE_CONNECT_DELAY:
+      if (elapsed >= CONNECT_DELAY) {
+        status.mode = CONNECTING;
+        notifyStatus();
 
-    // DNS
-    dnsServer->processNextRequest();
-    // HTTP
-    server->handleClient();
+        DEBUG_WM(F("Connecting to new AP"));
+        DEBUG_WM(F("Connecting as wifi client..."));
 
-    if (connect) {
-      connect = false;
-      delay(2000);
+        // using user-provided  _ssid, _pass in place of system-stored ssid and
+        // pass
+        _connectAttempt = 0;
+        setPortalPhase(PORTAL_PHASE_CONNECTING);
+        if (_ssid[0] != 0) {
+          beginConnectWifi(_ssid, _pass, _connectAttempt);
+        }
+      }
+      break;
 
-      status.mode = CONNECTING;
-      if (_statusCb) {
-        _statusCb(status);
+    case PORTAL_PHASE_CONNECTING: {
+      int connRes = WL_CONNECT_FAILED;
+      if (_ssid[0] != 0) {
+        connRes = pollConnectResult();
+      }
+      if (connRes < 0) {
+        break;
       }
 
-      DEBUG_WM(F("Connecting to new AP"));
+      if (connRes != WL_CONNECTED && _connectAttempt == 0 && _ssid[0] != 0) {
+        // Connection failed; could be due to this issue where every 2nd
+        // connect attempt fails:
+        // https://github.com/espressif/arduino-esp32/issues/234
+        // As temporary workaround: try to connect for second time
+        WiFi.disconnect(true);
+        _connectAttempt = 1;
+        beginConnectWifi(_ssid, _pass, _connectAttempt);
+        break;
+      }
+      DEBUG_WM(F("Connection result: "));
+      DEBUG_WM(connRes);
 
-      // using user-provided  _ssid, _pass in place of system-stored ssid and
-      // pass
-      if (connectWifi(_ssid, _pass) != WL_CONNECTED) {
+      if (connRes != WL_CONNECTED) {
         DEBUG_WM(F("Failed to connect."));
+        if (_ssid[0] != 0) {
+          saveConnectResult(_ssid, false);
+        }
 
         status.mode = DISCONNECTED;
-        if (_statusCb) {
-          _statusCb(status);
-        }
+        notifyStatus();
       } else {
         // connected
+        _connectDuration = millis() - _portalPhaseStart;
+        saveConnectResult(_ssid, true);
         WiFi.mode(WIFI_STA);
 
         status.mode = CONNECTED;
-        if (_statusCb) {
-          _statusCb(status);
-        }
+        notifyStatus();
 
         // notify that configuration has changed and any optional parameters
         // should be saved
-        if (_savecallback != NULL) {
-          // todo: check if any custom parameters actually exist, and check if
-          // they really changed maybe
-          _savecallback();
-        }
-        break;
+        notifyConfigSaved();
+        stopConfigPortal();
+        return PORTAL_CONNECTED;
       }
 
       if (_shouldBreakAfterConfig) {
         // flag set to exit after config after trying to connect
         // notify that configuration has changed and any optional parameters
         // should be saved
-        if (_savecallback != NULL) {
-          // todo: check if any custom parameters actually exist, and check if
-          // they really changed maybe
-          _savecallback();
-        }
-        break;
+        notifyConfigSaved();
+        stopConfigPortal();
+        return PORTAL_FAILED;
       }
+      setPortalPhase(PORTAL_PHASE_SERVING);
+      break;
     }
-    yield();
+
+    default:
+      break;
   }
 
-  server.reset();
-  dnsServer.reset();
+  if (_portalPhase != PORTAL_PHASE_STARTING) {
+    // DNS; answer the whole burst a client sends when it joins the AP
+    _metrics.dnsQueries += dnsServer->process(WIFI_MANAGER_DNS_BURST);
+  }
+  pollScan();
+  // HTTP
+  server->handleClient();
+
+  if (connect) {
+    // give the browser some time to receive the save page before the
+    // connection attempt takes the radio away
+    connect = false;
+    setPortalPhase(PORTAL_PHASE_CONNECT_DELAY);
+  }
 
-  return WiFi.status() == WL_CONNECTED;
+  return PORTAL_RUNNING;
 }
 
-int WiFiManager::connectWifi(String ssid, String pass) {
+void WiFiManager::stopConfigPortal() {
+  server.reset();
+  clearPageCache();
+  if (!_scanInFlight) {
+    freeScanTable();
+  }
+  if (dnsServer) {
+    dnsServer->stop();
+  }
+  dnsServer.reset();
+  setPortalPhase(PORTAL_PHASE_IDLE);
+}
+
+#if !defined(ESP8266)
+boolean WiFiManager::startConfigPortalTask(char const *apName,
+                                           char const *apPassword,
+                                           BaseType_t core,
+                                           UBaseType_t priority,
+                                           uint32_t stackSize) {
+  if (_portalEvents != NULL) {
+    DEBUG_WM(F("Portal task already running"));
+    return false;
+  }
+
+  _portalEvents =
+      xQueueCreate(WIFI_MANAGER_EVENT_QUEUE_LENGTH, sizeof(PortalEvent));
+  _portalCommands = xQueueCreate(1, sizeof(uint8_t));
+  _apName = apName;
+  _apPassword = apPassword;
+  _portalTaskStackHighWaterMark = 0;
+
+  if (_portalEvents == NULL || _portalCommands == NULL ||
+      xTaskCreatePinnedToCore(portalTask, "WiFiManager", stackSize, this,
+                              priority, NULL, core) != pdPASS) {
+    DEBUG_WM(F("Failed to start portal task"));
+    if (_portalEvents != NULL) {
+      vQueueDelete(_portalEvents);
+      _portalEvents = NULL;
+    }
+    if (_portalCommands != NULL) {
+      vQueueDelete(_portalCommands);
+      _portalCommands = NULL;
+    }
+    return false;
+  }
+  return true;
+}
+
+void WiFiManager::portalTask(void *arg) {
+  WiFiManager *wm = (WiFiManager *)arg;
+  PortalResult result;
+  uint8_t command;
+  TickType_t measured = xTaskGetTickCount();
+
+  wm->beginConfigPortal(wm->_apName, wm->_apPassword);
+  while ((result = wm->processConfigPortal()) == PORTAL_RUNNING) {
+    if (xQueueReceive(wm->_portalCommands, &command, 0) == pdTRUE) {
+      wm->stopConfigPortal();
+      result = PORTAL_IDLE;
+      break;
+    }
+    // only this task measures its stack: its handle is gone once it has
+    // deleted itself, and another core cannot tell when that happens
+    if (xTaskGetTickCount() - measured >= pdMS_TO_TICKS(1000)) {
+      wm->_portalTaskStackHighWaterMark = uxTaskGetStackHighWaterMark(NULL);
+      measured = xTaskGetTickCount();
+    }
+    vTaskDelay(1);
+  }
+
+  wm->_portalTaskStackHighWaterMark = uxTaskGetStackHighWaterMark(NULL);
+  // the application owns the queues from here on; it deletes them when it
+  // receives this event
+  wm->postPortalEvent(PORTAL_EVENT_DONE, result, portMAX_DELAY);
+  vTaskDelete(NULL);
+}
+
+void WiFiManager::stopConfigPortalTask() {
+  uint8_t command = 0;
+
+  if (_portalCommands != NULL) {
+    xQueueSend(_portalCommands, &command, 0);
+  }
+}
+
+boolean WiFiManager::getPortalEvent(PortalEvent *event) {
+  if (_portalEvents == NULL ||
+      xQueueReceive(_portalEvents, event, 0) != pdTRUE) {
+    return false;
+  }
+  if (event->type == PORTAL_EVENT_DONE) {
+    vQueueDelete(_portalEvents);
+    vQueueDelete(_portalCommands);
+    _portalEvents = NULL;
+    _portalCommands = NULL;
+  }
+  return true;
+}
+
+UBaseType_t WiFiManager::getPortalTaskStackHighWaterMark() {
+  return _portalTaskStackHighWaterMark;
+}
+
+void WiFiManager::postPortalEvent(PortalEventType type, PortalResult result,
+                                  TickType_t wait) {
+  PortalEvent event;
+
+  event.type = type;
+  event.mode = status.mode;
+  event.result = result;
+  event.changes = _configChanges;
+  xQueueSend(_portalEvents, &event, wait);
+}
+#endif
+
+void WiFiManager::notifyStatus() {
+#if !defined(ESP8266)
+  if (_portalEvents != NULL) {
+    postPortalEvent(PORTAL_EVENT_STATUS, PORTAL_RUNNING, 0);
+    return;
+  }
+#endif
+  if (_statusCb) {
+    _statusCb(status);
+  }
+}
+
+void WiFiManager::notifyAPStarted() {
+#if !defined(ESP8266)
+  if (_portalEvents != NULL) {
+    postPortalEvent(PORTAL_EVENT_AP_STARTED, PORTAL_RUNNING, 0);
+    return;
+  }
+#endif
+  if (_apcallback != NULL) {
+    _apcallback(this);
+  }
+}
+
+/** Report the changes made in the portal, if there are any */
+void WiFiManager::notifyConfigSaved() {
+  if (_configChanges.fields == 0) {
+    DEBUG_WM(F("Configuration not changed"));
+    return;
+  }
+#if !defined(ESP8266)
+  if (_portalEvents != NULL) {
+    postPortalEvent(PORTAL_EVENT_CONFIG_SAVED, PORTAL_RUNNING, 0);
+    _configChanges = {0, 0};
+    return;
+  }
+#endif
+  if (_configChangedCallback != NULL) {
+    _configChangedCallback(_configChanges);
+  }
+  if (_savecallback != NULL) {
+    _savecallback();
+  }
+  _configChanges = {0, 0};
+}
+
+void WiFiManager::setPortalPhase(PortalPhase phase) {
+  _portalPhase = phase;
+  _portalPhaseStart = millis();
+}
+
+/** Connect to ssid; a hidden network gets one short attempt, see
+ * WIFI_MANAGER_HIDDEN_CONNECT_TIMEOUT */
+int WiFiManager::connectWifi(const char *ssid, const char *pass,
+                             bool hidden) {
   DEBUG_WM(F("Connecting as wifi client..."));
 
+  unsigned long start = millis();
+  _hiddenAttempt = hidden;
+  // first attempt uses the cached BSSID and channel if we have them
   int connRes = doConnectWifi(ssid, pass, 0);
-  if (connRes != WL_CONNECTED) {
+  if (connRes != WL_CONNECTED && !hidden) {
     // Connection failed; could be due to this issue where every 2nd connect
     // attempt fails: https://github.com/espressif/arduino-esp32/issues/234
     // As temporary workaround: try to connect for second time
     WiFi.disconnect(true);
     connRes = doConnectWifi(ssid, pass, 1);
   }
+  _hiddenAttempt = false;
   DEBUG_WM(F("Connection result: "));
   DEBUG_WM(connRes);
+  _connectDuration = millis() - start;
 
   if (WiFi.status() == WL_CONNECTED) {
+    saveConnectResult(ssid, true);
     status.mode = CONNECTED;
-  } else if (WiFi.status() == WL_DISCONNECTED) {
-    status.mode = DISCONNECTED;
+  } else {
+    saveConnectResult(ssid, false);
+    if (WiFi.status() == WL_DISCONNECTED) {
+      status.mode = DISCONNECTED;
+    }
   }
 
-  if (_statusCb) {
-    _statusCb(status);
-  }
+  notifyStatus();
 
   // not connected, WPS enabled, no pass - first attempt
-  if (_tryWPS && connRes != WL_CONNECTED && pass == "") {
+  if (_tryWPS && connRes != WL_CONNECTED && pass[0] == 0) {
+    startConnectTiming(2);
     startWPS();
     // should be connected at the end of WPS
     connRes = waitForConnectResult();
@@ -374,7 +1277,34 @@ int WiFiManager::connectWifi(String ssid, String pass) {
   return connRes;
 }
 
-int WiFiManager::doConnectWifi(String ssid, String pass, int count) {
+int WiFiManager::doConnectWifi(const char *ssid, const char *pass,
+                               int count) {
+  if (beginConnectWifi(ssid, pass, count)) {
+    return WL_CONNECTED;
+  }
+
+  int connRes = waitForConnectResult();
+
+  return connRes;
+}
+
+/** Start connecting without waiting for the result. Returns true if already
+ * connected */
+boolean WiFiManager::beginConnectWifi(const char *ssid, const char *pass,
+                                      int count) {
+  if (_wifiEvents == NULL) {
+    _wifiEvents = xEventGroupCreate();
+    _wifiEventId =
+        WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t info) {
+          uint8_t reason = 0;
+          if (event == WM_EVENT_STA_DISCONNECTED) {
+            reason = WM_DISCONNECT_REASON(info);
+          }
+          onWiFiEvent(event, reason);
+        });
+  }
+  startConnectTiming(count);
+
   // check if we've got static_ip settings, if we do, use those.
   if (_sta_static_ip) {
     if (count == 0) {
@@ -387,17 +1317,15 @@ int WiFiManager::doConnectWifi(String ssid, String pass, int count) {
   // fix for auto connect racing issue
   if (WiFi.status() == WL_CONNECTED) {
     status.mode = CONNECTED;
-    if (_statusCb) {
-      _statusCb(status);
-    }
+    notifyStatus();
     DEBUG_WM("Already connected. Bailing out.");
-    return WL_CONNECTED;
+    finishConnectTiming(WL_CONNECTED);
+    return true;
   }
   // check if we have ssid and pass and force those, if not, try with last saved
   // values
-  String hostname = getHostname();
   DEBUG_WM(F("Setting hostname to: "));
-  DEBUG_WM(hostname.c_str());
+  DEBUG_WM(_hostname);
 
   // Workaround for issue where ESP32 forgets its hostname when DHCP lease
   // renewal is required; see
@@ -411,11 +1339,21 @@ int WiFiManager::doConnectWifi(String ssid, String pass, int count) {
   //
   // WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
 
-  WiFi.setHostname(hostname.c_str());
-  if (ssid != "") {
-    WiFi.begin(ssid.c_str(), pass.c_str());
+  WiFi.setHostname(_hostname);
+  if (ssid[0] != 0) {
+    if (count == 0 && _cachedChannel != 0 && strcmp(ssid, _ssid) == 0) {
+      // directed connect; skips the scan of all channels
+      DEBUG_WM(F("Fast connect using cached BSSID and channel"));
+      _connectTiming.path = CONNECT_PATH_FAST;
+      _connectRecord->path = CONNECT_PATH_FAST;
+      WiFi.begin(ssid, pass, _cachedChannel, _cachedBssid);
+    } else {
+      _connectTiming.path = CONNECT_PATH_FULL;
+      _connectRecord->path = CONNECT_PATH_FULL;
+      WiFi.begin(ssid, pass);
+    }
   } else {
-    if (_ssid) {
+    if (_ssid[0] != 0) {
       if (count == 0) {
         DEBUG_WM(F("Connecting to network "));
         DEBUG_WM(_ssid);
@@ -439,42 +1377,842 @@ int WiFiManager::doConnectWifi(String ssid, String pass, int count) {
     }
   }
 
-  int connRes = waitForConnectResult();
+  return false;
+}
 
-  return connRes;
+/** Time an attempt gets to connect */
+unsigned long WiFiManager::attemptTimeout() {
+  unsigned long timeout =
+      (_connectTimeout == 0) ? DEFAULT_CONNECT_TIMEOUT : _connectTimeout;
+  if (_hiddenAttempt && timeout > WIFI_MANAGER_HIDDEN_CONNECT_TIMEOUT) {
+    timeout = WIFI_MANAGER_HIDDEN_CONNECT_TIMEOUT;
+  }
+  return timeout;
 }
 
 uint8_t WiFiManager::waitForConnectResult() {
-  if (_connectTimeout == 0) {
-    return WiFi.waitForConnectResult();
+  unsigned long timeout = attemptTimeout();
+  unsigned long elapsed = millis() - _connectStart;
+
+  DEBUG_WM(F("Waiting for connection result with time out"));
+  if (elapsed < timeout) {
+    // returns as soon as the IP has been assigned or the attempt failed
+    xEventGroupWaitBits(_wifiEvents,
+                        WIFI_EVENT_GOT_IP_BIT | WIFI_EVENT_FAILED_BIT, pdFALSE,
+                        pdFALSE, pdMS_TO_TICKS(timeout - elapsed));
+  }
+  int wifiStatus = pollConnectResult();
+  if (wifiStatus < 0) {
+    wifiStatus = WiFi.status();
+  }
+
+  if (wifiStatus == WL_CONNECTED) {
+    status.mode = CONNECTED;
   } else {
-    DEBUG_WM(F("Waiting for connection result with time out"));
-    unsigned long start = millis();
-    boolean keepConnecting = true;
-    uint8_t wifiStatus;
-    while (keepConnecting) {
-      wifiStatus = WiFi.status();
-      if (millis() > start + _connectTimeout) {
-        keepConnecting = false;
-        DEBUG_WM(F("Connection timed out"));
+    status.mode = DISCONNECTED;
+  }
+
+  notifyStatus();
+  return wifiStatus;
+}
+
+/** Non-blocking check of a connection attempt started with
+ * beginConnectWifi(). Returns -1 while still connecting */
+int WiFiManager::pollConnectResult() {
+  EventBits_t bits = xEventGroupGetBits(_wifiEvents);
+  unsigned long timeout = attemptTimeout();
+
+  int result = -1;
+
+  if (bits & WIFI_EVENT_GOT_IP_BIT) {
+    result = WL_CONNECTED;
+  } else if (bits & WIFI_EVENT_FAILED_BIT) {
+    result = WL_CONNECT_FAILED;
+  } else if (millis() - _connectStart >= timeout) {
+    DEBUG_WM(F("Connection timed out"));
+    result = WiFi.status();
+  }
+  if (result >= 0) {
+    finishConnectTiming(result);
+  }
+  return result;
+}
+
+/** Start timing a connect attempt and add a record for it to the log */
+void WiFiManager::startConnectTiming(uint8_t attempt) {
+  xEventGroupClearBits(_wifiEvents, WIFI_EVENT_CONNECTED_BIT |
+                                        WIFI_EVENT_GOT_IP_BIT |
+                                        WIFI_EVENT_FAILED_BIT);
+  _connectStart = millis();
+  _connectTiming.connected = -1;
+  _connectTiming.gotIp = -1;
+  _connectTiming.disconnected = -1;
+  _connectTiming.reason = 0;
+  _connectTiming.path = CONNECT_PATH_NONE;
+
+  checkConnectLog();
+  WiFiManagerConnectRecord *record = &connectLog.records[connectLog.head];
+  record->boot = connectLog.boot;
+  record->start = _connectStart;
+  record->scan = _connectScanTime;
+  record->connected = -1;
+  record->gotIp = -1;
+  record->disconnected = -1;
+  record->end = -1;
+  record->reason = 0;
+  record->attempt = attempt;
+  record->path = CONNECT_PATH_NONE;
+  record->result = WL_IDLE_STATUS;
+  connectLog.head = (connectLog.head + 1) % WIFI_MANAGER_CONNECT_LOG_SIZE;
+  if (connectLog.count < WIFI_MANAGER_CONNECT_LOG_SIZE) {
+    connectLog.count++;
+  }
+  _connectScanTime = -1;
+  _connectRecord = record;
+  invalidatePages();
+}
+
+void WiFiManager::finishConnectTiming(int result) {
+  if (_connectRecord == NULL) {
+    return;
+  }
+  _connectRecord->end = millis() - _connectStart;
+  _connectRecord->result = result;
+  _connectRecord = NULL;
+  invalidatePages();
+}
+
+int WiFiManager::getConnectLogCount() {
+  checkConnectLog();
+  return connectLog.count;
+}
+
+bool WiFiManager::getConnectLog(int index, WiFiManagerConnectRecord *record) {
+  checkConnectLog();
+  if (index < 0 || index >= connectLog.count) {
+    return false;
+  }
+  int i = (connectLog.head + WIFI_MANAGER_CONNECT_LOG_SIZE - 1 - index) %
+          WIFI_MANAGER_CONNECT_LOG_SIZE;
+  *record = connectLog.records[i];
+  return true;
+}
+
+void WiFiManager::clearConnectLog() {
+  checkConnectLog();
+  connectLog.head = 0;
+  connectLog.count = 0;
+  _connectRecord = NULL;
+  invalidatePages();
+}
+
+/** Called from the WiFi event task */
+void WiFiManager::onWiFiEvent(int event, uint8_t reason) {
+  int32_t elapsed = millis() - _connectStart;
+
+  WiFiManagerConnectRecord *record = _connectRecord;
+
+  if (event == WM_EVENT_STA_CONNECTED) {
+    _connectTiming.connected = elapsed;
+    if (record != NULL) {
+      record->connected = elapsed;
+    }
+    xEventGroupSetBits(_wifiEvents, WIFI_EVENT_CONNECTED_BIT);
+  } else if (event == WM_EVENT_STA_GOT_IP) {
+    _connectTiming.gotIp = elapsed;
+    if (record != NULL) {
+      record->gotIp = elapsed;
+    }
+    xEventGroupSetBits(_wifiEvents, WIFI_EVENT_GOT_IP_BIT);
+  } else if (event == WM_EVENT_STA_DISCONNECTED) {
+    _connectTiming.disconnected = elapsed;
+    _connectTiming.reason = reason;
+    if (record != NULL) {
+      record->disconnected = elapsed;
+      record->reason = reason;
+    }
+    xEventGroupClearBits(_wifiEvents, WIFI_EVENT_GOT_IP_BIT);
+    if (reason == WIFI_DISCONNECT_REASON_4WAY_HANDSHAKE_TIMEOUT ||
+        reason == WIFI_DISCONNECT_REASON_AUTH_FAIL ||
+        reason == WIFI_DISCONNECT_REASON_ASSOC_FAIL ||
+        reason == WIFI_DISCONNECT_REASON_HANDSHAKE_TIMEOUT ||
+        (reason == WIFI_DISCONNECT_REASON_NO_AP_FOUND &&
+         _connectTiming.path == CONNECT_PATH_FAST)) {
+      xEventGroupSetBits(_wifiEvents, WIFI_EVENT_FAILED_BIT);
+    }
+  }
+}
+
+WiFiManager::ConnectTiming WiFiManager::getLastConnectTiming() {
+  return _connectTiming;
+}
+
+unsigned long WiFiManager::getLastConnectDuration() { return _connectDuration; }
+
+unsigned long WiFiManager::getTimeToPortal() { return _timeToPortal; }
+
+int WiFiManager::findNetwork(const char *ssid) {
+  for (int i = 0; i < _networkCount; i++) {
+    if (strcmp(_networks[i].ssid, ssid) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/** Make a known network the one connectWifi() and the portal use */
+void WiFiManager::selectNetwork(int index) {
+  const WiFiManagerNetwork &network = _networks[index];
+
+  copyString(_ssid, network.ssid, sizeof(_ssid));
+  copyString(_pass, network.pass, sizeof(_pass));
+  memcpy(_cachedBssid, network.bssid, 6);
+  _cachedChannel = network.channel;
+}
+
+/** Read the settings in the configured format. Switching to the blob format
+ * converts the settings stored as keys */
+void WiFiManager::loadConfig() {
+  if (_configFormat == CONFIG_FORMAT_BLOB) {
+    if (loadConfigBlob()) {
+      // parameters added before the settings were read still have their
+      // defaults, which the next commitConfig() would store
+      for (size_t i = 0; i < _params.size(); i++) {
+        restoreParameter(_params[i]);
       }
-      if (wifiStatus == WL_CONNECTED || wifiStatus == WL_CONNECT_FAILED) {
-        keepConnecting = false;
+      if (!_params.empty()) {
+        invalidatePages();
       }
-      delay(100);
+      return;
     }
+    DEBUG_WM(F("No valid config blob; converting settings"));
+  }
 
-    if (wifiStatus == WL_CONNECTED) {
-      status.mode = CONNECTED;
-    } else if (wifiStatus == WL_CONNECT_FAILED) {
-      status.mode = CONNECTED;
+  _useHostname = preferences.getBool("useHostname", false);
+  if (_useHostname) {
+    if (preferences.getString("hostname", _hostname, sizeof(_hostname)) == 0) {
+      copyString(_hostname, "ESP", sizeof(_hostname));
+    }
+  }
+  loadNetworks();
+
+  if (_configFormat == CONFIG_FORMAT_BLOB) {
+    // the keys are only removed once the blob holds their values
+    _configDirty = CONFIG_KEY_ALL;
+    if (commitConfig() && _configSlot >= 0) {
+      preferences.remove("useHostname");
+      preferences.remove("hostname");
+      preferences.remove("networks");
     }
+  }
+}
+
+/** Read the known networks. The single network stored by older versions is
+ * converted on first use */
+void WiFiManager::loadNetworks() {
+  size_t len = preferences.getBytesLength("networks");
+
+  _networkCount = 0;
+  _networkSequence = 0;
+  if (len > 0 && len % sizeof(WiFiManagerNetwork) == 0 &&
+      len <= sizeof(_networks)) {
+    preferences.getBytes("networks", _networks, len);
+    _networkCount = len / sizeof(WiFiManagerNetwork);
+  } else if (preferences.getString("ssid", "") != "") {
+    DEBUG_WM(F("Converting stored network"));
+    WiFiManagerNetwork &network = _networks[0];
+    memset(&network, 0, sizeof(network));
+    strncpy(network.ssid, preferences.getString("ssid", "").c_str(),
+            sizeof(network.ssid) - 1);
+    strncpy(network.pass, preferences.getString("pass", "").c_str(),
+            sizeof(network.pass) - 1);
+    if (preferences.getBytes("bssid", network.bssid, 6) == 6) {
+      network.channel = preferences.getUChar("channel", 0);
+    }
+    network.lastSuccess = 1;
+    _networkCount = 1;
+    _configDirty |= CONFIG_KEY_NETWORKS;
+    if (commitConfig()) {
+      preferences.remove("ssid");
+      preferences.remove("pass");
+      preferences.remove("bssid");
+      preferences.remove("channel");
+    }
+  }
+
+  for (int i = 0; i < _networkCount; i++) {
+    if (_networks[i].lastSuccess > _networkSequence) {
+      _networkSequence = _networks[i].lastSuccess;
+    }
+  }
+}
 
-    if (_statusCb) {
-      _statusCb(status);
+bool WiFiManager::commitConfig() {
+  if (_configDirty == 0) {
+    return true;
+  }
+
+  bool preferences_was_already_opened = _preferences_opened;
+  if (not _preferences_opened) {
+    preferences.begin("WiFiManager", false);
+    _preferences_opened = true;
+  }
+
+  bool ok = true;
+  if (_configFormat == CONFIG_FORMAT_BLOB) {
+    ok = saveConfigBlob();
+  } else if (_configDirty & CONFIG_KEY_NETWORKS) {
+    if (_networkCount == 0) {
+      if (preferences.getBytesLength("networks") > 0) {
+        ok = preferences.remove("networks");
+        _configWrites++;
+      }
+    } else {
+      ok = putIfChanged("networks", _networks,
+                        _networkCount * sizeof(WiFiManagerNetwork));
+    }
+  }
+  if (_configFormat == CONFIG_FORMAT_KEYS &&
+      (_configDirty & CONFIG_KEY_HOSTNAME) && _useHostname) {
+    ok = putIfChanged("hostname", _hostname) && ok;
+    ok = putIfChanged("useHostname", true) && ok;
+  }
+  _configDirty = 0;
+
+  if (not preferences_was_already_opened) {
+    preferences.end();
+    _preferences_opened = false;
+  }
+  return ok;
+}
+
+/** Returns false if the value could not be written */
+bool WiFiManager::putIfChanged(const char *key, const void *value,
+                               size_t len) {
+  // room for the known networks, the only blob stored under a key of its own
+  uint8_t stored[WIFI_MANAGER_MAX_NETWORKS * sizeof(WiFiManagerNetwork)];
+
+  if (len <= sizeof(stored) && preferences.getBytesLength(key) == len &&
+      preferences.getBytes(key, stored, len) == len &&
+      memcmp(stored, value, len) == 0) {
+    return true;
+  }
+  _configWrites++;
+  size_t written = preferences.putBytes(key, value, len);
+  _configBytesWritten += written;
+  return written == len;
+}
+
+bool WiFiManager::putIfChanged(const char *key, const char *value) {
+  char current[65];
+  // fails if the key does not exist (or holds a longer string)
+  if (preferences.getString(key, current, sizeof(current)) > 0 &&
+      strcmp(current, value) == 0) {
+    return true;
+  }
+  _configWrites++;
+  size_t written = preferences.putString(key, value);
+  _configBytesWritten += written;
+  // the length of an empty string cannot tell a failure apart
+  return written > 0 || value[0] == 0;
+}
+
+bool WiFiManager::putIfChanged(const char *key, bool value) {
+  if (preferences.getUChar(key, 2) == value) {
+    return true;
+  }
+  _configWrites++;
+  size_t written = preferences.putBool(key, value);
+  _configBytesWritten += written;
+  return written > 0;
+}
+
+static uint32_t crc32(const uint8_t *data, size_t length,
+                      uint32_t crc = 0xffffffff) {
+  while (length-- > 0) {
+    crc ^= *data++;
+    for (int i = 0; i < 8; i++) {
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+  }
+  return crc;
+}
+
+static uint32_t configCRC(const WiFiManagerConfigHeader &header,
+                          const uint8_t *payload) {
+  uint32_t crc =
+      crc32((const uint8_t *)&header, offsetof(WiFiManagerConfigHeader, crc));
+  return ~crc32(payload, header.length, crc);
+}
+
+/** Read both slots and use the newest valid one. Returns false if there is
+ * none */
+bool WiFiManager::loadConfigBlob() {
+  std::unique_ptr<uint8_t[]> blob;
+  size_t blobLength = 0;
+  WiFiManagerConfigHeader header;
+
+  _configSlot = -1;
+  for (int slot = 0; slot < 2; slot++) {
+    size_t len = preferences.getBytesLength(configSlotKeys[slot]);
+    if (len < sizeof(header) || len > CONFIG_MAX_SIZE) {
+      continue;
+    }
+    std::unique_ptr<uint8_t[]> data(new uint8_t[len]);
+    if (preferences.getBytes(configSlotKeys[slot], data.get(), len) != len) {
+      continue;
+    }
+    memcpy(&header, data.get(), sizeof(header));
+    if (header.magic != CONFIG_MAGIC || header.version != CONFIG_VERSION ||
+        header.length != len - sizeof(header) ||
+        header.crc != configCRC(header, data.get() + sizeof(header))) {
+      DEBUG_WM(F("Invalid config slot:"));
+      DEBUG_WM(configSlotKeys[slot]);
+      continue;
+    }
+    if (_configSlot < 0 || (int32_t)(header.sequence - _configSequence) > 0) {
+      _configSlot = slot;
+      _configSequence = header.sequence;
+      _configCRC = header.crc;
+      blob = std::move(data);
+      blobLength = len;
+    }
+  }
+  if (_configSlot < 0) {
+    return false;
+  }
+
+  const uint8_t *p = blob.get() + sizeof(header);
+  const uint8_t *end = blob.get() + blobLength;
+
+  // hostname; the CRC was fine, so only check against the blob size to not
+  // trust a blob written by a buggy version blindly
+  if (end - p < 2 || end - p < 2 + p[1]) {
+    return false;
+  }
+  _useHostname = p[0];
+  if (_useHostname) {
+    size_t length = p[1] < sizeof(_hostname) ? p[1] : sizeof(_hostname) - 1;
+    memcpy(_hostname, p + 2, length);
+    _hostname[length] = 0;
+  }
+  p += 2 + p[1];
+
+  // networks
+  if (end - p < 1 || p[0] > WIFI_MANAGER_MAX_NETWORKS ||
+      (size_t)(end - p) < 1 + p[0] * sizeof(WiFiManagerNetwork)) {
+    return false;
+  }
+  _networkCount = p[0];
+  memcpy(_networks, p + 1, _networkCount * sizeof(WiFiManagerNetwork));
+  p += 1 + _networkCount * sizeof(WiFiManagerNetwork);
+  _networkSequence = 0;
+  for (int i = 0; i < _networkCount; i++) {
+    if (_networks[i].lastSuccess > _networkSequence) {
+      _networkSequence = _networks[i].lastSuccess;
+    }
+  }
+
+  // custom parameters; kept as is until they are added
+  _storedParamsLength = end - p;
+  _storedParams.reset(new uint8_t[_storedParamsLength]);
+  memcpy(_storedParams.get(), p, _storedParamsLength);
+  return true;
+}
+
+/** Step through the stored custom parameters. Returns false at the end */
+static bool nextStoredParameter(const uint8_t *&p, const uint8_t *end,
+                                const uint8_t **id, size_t *idLength,
+                                const uint8_t **value, size_t *valueLength) {
+  if (end - p < 1 || end - p < 3 + p[0]) {
+    return false;
+  }
+  *id = p + 1;
+  *idLength = p[0];
+  p += 1 + p[0];
+  *valueLength = p[0] | (p[1] << 8);
+  p += 2;
+  if ((size_t)(end - p) < *valueLength) {
+    return false;
+  }
+  *value = p;
+  p += *valueLength;
+  return true;
+}
+
+void WiFiManager::restoreParameter(WiFiManagerParameter *param) {
+  const uint8_t *p = _storedParams.get();
+  const uint8_t *end = p + _storedParamsLength;
+  const uint8_t *id;
+  const uint8_t *value;
+  size_t idLength;
+  size_t valueLength;
+
+  if (param->getID() == NULL || _storedParamsLength == 0) {
+    return;
+  }
+  for (int count = *p++; count > 0; count--) {
+    if (!nextStoredParameter(p, end, &id, &idLength, &value, &valueLength)) {
+      break;
+    }
+    if (idLength == strlen(param->getID()) &&
+        memcmp(id, param->getID(), idLength) == 0) {
+      // room for _length - 1 characters, like the form allows
+      size_t maxLength = param->_length > 1 ? param->_length - 1 : 0;
+      if (valueLength > maxLength) {
+        valueLength = maxLength;
+      }
+      memcpy(param->_value, value, valueLength);
+      param->_value[valueLength] = 0;
+      return;
+    }
+  }
+}
+
+/** Returns true if a parameter with this id was added */
+bool WiFiManager::hasParameter(const uint8_t *id, size_t idLength) {
+  char name[256];
+
+  memcpy(name, id, idLength);
+  name[idLength] = 0;
+  return findParameter(name) >= 0;
+}
+
+/** Write the settings to the slot that does not hold the newest version,
+ * unless they did not change. Stored custom parameters that were not added
+ * (yet) are kept. Returns false if the settings could not be written */
+bool WiFiManager::saveConfigBlob() {
+  uint8_t hostnameLength = _useHostname ? strlen(_hostname) : 0;
+  size_t length = 2 + hostnameLength + 1 +
+                  _networkCount * sizeof(WiFiManagerNetwork) + 1;
+  int count = 0;
+  const uint8_t *stored;
+  const uint8_t *storedEnd = _storedParams.get() + _storedParamsLength;
+  const uint8_t *id;
+  const uint8_t *value;
+  size_t idLength;
+  size_t valueLength;
+
+  for (size_t i = 0; i < _params.size(); i++) {
+    if (_params[i]->getID() != NULL) {
+      length += 3 + strlen(_params[i]->getID()) + strlen(_params[i]->_value);
+      count++;
+    }
+  }
+  stored = _storedParams.get() + (_storedParamsLength ? 1 : 0);
+  for (int i = _storedParamsLength ? _storedParams[0] : 0; i > 0; i--) {
+    if (!nextStoredParameter(stored, storedEnd, &id, &idLength, &value,
+                             &valueLength)) {
+      break;
+    }
+    if (!hasParameter(id, idLength)) {
+      length += 3 + idLength + valueLength;
+      count++;
+    }
+  }
+  if (sizeof(WiFiManagerConfigHeader) + length > CONFIG_MAX_SIZE) {
+    DEBUG_WM(F("Config too large; not saved"));
+    return false;
+  }
+
+  std::unique_ptr<uint8_t[]> blob(
+      new uint8_t[sizeof(WiFiManagerConfigHeader) + length]);
+  uint8_t *p = blob.get() + sizeof(WiFiManagerConfigHeader);
+
+  *p++ = _useHostname;
+  *p++ = hostnameLength;
+  memcpy(p, _hostname, hostnameLength);
+  p += hostnameLength;
+
+  *p++ = _networkCount;
+  memcpy(p, _networks, _networkCount * sizeof(WiFiManagerNetwork));
+  p += _networkCount * sizeof(WiFiManagerNetwork);
+
+  *p++ = count;
+  for (size_t i = 0; i < _params.size(); i++) {
+    const char *paramId = _params[i]->getID();
+    if (paramId == NULL) {
+      continue;
+    }
+    idLength = strlen(paramId);
+    valueLength = strlen(_params[i]->_value);
+    *p++ = idLength;
+    memcpy(p, paramId, idLength);
+    p += idLength;
+    *p++ = valueLength & 0xff;
+    *p++ = valueLength >> 8;
+    memcpy(p, _params[i]->_value, valueLength);
+    p += valueLength;
+  }
+  stored = _storedParams.get() + (_storedParamsLength ? 1 : 0);
+  for (int i = _storedParamsLength ? _storedParams[0] : 0; i > 0; i--) {
+    if (!nextStoredParameter(stored, storedEnd, &id, &idLength, &value,
+                             &valueLength)) {
+      break;
+    }
+    if (!hasParameter(id, idLength)) {
+      // copy the entry as is
+      memcpy(p, id - 1, 3 + idLength + valueLength);
+      p += 3 + idLength + valueLength;
+    }
+  }
+
+  WiFiManagerConfigHeader header;
+  header.magic = CONFIG_MAGIC;
+  header.version = CONFIG_VERSION;
+  header.length = length;
+  header.sequence = _configSequence + 1;
+  header.crc = configCRC(header, blob.get() + sizeof(header));
+
+  // the stored CRC includes its sequence number; computing this payload's
+  // CRC with that number tells whether anything changed
+  WiFiManagerConfigHeader current = header;
+  current.sequence = _configSequence;
+  if (_configSlot >= 0 &&
+      configCRC(current, blob.get() + sizeof(header)) == _configCRC) {
+    return true;
+  }
+  memcpy(blob.get(), &header, sizeof(header));
+
+  int slot = _configSlot < 0 ? 0 : _configSlot ^ 1;
+  size_t written = preferences.putBytes(configSlotKeys[slot], blob.get(),
+                                        sizeof(header) + length);
+  _configWrites++;
+  _configBytesWritten += written;
+  if (written != sizeof(header) + length) {
+    return false;
+  }
+  _configSlot = slot;
+  _configSequence = header.sequence;
+  _configCRC = header.crc;
+  return true;
+}
+
+void WiFiManager::setConfigFormat(ConfigFormat format) {
+  _configFormat = format;
+}
+
+unsigned long WiFiManager::getConfigLoadTime() { return _configLoadTime; }
+
+uint32_t WiFiManager::getConfigWriteCount() { return _configWrites; }
+
+uint32_t WiFiManager::getConfigBytesWritten() { return _configBytesWritten; }
+
+/** Update the statistics of a known network after a connect. On success the
+ * BSSID and channel are remembered so the next connect can skip the scan.
+ * Only written if something changed, so a device that keeps connecting to
+ * the same AP does not write at every boot */
+void WiFiManager::saveConnectResult(const char *ssid, bool connected) {
+  int i = findNetwork(ssid);
+  if (i < 0) {
+    return;
+  }
+  WiFiManagerNetwork &network = _networks[i];
+
+  if (!connected) {
+    if (network.failures < 255) {
+      network.failures++;
+      _configDirty |= CONFIG_KEY_NETWORKS;
+      commitConfig();
+    }
+    return;
+  }
+
+  uint8_t *bssid = WiFi.BSSID();
+  uint8_t channel = WiFi.channel();
+  bool changed = network.failures != 0;
+
+  network.failures = 0;
+  if (network.lastSuccess != _networkSequence || network.lastSuccess == 0) {
+    network.lastSuccess = ++_networkSequence;
+    changed = true;
+  }
+  if (bssid != NULL && channel != 0 &&
+      (channel != network.channel || memcmp(bssid, network.bssid, 6) != 0)) {
+    memcpy(network.bssid, bssid, 6);
+    network.channel = channel;
+    changed = true;
+  }
+  if (strcmp(ssid, _ssid) == 0) {
+    memcpy(_cachedBssid, network.bssid, 6);
+    _cachedChannel = network.channel;
+  }
+  if (changed) {
+    _configDirty |= CONFIG_KEY_NETWORKS;
+    commitConfig();
+  }
+}
+
+bool WiFiManager::addNetwork(const char *ssid, const char *pass,
+                             uint8_t priority, bool hidden) {
+  if (stageNetwork(ssid, pass, priority, hidden) < 0) {
+    return false;
+  }
+  commitConfig();
+  return true;
+}
+
+/** Add or update a known network without writing it yet. Returns its index,
+ * or -1 if ssid or pass is too long */
+int WiFiManager::stageNetwork(const char *ssid, const char *pass,
+                              uint8_t priority, bool hidden) {
+  if (ssid == NULL || ssid[0] == 0 || strlen(ssid) > 32 ||
+      (pass != NULL && strlen(pass) > 64)) {
+    return -1;
+  }
+
+  int i = findNetwork(ssid);
+  if (i < 0) {
+    if (_networkCount < WIFI_MANAGER_MAX_NETWORKS) {
+      i = _networkCount++;
+    } else {
+      // replace the least important network
+      i = 0;
+      for (int j = 1; j < _networkCount; j++) {
+        if (_networks[j].priority < _networks[i].priority ||
+            (_networks[j].priority == _networks[i].priority &&
+             _networks[j].lastSuccess < _networks[i].lastSuccess)) {
+          i = j;
+        }
+      }
+    }
+    memset(&_networks[i], 0, sizeof(WiFiManagerNetwork));
+    strcpy(_networks[i].ssid, ssid);
+  } else if (strcmp(_networks[i].pass, pass ? pass : "") != 0) {
+    // the old password may have been the reason for the failures
+    _networks[i].failures = 0;
+  }
+  strcpy(_networks[i].pass, pass ? pass : "");
+  _networks[i].priority = priority;
+  _networks[i].hidden = hidden;
+  _configDirty |= CONFIG_KEY_NETWORKS;
+
+  if (strcmp(_ssid, ssid) == 0 || findNetwork(_ssid) < 0) {
+    // updated, or the first network: "ESP" is not a known one
+    selectNetwork(i);
+  }
+  return i;
+}
+
+bool WiFiManager::removeNetwork(const char *ssid) {
+  int i = findNetwork(ssid);
+  if (i < 0) {
+    return false;
+  }
+  _networkCount--;
+  memmove(&_networks[i], &_networks[i + 1],
+          (_networkCount - i) * sizeof(WiFiManagerNetwork));
+  if (strcmp(_ssid, ssid) == 0) {
+    readNetworkCredentials();
+  }
+  _configDirty |= CONFIG_KEY_NETWORKS;
+  commitConfig();
+  return true;
+}
+
+int WiFiManager::getNetworkCount() { return _networkCount; }
+
+bool WiFiManager::getNetwork(int index, WiFiManagerNetwork *network) {
+  if (index < 0 || index >= _networkCount) {
+    return false;
+  }
+  *network = _networks[index];
+  return true;
+}
+
+/** Order in which known networks are tried: priority, then networks that did
+ * not fail, then the one that worked most recently, then the strongest */
+static bool networkIsBetter(const WiFiManagerNetwork &a, int8_t rssiA,
+                            const WiFiManagerNetwork &b, int8_t rssiB) {
+  if (a.priority != b.priority) {
+    return a.priority > b.priority;
+  }
+  if ((a.failures == 0) != (b.failures == 0)) {
+    return a.failures == 0;
+  }
+  if (a.lastSuccess != b.lastSuccess) {
+    return a.lastSuccess > b.lastSuccess;
+  }
+  return rssiA > rssiB;
+}
+
+/** Scan once and try the visible known networks, best first, going to the
+ * AP the scan saw directly. Of the known networks that were not seen, only
+ * hidden ones are tried after that, once each with a short timeout; the
+ * others are not around, and waiting for their timeouts would only delay
+ * the portal. Returns true if connected */
+boolean WiFiManager::connectKnownNetworks() {
+  // index into _scanResults of the strongest AP of each known network; -1 if
+  // it is not visible
+  int visible[WIFI_MANAGER_MAX_NETWORKS];
+  bool tried[WIFI_MANAGER_MAX_NETWORKS] = {};
+  boolean connected = false;
+
+  status.mode = SCANNING;
+  notifyStatus();
+
+  runScan(SCAN_RECONNECT);
+  _connectScanTime = _scanDuration[SCAN_RECONNECT];
+  for (int i = 0; i < _networkCount; i++) {
+    visible[i] = -1;
+    for (int j = 0; j < _scanResultCount; j++) {
+      if (strcmp(_scanResults[j].ssid, _networks[i].ssid) == 0 &&
+          (visible[i] < 0 ||
+           _scanResults[j].rssi > _scanResults[visible[i]].rssi)) {
+        visible[i] = j;
+      }
+    }
+  }
+
+  for (;;) {
+    int best = -1;
+    int8_t bestRssi = 0;
+    for (int i = 0; i < _networkCount; i++) {
+      if (tried[i]) {
+        continue;
+      }
+      int8_t rssi = visible[i] < 0 ? 0 : _scanResults[visible[i]].rssi;
+      if (best < 0 || (visible[i] >= 0 && visible[best] < 0) ||
+          ((visible[i] < 0) == (visible[best] < 0) &&
+           networkIsBetter(_networks[i], rssi, _networks[best], bestRssi))) {
+        best = i;
+        bestRssi = rssi;
+      }
+    }
+    if (best < 0) {
+      DEBUG_WM(F("Could not connect to a known network"));
+      break;
+    }
+    tried[best] = true;
+    bool hidden = visible[best] < 0;
+    if (hidden && !_networks[best].hidden) {
+      DEBUG_WM(F("Known network not visible: "));
+      DEBUG_WM(_networks[best].ssid);
+      continue;
+    }
+
+    selectNetwork(best);
+    if (!hidden) {
+      // the scan just saw this AP, so go there directly
+      const WiFiManagerScanResult &ap = _scanResults[visible[best]];
+      memcpy(_cachedBssid, ap.bssid, 6);
+      _cachedChannel = ap.channel;
+    } else {
+      DEBUG_WM(F("Hidden network not seen; trying once"));
+      _cachedChannel = 0;
+    }
+
+    DEBUG_WM(F("Connecting to network: "));
+    DEBUG_WM(_ssid);
+    if (connectWifi(_ssid, _pass, hidden) == WL_CONNECTED) {
+      connected = true;
+      break;
     }
-    return wifiStatus;
   }
+  if (_portalPhase == PORTAL_PHASE_IDLE) {
+    freeScanTable();
+  }
+  return connected;
 }
 
 void WiFiManager::startWPS() {
@@ -488,18 +2226,20 @@ void WiFiManager::startWPS() {
 #endif
 }
 
-String WiFiManager::getSSID() { return _ssid; }
+String WiFiManager::getSSID() { return getSSIDCStr(); }
 
-String WiFiManager::getPassword() { return _pass; }
+const char *WiFiManager::getSSIDCStr() { return _ssid; }
+
+String WiFiManager::getPassword() { return getPasswordCStr(); }
+
+const char *WiFiManager::getPasswordCStr() { return _pass; }
 
 String WiFiManager::getConfigPortalSSID() { return _apName; }
 
 void WiFiManager::resetSettings() {
   Mode mode_prev = status.mode;
   status.mode = ERASING;
-  if (_statusCb) {
-    _statusCb(status);
-  }
+  notifyStatus();
   DEBUG_WM(F("settings invalidated"));
   WiFi.disconnect(true);
 
@@ -518,6 +2258,18 @@ void WiFiManager::resetSettings() {
   preferences.remove("hostname");
   preferences.remove("ssid");
   preferences.remove("pass");
+  preferences.remove("bssid");
+  preferences.remove("channel");
+  preferences.remove("networks");
+  preferences.remove(configSlotKeys[0]);
+  preferences.remove(configSlotKeys[1]);
+  _configSlot = -1;
+  _storedParams.reset();
+  _storedParamsLength = 0;
+  _networkCount = 0;
+  _networkSequence = 0;
+  _cachedChannel = 0;
+  _useHostname = false;
   readHostname();
 
   if (not preferences_was_already_opened) {
@@ -526,9 +2278,7 @@ void WiFiManager::resetSettings() {
   }
 
   status.mode = mode_prev;
-  if (_statusCb) {
-    _statusCb(status);
-  }
+  notifyStatus();
 }
 
 void WiFiManager::setTimeout(unsigned long seconds) {
@@ -557,6 +2307,7 @@ void WiFiManager::setSTAStaticIPConfig(IPAddress ip, IPAddress gw,
   _sta_static_ip = ip;
   _sta_static_gw = gw;
   _sta_static_sn = sn;
+  invalidatePages();
 }
 
 void WiFiManager::setMinimumSignalQuality(int quality) {
@@ -567,6 +2318,16 @@ void WiFiManager::setBreakAfterConfig(boolean shouldBreak) {
   _shouldBreakAfterConfig = shouldBreak;
 }
 
+/** Send everything up to and including the start of the page body */
+void WiFiManager::sendPageHead(WiFiManagerPageWriter &page,
+                               const char *title) {
+  WiFiManagerSlot slots[] = {{'v', title}};
+  page.printTemplate(WM_HTTP_HEAD, slots);
+  page.print_P(WM_HTTP_ASSETS);
+  page.print(_customHeadElement);
+  page.print_P(WM_HTTP_HEAD_END);
+}
+
 /** Handle root or redirect to captive portal */
 void WiFiManager::handleRoot() {
   DEBUG_WM(F("Handle root"));
@@ -575,51 +2336,41 @@ void WiFiManager::handleRoot() {
     return;
   }
 
-  String page = FPSTR(WM_HTTP_HEAD);
-  page.replace("{v}", "Options");
-  page += FPSTR(WM_HTTP_SCRIPT);
-  page += FPSTR(WM_HTTP_STYLE);
-  page += _customHeadElement;
-  page += FPSTR(WM_HTTP_HEAD_END);
-  page += "<h1>";
-  page += getHostname().c_str();
-  page += "</h1>";
-  page += F("<h3>WiFiManager</h3>");
-  page += FPSTR(WM_HTTP_PORTAL_OPTIONS);
-  page += FPSTR(WM_HTTP_END);
-
-  server->sendHeader("Content-Length", String(page.length()));
-  server->send(200, "text/html", page);
+  WiFiManagerPageWriter page(server.get());
+  page.begin(200, "text/html");
+  sendPageHead(page, "Options");
+  page.print("<h1>");
+  page.print(_hostname);
+  page.print("</h1>");
+  page.print(F("<h3>WiFiManager</h3>"));
+  page.print_P(WM_HTTP_PORTAL_OPTIONS);
+  page.print_P(WM_HTTP_END);
+  page.end();
 }
 
 void WiFiManager::handleChangeName(bool showError) {
-  String page = FPSTR(WM_HTTP_HEAD);
-  page.replace("{v}", "Config ESP");
-  page += FPSTR(WM_HTTP_SCRIPT);
-  page += FPSTR(WM_HTTP_STYLE);
-  page += _customHeadElement;
-  page += FPSTR(WM_HTTP_HEAD_END);
+  WiFiManagerPageWriter page(server.get());
+  page.begin(200, "text/html");
+  sendPageHead(page, "Config ESP");
 
-  page += F("<h3>WiFiManager</h3>");
+  page.print(F("<h3>WiFiManager</h3>"));
 
   if (showError) {
-    page += FPSTR(WM_HTTP_CHANGE_NAME_ERROR_MSG);
+    page.print_P(WM_HTTP_CHANGE_NAME_ERROR_MSG);
   }
 
-  page += FPSTR(WM_HTTP_CHANGE_NAME_FORM_START);
-  page.replace("{p}", getHostname().c_str());
-
-  page += FPSTR(WM_HTTP_CHANGE_NAME_FORM_END);
+  WiFiManagerSlot slots[] = {{'p', _hostname}};
+  page.printTemplate(WM_HTTP_CHANGE_NAME_FORM_START, slots);
 
-  page += FPSTR(WM_HTTP_END);
+  page.print_P(WM_HTTP_CHANGE_NAME_FORM_END);
 
-  server->sendHeader("Content-Length", String(page.length()));
-  server->send(200, "text/html", page);
+  page.print_P(WM_HTTP_END);
+  page.end();
 
   DEBUG_WM(F("Sent config page"));
 }
 
-bool WiFiManager::checkName(String name) {
+bool WiFiManager::checkName(const String &name) {
   bool valid = true;
   char c;
 
@@ -647,279 +2398,610 @@ void WiFiManager::handleSaveName(void) {
   validName = checkName(tmp);
 
   if (validName) {
-    preferences.putString("hostname", tmp);
-    preferences.putBool("useHostname", true);
-    _hostname = tmp;
+    if (tmp != _hostname) {
+      _configChanges.fields |= CONFIG_HOSTNAME;
+    }
+    copyString(_hostname, tmp.c_str(), sizeof(_hostname));
+    _useHostname = true;
+    invalidatePages();
+    _configDirty |= CONFIG_KEY_HOSTNAME;
+    commitConfig();
     handleWifi(false);
   } else {
     handleChangeName(true);
   }
 }
 
-/** Wifi config page handler */
-void WiFiManager::handleWifi(boolean scan) {
-  int n;
-  bool scanBusy = false;
+static uint32_t ssidHash(const char *ssid) {
+  return fnv1a((const uint8_t *)ssid, strlen(ssid));
+}
 
-  if (captivePortal()) {  // If caprive portal redirect instead of displaying
-                          // the page.
-    return;
-  }
+static bool compareScanResultByKey(const WiFiManagerScanResult &a,
+                                   const WiFiManagerScanResult &b) {
+  return a.hash < b.hash;
+}
+
+static bool compareScanResultByRSSI(const WiFiManagerScanResult &a,
+                                    const WiFiManagerScanResult &b) {
+  return a.rssi > b.rssi;
+}
+
+/** Copy an AP from the driver's results into a scan result */
+static void setScanResult(WiFiManagerScanResult &ap, const String &ssid,
+                          uint32_t hash, uint8_t auth, int32_t rssi,
+                          const uint8_t *bssid, int32_t channel) {
+  strncpy(ap.ssid, ssid.c_str(), sizeof(ap.ssid) - 1);
+  ap.ssid[sizeof(ap.ssid) - 1] = 0;
+  ap.hash = hash;
+  ap.rssi = rssi;
+  ap.channel = channel;
+  ap.auth = auth;
+  memcpy(ap.bssid, bssid, sizeof(ap.bssid));
+  ap.bssidCount = 1;
+}
 
-  n = WiFi.scanComplete();
-  if (n < 0) {
-    scanBusy = true;
+/** Add the results of a finished (single channel) scan to _scanResults and
+ * free the driver's copy. If _removeDuplicateAPs is set, an AP of an SSID
+ * that is already there is merged into it while copying, keeping the
+ * strongest, so WIFI_MANAGER_MAX_SCAN_RESULTS counts networks and not APs.
+ * Once the table is full, a new entry replaces the weakest one if it is
+ * stronger */
+void WiFiManager::addScanResults(int n) {
+  String ssid;
+  uint8_t auth;
+  int32_t rssi;
+  uint8_t *bssid;
+  int32_t channel;
+  int dropped = 0;
+
+  if (n < 0 || !_scanResults) {
+    n = 0;
   } else {
-    n_wifi_networks = n;
+    _scanChannelsDone++;
   }
 
-  if (scan) {
-    if (scanBusy == false) {
-      /* Scan does not seem to work without disconnecting first */
-      WiFi.disconnect(true);
-      n_wifi_networks = 0;
-      WiFi.scanNetworks(true);
-      scanBusy = true;
+  for (int i = 0; i < n; i++) {
+    WiFi.getNetworkInfo(i, ssid, auth, rssi, bssid, channel);
+    uint32_t hash = ssidHash(ssid.c_str());
+
+    int same = -1;
+    for (int j = 0; _removeDuplicateAPs && j < _scanRawCount; j++) {
+      if (_scanResults[j].hash == hash &&
+          strncmp(_scanResults[j].ssid, ssid.c_str(),
+                  sizeof(_scanResults[j].ssid) - 1) == 0) {
+        same = j;
+        break;
+      }
+    }
+    if (same >= 0) {
+      WiFiManagerScanResult &ap = _scanResults[same];
+      uint8_t count = ap.bssidCount;
+      if (rssi > ap.rssi) {
+        setScanResult(ap, ssid, hash, auth, rssi, bssid, channel);
+      }
+      ap.bssidCount = count < 255 ? count + 1 : count;
+      continue;
+    }
+
+    int slot = _scanRawCount;
+    if (slot == WIFI_MANAGER_MAX_SCAN_RESULTS) {
+      slot = 0;
+      for (int j = 1; j < _scanRawCount; j++) {
+        if (_scanResults[j].rssi < _scanResults[slot].rssi) {
+          slot = j;
+        }
+      }
+      dropped++;
+      if (rssi <= _scanResults[slot].rssi) {
+        continue;
+      }
     } else {
-      DEBUG_WM(F("Scan busy; not starting another one"));
+      _scanRawCount++;
     }
+    setScanResult(_scanResults[slot], ssid, hash, auth, rssi, bssid, channel);
+  }
+  WiFi.scanDelete();
+  if (dropped > 0) {
+    DEBUG_WM(F("Too many scan results; weakest dropped:"));
+    DEBUG_WM(dropped);
   }
+}
+
+/** Turn the collected scan results into the list that is shown, strongest
+ * first. RSSI is averaged with the previous scan so the order of the list
+ * does not jump around */
+void WiFiManager::finishScan() {
+  int n = _scanRawCount;
 
-  String page = FPSTR(WM_HTTP_HEAD);
-  page.replace("{v}", "Config ESP");
-  page += FPSTR(WM_HTTP_SCRIPT);
-  page += FPSTR(WM_HTTP_STYLE);
-  page += _customHeadElement;
-  if (scanBusy) {
-    // Scan busy; enable auto refresh
-    page += FPSTR(WM_HTTP_HEAD_REFRESH);
+  _scanInFlight = false;
+  if (_scanChannelsDone == 0) {
+    // nothing was scanned; the previous results and their age still hold
+    DEBUG_WM(F("Scan failed; keeping the previous results"));
+    return;
   }
-  page += FPSTR(WM_HTTP_HEAD_END);
 
-  page += "<h1>";
-  page += getHostname().c_str();
-  page += "</h1>";
-  page += F("<center>(<a href=\"/changename\">change name</a>)</center>");
-  page += F("<h3>WiFiManager</h3>");
+  if (!_removeDuplicateAPs) {
+    // every AP is listed on its own; smooth per BSSID
+    for (int i = 0; i < n; i++) {
+      _scanResults[i].hash = fnv1a(_scanResults[i].bssid, 6);
+    }
+  }
+  // the SSIDs are unique already if duplicates are removed
+  std::sort(_scanResults.get(), _scanResults.get() + n,
+            compareScanResultByKey);
+
+  // both lists are sorted by key; merge them
+  int h = 0;
+  for (int i = 0; i < n; i++) {
+    WiFiManagerScanResult &ap = _scanResults[i];
+    while (h < _rssiHistoryCount && _rssiHistory[h].key < ap.hash) {
+      h++;
+    }
+    if (h < _rssiHistoryCount && _rssiHistory[h].key == ap.hash) {
+      ap.rssi = (_rssiHistory[h].rssi + ap.rssi) / 2;
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    _rssiHistory[i].key = _scanResults[i].hash;
+    _rssiHistory[i].rssi = _scanResults[i].rssi;
+  }
+  _rssiHistoryCount = n;
 
-  if (scanBusy) {
-    page += F("Scan busy. Please wait.");
-    page += FPSTR(WM_HTTP_BODY_REFRESH);
-  } else {
-    DEBUG_WM(F("Scan done"));
+  if (!_removeDuplicateAPs) {
+    for (int i = 0; i < n; i++) {
+      _scanResults[i].hash = ssidHash(_scanResults[i].ssid);
+    }
+  }
+  std::sort(_scanResults.get(), _scanResults.get() + n,
+            compareScanResultByRSSI);
+  _scanResultCount = n;
+  _scanCompleted = millis();
+  _scanGeneration++;
+  _scanDuration[_scanPurpose] = _scanCompleted - _scanStarted;
+  DEBUG_WM(F("Scan done; duration (ms):"));
+  DEBUG_WM(_scanDuration[_scanPurpose]);
+}
 
-    if (n_wifi_networks == 0) {
-      DEBUG_WM(F("No networks found"));
-      page += F("No networks found. Refresh to scan again.");
-    } else {
-      // sort networks
-      int indices[n_wifi_networks];
-      for (int i = 0; i < n_wifi_networks; i++) {
-        indices[i] = i;
-      }
+/** Start scanning the next channel of the current profile. Returns false if
+ * there are no channels left */
+boolean WiFiManager::startScanChannel(boolean async) {
+  const WiFiManagerScanProfile &profile = _scanProfiles[_scanPurpose];
+  uint8_t channel = 0;  // all channels
 
-      // RSSI SORT
+  if (_scanChannelsLeft == 0) {
+    return false;
+  }
+  if (_scanChannelsLeft != SCAN_ALL_CHANNELS) {
+    while (!(_scanChannelsLeft & (1 << channel))) {
+      channel++;
+    }
+  }
+  _scanChannelsLeft &= ~(1 << channel);
+
+  int n = WiFi.scanNetworks(async, profile.showHidden, profile.passive,
+                            profile.dwellTime ? profile.dwellTime : 300,
+                            channel);
+  if (!async) {
+    addScanResults(n);
+  } else if (n == WIFI_SCAN_FAILED) {
+    DEBUG_WM(F("Failed to start scan"));
+    return startScanChannel(async);
+  }
+  return true;
+}
 
-      // old sort
-      for (int i = 0; i < n_wifi_networks; i++) {
-        for (int j = i + 1; j < n_wifi_networks; j++) {
-          if (WiFi.RSSI(indices[j]) > WiFi.RSSI(indices[i])) {
-            std::swap(indices[i], indices[j]);
-          }
-        }
-      }
+void WiFiManager::prepareScan(ScanPurpose purpose) {
+  _scanPurpose = purpose;
+  _scanStarted = millis();
+  _scanRawCount = 0;
+  _scanChannelsDone = 0;
+  _scanChannelsLeft = _scanProfiles[purpose].channels;
+  if (_scanChannelsLeft == 0) {
+    _scanChannelsLeft = SCAN_ALL_CHANNELS;
+  }
+  if (!allocateScanTable()) {
+    // nothing to scan into; finishScan() keeps the previous results
+    _scanChannelsLeft = 0;
+  }
+}
 
-      /*std::sort(indices, indices + n_wifi_networks , [](const int & a, const
-        int & b) -> bool
-        {
-        return WiFi.RSSI(a) > WiFi.RSSI(b);
-        });*/
-
-      // remove duplicates ( must be RSSI sorted )
-      if (_removeDuplicateAPs) {
-        String cssid;
-        for (int i = 0; i < n_wifi_networks; i++) {
-          if (indices[i] == -1) continue;
-          cssid = WiFi.SSID(indices[i]);
-          for (int j = i + 1; j < n_wifi_networks; j++) {
-            if (cssid == WiFi.SSID(indices[j])) {
-              DEBUG_WM("DUP AP: " + WiFi.SSID(indices[j]));
-              indices[j] = -1;  // set dup aps to index -1
-            }
-          }
-        }
-      }
+/** Allocate the scan results and RSSI history unless they already are.
+ * Returns false if out of memory */
+bool WiFiManager::allocateScanTable() {
+  const size_t size = WIFI_MANAGER_MAX_SCAN_RESULTS;
 
-      // display networks in page
-      if (n_wifi_networks > 0) {
-        page += F("Found the following networks:");
-      } else {
-        page += F("No networks found. Refresh to scan again.");
-      }
-      for (int i = 0; i < n_wifi_networks; i++) {
-        if (indices[i] == -1) continue;  // skip dups
-        DEBUG_WM(WiFi.SSID(indices[i]));
-        DEBUG_WM(WiFi.RSSI(indices[i]));
-        int quality = getRSSIasQuality(WiFi.RSSI(indices[i]));
-
-        if (_minimumQuality == -1 || _minimumQuality < quality) {
-          String item = FPSTR(WM_HTTP_ITEM);
-          String rssiQ;
-          rssiQ += quality;
-          item.replace("{v}", WiFi.SSID(indices[i]));
-          item.replace("{r}", rssiQ);
-#if defined(ESP8266)
-          if (WiFi.encryptionType(indices[i]) != ENC_TYPE_NONE)
-#else
-          if (WiFi.encryptionType(indices[i]) != WIFI_AUTH_OPEN)
-#endif
-          {
-            item.replace("{i}", "l");
-          } else {
-            item.replace("{i}", "");
-          }
-          // DEBUG_WM(item);
-          page += item;
-          delay(0);
-        } else {
-          DEBUG_WM(F("Skipping due to quality"));
-        }
-      }
-      page += "<br/>";
-    }
+  if (!_scanResults) {
+    _scanResults.reset(new (std::nothrow) WiFiManagerScanResult[size]);
+  }
+  if (!_rssiHistory) {
+    _rssiHistory.reset(new (std::nothrow) RssiSample[size]);
+  }
+  if (!_scanResults || !_rssiHistory) {
+    DEBUG_WM(F("Out of memory; cannot scan"));
+    freeScanTable();
+    return false;
+  }
+  return true;
+}
 
-    page += FPSTR(WM_HTTP_FORM_START);
-    char parLength[2];
-    // add the extra parameters to the form
-    for (int i = 0; i < _paramsCount; i++) {
-      if (_params[i] == NULL) {
-        break;
-      }
+/** Free the scan results; the next scan starts without history */
+void WiFiManager::freeScanTable() {
+  _scanResults.reset();
+  _rssiHistory.reset();
+  _scanResultCount = 0;
+  _rssiHistoryCount = 0;
+  _scanRawCount = 0;
+  _scanGeneration = 0;  // no results
+}
 
-      String pitem = FPSTR(WM_HTTP_FORM_PARAM);
-      if (_params[i]->getID() != NULL) {
-        pitem.replace("{i}", _params[i]->getID());
-        pitem.replace("{n}", _params[i]->getID());
-        pitem.replace("{p}", _params[i]->getPlaceholder());
-        snprintf(parLength, 2, "%d", _params[i]->getValueLength());
-        pitem.replace("{l}", parLength);
-        pitem.replace("{v}", _params[i]->getValue());
-        pitem.replace("{c}", _params[i]->getCustomHTML());
-      } else {
-        pitem = _params[i]->getCustomHTML();
-      }
+/** Scan all channels of the profile and wait for the results */
+void WiFiManager::runScan(ScanPurpose purpose) {
+  prepareScan(purpose);
+  _scanInFlight = true;
+  while (startScanChannel(false)) {
+  }
+  finishScan();
+}
+
+/** Start a background scan unless one is already running. The station link
+ * is only torn down if it is not connected (a connection attempt in progress
+ * blocks scanning) */
+void WiFiManager::startScan(ScanPurpose purpose) {
+  if (_scanInFlight) {
+    DEBUG_WM(F("Scan busy; not starting another one"));
+    return;
+  }
+  if (_portalPhase == PORTAL_PHASE_STARTING ||
+      _portalPhase == PORTAL_PHASE_CONNECT_DELAY ||
+      _portalPhase == PORTAL_PHASE_CONNECTING) {
+    // would disturb the AP while it settles or abort the connection attempt
+    return;
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    // keep the station interface enabled; the AP keeps running
+    WiFi.disconnect();
+  }
+  prepareScan(purpose);
+  _scanInFlight = startScanChannel(true);
+  if (!_scanInFlight) {
+    finishScan();
+  }
+}
 
-      page += pitem;
+/** Collect the results of a background scan once it is done */
+void WiFiManager::pollScan() {
+  if (!_scanInFlight) {
+    return;
+  }
+  int n = WiFi.scanComplete();
+  if (n != WIFI_SCAN_RUNNING) {
+    addScanResults(n);
+    if (!startScanChannel(true)) {
+      finishScan();
     }
-    if (_params[0] != NULL) {
-      page += "<br/>";
+  }
+}
+
+void WiFiManager::setScanProfile(ScanPurpose purpose,
+                                 const WiFiManagerScanProfile &profile) {
+  _scanProfiles[purpose] = profile;
+}
+
+unsigned long WiFiManager::getLastScanDuration(ScanPurpose purpose) {
+  return _scanDuration[purpose];
+}
+
+/** Rough progress of the running scan in percent. Channel subsets are counted
+ * per channel; a scan of all channels is compared with the last one */
+int WiFiManager::getScanProgress() {
+  if (!_scanInFlight) {
+    return 100;
+  }
+
+  uint16_t channels = _scanProfiles[_scanPurpose].channels;
+  if (channels != 0 && channels != SCAN_ALL_CHANNELS) {
+    int total = 0;
+    int left = 1;  // the one being scanned
+    for (int i = 0; i < 16; i++) {
+      total += (channels >> i) & 1;
+      left += (_scanChannelsLeft >> i) & 1;
     }
+    return 100 * (total - left) / total;
+  }
+
+  unsigned long expected = _scanDuration[_scanPurpose];
+  if (expected == 0) {
+    expected = 14 * 150;  // 14 channels, a bit over the default active dwell
+  }
+  unsigned long elapsed = millis() - _scanStarted;
+  return elapsed >= expected ? 99 : 100 * elapsed / expected;
+}
 
-    if (_sta_static_ip) {
-      String item = FPSTR(WM_HTTP_FORM_PARAM);
-      item.replace("{i}", "ip");
-      item.replace("{n}", "ip");
-      item.replace("{p}", "Static IP");
-      item.replace("{l}", "15");
-      item.replace("{v}", _sta_static_ip.toString());
+boolean WiFiManager::scanIsStale() {
+  return _scanGeneration == 0 || millis() - _scanCompleted >= _scanCacheTTL;
+}
 
-      page += item;
+void WiFiManager::setScanCacheTTL(unsigned long seconds) {
+  _scanCacheTTL = seconds * 1000;
+}
 
-      item = FPSTR(WM_HTTP_FORM_PARAM);
-      item.replace("{i}", "gw");
-      item.replace("{n}", "gw");
-      item.replace("{p}", "Static Gateway");
-      item.replace("{l}", "15");
-      item.replace("{v}", _sta_static_gw.toString());
+/** Bytes of a page being rendered to keep for the page cache. None while the
+ * heap is too low to cache it, so the page buffer is all the page uses */
+static size_t pageCopyLimit() {
+  if (ESP.getFreeHeap() < WIFI_MANAGER_PAGE_CACHE_MIN_HEAP) {
+    return 0;
+  }
+  return WIFI_MANAGER_PAGE_CACHE_SIZE;
+}
 
-      page += item;
+static bool sameGroup(const char *a, const char *b) {
+  return a == b || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
 
-      item = FPSTR(WM_HTTP_FORM_PARAM);
-      item.replace("{i}", "sn");
-      item.replace("{n}", "sn");
-      item.replace("{p}", "Subnet");
-      item.replace("{l}", "15");
-      item.replace("{v}", _sta_static_sn.toString());
+/** Wifi config page handler */
+void WiFiManager::handleWifi(boolean scan) {
+  if (captivePortal()) {  // If caprive portal redirect instead of displaying
+                          // the page.
+    return;
+  }
+  CachedPage cached = scan ? PAGE_WIFI : PAGE_WIFI_NO_SCAN;
+  if (sendCachedPage(cached)) {
+    return;
+  }
 
-      page += item;
+  WiFiManagerPageWriter page(server.get());
+  page.keepCopy(pageCopyLimit());
+  page.begin(200, "text/html");
+  sendPageHead(page, "Config ESP");
+
+  page.print("<h1>");
+  page.print(_hostname);
+  page.print("</h1>");
+  page.print(F("<center>(<a href=\"/changename\">change name</a>)</center>"));
+  page.print(F("<h3>WiFiManager</h3>"));
+
+  // the list of networks is filled in by the browser from /scan.json
+  WiFiManagerSlot listSlots[] = {{'s', scan ? "1" : "0"}};
+  page.printTemplate(WM_HTTP_SCAN_LIST, listSlots);
+
+  page.print_P(WM_HTTP_FORM_START);
+  char parLength[12];
+  // add the extra parameters to the form, a group at a time in the order
+  // the groups were first used
+  for (size_t i = 0; i < _params.size(); i++) {
+    const char *group = _params[i]->getGroup();
+    bool rendered = false;
+    for (size_t j = 0; j < i && !rendered; j++) {
+      rendered = sameGroup(_params[j]->getGroup(), group);
+    }
+    if (rendered) {
+      continue;
+    }
+    if (group != NULL) {
+      WiFiManagerSlot groupSlots[] = {{'g', group}};
+      page.printTemplate(WM_HTTP_FORM_GROUP, groupSlots);
+    }
 
-      page += "<br/>";
+    for (size_t j = i; j < _params.size(); j++) {
+      WiFiManagerParameter *param = _params[j];
+      if (!sameGroup(param->getGroup(), group)) {
+        continue;
+      }
+      if (param->getID() != NULL) {
+        snprintf(parLength, sizeof(parLength), "%d", param->getValueLength());
+        WiFiManagerSlot slots[] = {{'i', param->getID()},
+                                   {'n', param->getID()},
+                                   {'p', param->getPlaceholder()},
+                                   {'l', parLength},
+                                   {'v', param->getValue()},
+                                   {'c', param->getCustomHTML()}};
+        page.printTemplate(WM_HTTP_FORM_PARAM, slots);
+      } else {
+        page.print(param->getCustomHTML());
+      }
     }
+  }
+  if (!_params.empty()) {
+    page.print("<br/>");
+  }
 
-    page += FPSTR(WM_HTTP_FORM_END);
-    page += FPSTR(WM_HTTP_SCAN_LINK);
+  if (_sta_static_ip) {
+    char ip[IP_STRING_SIZE];
+    char gw[IP_STRING_SIZE];
+    char sn[IP_STRING_SIZE];
+    formatIp(ip, _sta_static_ip);
+    formatIp(gw, _sta_static_gw);
+    formatIp(sn, _sta_static_sn);
+    WiFiManagerSlot ipSlots[] = {{'i', "ip"}, {'n', "ip"},
+                                 {'p', "Static IP"}, {'l', "15"},
+                                 {'v', ip}, {'c', ""}};
+    WiFiManagerSlot gwSlots[] = {{'i', "gw"}, {'n', "gw"},
+                                 {'p', "Static Gateway"}, {'l', "15"},
+                                 {'v', gw}, {'c', ""}};
+    WiFiManagerSlot snSlots[] = {{'i', "sn"}, {'n', "sn"},
+                                 {'p', "Subnet"}, {'l', "15"},
+                                 {'v', sn}, {'c', ""}};
+    page.printTemplate(WM_HTTP_FORM_PARAM, ipSlots);
+    page.printTemplate(WM_HTTP_FORM_PARAM, gwSlots);
+    page.printTemplate(WM_HTTP_FORM_PARAM, snSlots);
+
+    page.print("<br/>");
   }
 
-  page += FPSTR(WM_HTTP_END);
+  page.print_P(WM_HTTP_FORM_END);
+  page.print_P(WM_HTTP_SCAN_LINK);
 
-  server->sendHeader("Content-Length", String(page.length()));
-  server->send(200, "text/html", page);
+  page.print_P(WM_HTTP_END);
+  page.end();
+  cachePage(cached, page);
 
   DEBUG_WM(F("Sent config page"));
 }
 
+/** Scan results as JSON, used by the config page to render the list of
+ * networks. With the "scan" argument a new scan is started if the cached
+ * results are too old */
+void WiFiManager::handleScanJSON() {
+  pollScan();
+  if (server->hasArg("scan") && scanIsStale()) {
+    // the cached results are returned meanwhile, if there are any
+    startScan(SCAN_PORTAL_REFRESH);
+  }
+
+  server->sendHeader("Cache-Control", "no-store");
+  WiFiManagerPageWriter page(server.get());
+  page.begin(200, "application/json");
+  page.print(F("{\"busy\":"));
+  // the first scan has not finished yet, or not even started if the AP is
+  // still settling
+  bool busy = _scanGeneration == 0 &&
+              (_scanInFlight || _portalPhase == PORTAL_PHASE_STARTING);
+  page.print(busy ? "true" : "false");
+  page.print(F(",\"scanning\":"));
+  page.print(_scanInFlight ? "true" : "false");
+  page.print(F(",\"progress\":"));
+  page.print((uint32_t)(busy && !_scanInFlight ? 0 : getScanProgress()));
+  page.print(F(",\"networks\":["));
+
+  bool first = true;
+  for (int i = 0; i < _scanResultCount; i++) {
+    const WiFiManagerScanResult &ap = _scanResults[i];
+    int quality = getRSSIasQuality(ap.rssi);
+
+    if (_minimumQuality != -1 && _minimumQuality >= quality) {
+      continue;
+    }
+    page.print(first ? "{\"ssid\":" : ",{\"ssid\":");
+    page.printJSON(ap.ssid);
+    page.print(F(",\"rssi\":"));
+    page.print((int32_t)ap.rssi);
+    page.print(F(",\"quality\":"));
+    page.print((uint32_t)quality);
+    page.print(F(",\"auth\":"));
+    page.print((uint32_t)ap.auth);
+    page.print(F(",\"channel\":"));
+    page.print((uint32_t)ap.channel);
+    page.print("}");
+    first = false;
+  }
+  page.print("]}");
+  page.end();
+}
+
 /** Handle the WLAN save form and redirect to WLAN config page again */
 void WiFiManager::handleWifiSave() {
   DEBUG_WM(F("WiFi save"));
 
   // SAVE/connect here
-  _ssid = server->arg("s").c_str();
-  _pass = server->arg("p").c_str();
-
-  DEBUG_WM("Network: " + _ssid);
-  DEBUG_WM("Password: " + _pass);
-
-  preferences.putString("ssid", _ssid);
-  preferences.putString("pass", _pass);
-
-  // parameters
-  for (int i = 0; i < _paramsCount; i++) {
-    if (_params[i] == NULL) {
-      break;
+  ConfigChanges &changes = _configChanges;
+  const String &ssid = server->arg("s");
+  const String &pass = server->arg("p");
+  if (ssid != _ssid) {
+    changes.fields |= CONFIG_SSID;
+  }
+  if (pass != _pass) {
+    changes.fields |= CONFIG_PASSWORD;
+  }
+  copyString(_ssid, ssid.c_str(), sizeof(_ssid));
+  copyString(_pass, pass.c_str(), sizeof(_pass));
+
+  DEBUG_WM(F("Network: "));
+  DEBUG_WM(_ssid);
+  DEBUG_WM(F("Password: "));
+  DEBUG_WM(_pass);
+
+  // addNetwork() selects the network, which restores its BSSID and channel
+  // if it was already known. An SSID typed in that the scan did not list is
+  // taken to be hidden
+  int i = findNetwork(_ssid);
+  bool hidden = _scanResultCount > 0;
+  for (int j = 0; j < _scanResultCount && hidden; j++) {
+    hidden = strcmp(_scanResults[j].ssid, _ssid) != 0;
+  }
+  _cachedChannel = 0;
+  stageNetwork(_ssid, _pass, i < 0 ? 0 : _networks[i].priority, hidden);
+
+  // parameters; one pass over the submitted fields
+  std::vector<bool> &submitted = _paramSubmitted;
+  submitted.assign(_params.size(), false);
+  for (int arg = 0; arg < server->args(); arg++) {
+    int i = findParameter(server->argName(arg).c_str());
+    if (i < 0) {
+      continue;
     }
+    submitted[i] = true;
+    WiFiManagerParameter *param = _params[i];
     // read parameter
-    String value = server->arg(_params[i]->getID()).c_str();
-    // store it in array
-    value.toCharArray(_params[i]->_value, _params[i]->_length);
+    const String &value = server->arg(arg);
+    // store it in array, cut to the length of the parameter
+    size_t length = param->_length > 1 ? param->_length - 1 : 0;
+    if (value.length() < length) {
+      length = value.length();
+    }
+    if (strlen(param->_value) != length ||
+        strncmp(param->_value, value.c_str(), length) != 0) {
+      changes.fields |= CONFIG_PARAMETERS;
+      if (i < 32) {
+        changes.parameters |= 1UL << i;
+      }
+      _configDirty |= CONFIG_KEY_PARAMETERS;
+    }
+    value.toCharArray(param->_value, param->_length);
     DEBUG_WM(F("Parameter: "));
-    DEBUG_WM(_params[i]->getID());
+    DEBUG_WM(param->getID());
     DEBUG_WM(F("Value: "));
     DEBUG_WM(value);
   }
+  // a browser leaves out fields without a value, like unchecked checkboxes
+  for (size_t i = 0; i < _params.size(); i++) {
+    WiFiManagerParameter *param = _params[i];
+    if (submitted[i] || param->_value == NULL || param->_value[0] == 0) {
+      continue;
+    }
+    param->_value[0] = 0;
+    changes.fields |= CONFIG_PARAMETERS;
+    if (i < 32) {
+      changes.parameters |= 1UL << i;
+    }
+    _configDirty |= CONFIG_KEY_PARAMETERS;
+  }
 
+  IPAddress ip = _sta_static_ip;
+  IPAddress gw = _sta_static_gw;
+  IPAddress sn = _sta_static_sn;
   if (server->arg("ip") != "") {
     DEBUG_WM(F("static ip: "));
     DEBUG_WM(server->arg("ip"));
     //_sta_static_ip.fromString(server->arg("ip"));
-    String ip = server->arg("ip");
-    optionalIPFromString(&_sta_static_ip, ip.c_str());
+    optionalIPFromString(&_sta_static_ip, server->arg("ip").c_str());
   }
   if (server->arg("gw") != "") {
     DEBUG_WM(F("static gateway: "));
     DEBUG_WM(server->arg("gw"));
-    String gw = server->arg("gw");
-    optionalIPFromString(&_sta_static_gw, gw.c_str());
+    optionalIPFromString(&_sta_static_gw, server->arg("gw").c_str());
   }
   if (server->arg("sn") != "") {
     DEBUG_WM(F("static netmask: "));
     DEBUG_WM(server->arg("sn"));
-    String sn = server->arg("sn");
-    optionalIPFromString(&_sta_static_sn, sn.c_str());
+    optionalIPFromString(&_sta_static_sn, server->arg("sn").c_str());
   }
+  if ((uint32_t)ip != (uint32_t)_sta_static_ip ||
+      (uint32_t)gw != (uint32_t)_sta_static_gw ||
+      (uint32_t)sn != (uint32_t)_sta_static_sn) {
+    changes.fields |= CONFIG_STATIC_IP;
+  }
+  if (changes.fields != 0) {
+    invalidatePages();
+  }
+  commitConfig();
 
-  String page = FPSTR(WM_HTTP_HEAD);
-  page.replace("{v}", "Credentials Saved");
-  page += FPSTR(WM_HTTP_SCRIPT);
-  page += FPSTR(WM_HTTP_STYLE);
-  page += _customHeadElement;
-  page += FPSTR(WM_HTTP_HEAD_END);
-  page += FPSTR(WM_HTTP_SAVED);
-  page.replace("{h}", getHostname());
-  page.replace("{n}", _ssid);
-  page += FPSTR(WM_HTTP_END);
-
-  server->sendHeader("Content-Length", String(page.length()));
-  server->send(200, "text/html", page);
+  WiFiManagerPageWriter page(server.get());
+  page.begin(200, "text/html");
+  sendPageHead(page, "Credentials Saved");
+  WiFiManagerSlot slots[] = {{'h', _hostname}, {'n', _ssid}};
+  page.printTemplate(WM_HTTP_SAVED, slots);
+  page.print_P(WM_HTTP_END);
+  page.end();
 
   DEBUG_WM(F("Sent wifi save page"));
 
@@ -929,78 +3011,238 @@ void WiFiManager::handleWifiSave() {
 /** Handle the info page */
 void WiFiManager::handleInfo() {
   DEBUG_WM(F("Info"));
+  // the WiFi event task fills in the record of an attempt in progress, so
+  // the page is only cached between attempts
+  bool cacheable = _connectRecord == NULL;
+  if (cacheable && sendCachedPage(PAGE_INFO)) {
+    return;
+  }
 
-  String page = FPSTR(WM_HTTP_HEAD);
-  page.replace("{v}", "Info");
-  page += FPSTR(WM_HTTP_SCRIPT);
-  page += FPSTR(WM_HTTP_STYLE);
-  page += _customHeadElement;
-  page += FPSTR(WM_HTTP_HEAD_END);
-  page += F("<dl>");
-  page += F("<dt>Chip ID</dt><dd>");
-  page += ESP_getChipId();
-  page += F("</dd>");
-  page += F("<dt>Flash Chip ID</dt><dd>");
+  WiFiManagerPageWriter page(server.get());
+  page.keepCopy(cacheable ? pageCopyLimit() : 0);
+  page.begin(200, "text/html");
+  sendPageHead(page, "Info");
+  page.print(F("<dl>"));
+  page.print(F("<dt>Chip ID</dt><dd>"));
+  page.print(ESP_getChipId());
+  page.print(F("</dd>"));
+  page.print(F("<dt>Flash Chip ID</dt><dd>"));
 #if defined(ESP8266)
-  page += ESP.getFlashChipId();
+  page.print(ESP.getFlashChipId());
 #else
   // TODO
-  page += F("TODO");
+  page.print(F("TODO"));
 #endif
-  page += F("</dd>");
-  page += F("<dt>IDE Flash Size</dt><dd>");
-  page += ESP.getFlashChipSize();
-  page += F(" bytes</dd>");
-  page += F("<dt>Real Flash Size</dt><dd>");
+  page.print(F("</dd>"));
+  page.print(F("<dt>IDE Flash Size</dt><dd>"));
+  page.print(ESP.getFlashChipSize());
+  page.print(F(" bytes</dd>"));
+  page.print(F("<dt>Real Flash Size</dt><dd>"));
 #if defined(ESP8266)
-  page += ESP.getFlashChipRealSize();
+  page.print(ESP.getFlashChipRealSize());
 #else
   // TODO
-  page += F("TODO");
+  page.print(F("TODO"));
 #endif
-  page += F(" bytes</dd>");
-  page += F("<dt>Soft AP IP</dt><dd>");
-  page += WiFi.softAPIP().toString();
-  page += F("</dd>");
-  page += F("<dt>Soft AP MAC</dt><dd>");
-  page += WiFi.softAPmacAddress();
-  page += F("</dd>");
-  page += F("<dt>Station MAC</dt><dd>");
-  page += WiFi.macAddress();
-  page += F("</dd>");
-  page += F("</dl>");
-  page += FPSTR(WM_HTTP_END);
-
-  server->sendHeader("Content-Length", String(page.length()));
-  server->send(200, "text/html", page);
+  page.print(F(" bytes</dd>"));
+  char address[MAC_STRING_SIZE];
+  uint8_t mac[6];
+  page.print(F("<dt>Soft AP IP</dt><dd>"));
+  formatIp(address, WiFi.softAPIP());
+  page.print(address);
+  page.print(F("</dd>"));
+  page.print(F("<dt>Soft AP MAC</dt><dd>"));
+  formatMac(address, WiFi.softAPmacAddress(mac));
+  page.print(address);
+  page.print(F("</dd>"));
+  page.print(F("<dt>Station MAC</dt><dd>"));
+  formatMac(address, WiFi.macAddress(mac));
+  page.print(address);
+  page.print(F("</dd>"));
+  page.print(F("</dl>"));
+
+  // connect attempts, newest first; times in ms since the attempt started
+  page.print(F("<h4>Connect log</h4><table><tr><th>Boot</th><th>Try</th>"
+               "<th>Path</th><th>Scan</th><th>Conn</th><th>IP</th>"
+               "<th>End</th><th>Result</th><th>Reason</th></tr>"));
+  WiFiManagerConnectRecord record;
+  for (int i = 0; getConnectLog(i, &record); i++) {
+    static const char *const paths[] = {"-", "fast", "full"};
+    int32_t phases[] = {record.scan, record.connected, record.gotIp,
+                        record.end};
+
+    page.print(F("<tr><td>"));
+    page.print(record.boot);
+    page.print(F("</td><td>"));
+    page.print((uint32_t)record.attempt);
+    page.print(F("</td><td>"));
+    page.print(paths[record.path <= CONNECT_PATH_FULL ? record.path : 0]);
+    for (size_t j = 0; j < sizeof(phases) / sizeof(phases[0]); j++) {
+      page.print(F("</td><td>"));
+      if (phases[j] < 0) {
+        page.print("-");
+      } else {
+        page.print(phases[j]);
+      }
+    }
+    page.print(F("</td><td>"));
+    page.print((uint32_t)record.result);
+    page.print(F("</td><td>"));
+    page.print((uint32_t)record.reason);
+    page.print(F("</td></tr>"));
+  }
+  page.print(F("</table>"));
+  page.print_P(WM_HTTP_END);
+  page.end();
+  if (cacheable) {
+    cachePage(PAGE_INFO, page);
+  }
 
   DEBUG_WM(F("Sent info page"));
 }
 
+void WiFiManager::invalidatePages() { _pageGeneration++; }
+
+/** Send a page from the cache if it is still valid. Drops the whole cache
+ * instead when the heap runs low */
+bool WiFiManager::sendCachedPage(CachedPage id) {
+  PageCacheEntry &entry = _pageCache[id];
+
+  if (ESP.getFreeHeap() < WIFI_MANAGER_PAGE_CACHE_MIN_HEAP) {
+    clearPageCache();
+  }
+  if (entry.body == NULL || entry.generation != _pageGeneration) {
+    _metrics.pageCacheMisses++;
+    return false;
+  }
+  _metrics.pageCacheHits++;
+  entry.lastUsed = millis();
+  server->setContentLength(entry.length);
+  server->send(200, "text/html", "");
+  server->sendContent(entry.body, entry.length);
+  responseBytes += entry.length;
+  return true;
+}
+
+/** Keep the page that was just sent. The least recently used pages make room
+ * for it if the cache would exceed WIFI_MANAGER_PAGE_CACHE_SIZE */
+void WiFiManager::cachePage(CachedPage id, WiFiManagerPageWriter &page) {
+  size_t length;
+  char *body = page.takeCopy(&length);
+
+  free(_pageCache[id].body);
+  _pageCache[id].body = NULL;
+  if (body == NULL) {
+    return;
+  }
+  if (ESP.getFreeHeap() < WIFI_MANAGER_PAGE_CACHE_MIN_HEAP) {
+    free(body);
+    return;
+  }
+
+  while (true) {
+    size_t used = length;
+    int oldest = -1;
+    for (int i = 0; i < PAGE_COUNT; i++) {
+      if (_pageCache[i].body == NULL) {
+        continue;
+      }
+      used += _pageCache[i].length;
+      if (oldest < 0 || _pageCache[i].lastUsed < _pageCache[oldest].lastUsed) {
+        oldest = i;
+      }
+    }
+    if (used <= WIFI_MANAGER_PAGE_CACHE_SIZE || oldest < 0) {
+      break;
+    }
+    free(_pageCache[oldest].body);
+    _pageCache[oldest].body = NULL;
+  }
+
+  // the copy was sized to grow; only keep what is used
+  char *shrunk = (char *)realloc(body, length);
+  _pageCache[id].body = shrunk != NULL ? shrunk : body;
+  _pageCache[id].length = length;
+  _pageCache[id].generation = _pageGeneration;
+  _pageCache[id].lastUsed = millis();
+}
+
+void WiFiManager::clearPageCache() {
+  for (int i = 0; i < PAGE_COUNT; i++) {
+    free(_pageCache[i].body);
+    _pageCache[i].body = NULL;
+  }
+}
+
 /** Handle the reset page */
 void WiFiManager::handleReset() {
   DEBUG_WM(F("Reset"));
 
-  String page = FPSTR(WM_HTTP_HEAD);
-  page.replace("{v}", "Info");
-  page += FPSTR(WM_HTTP_SCRIPT);
-  page += FPSTR(WM_HTTP_STYLE);
-  page += _customHeadElement;
-  page += FPSTR(WM_HTTP_HEAD_END);
-  page += F("Module will reset in a few seconds.");
-  page += FPSTR(WM_HTTP_END);
-
-  server->sendHeader("Content-Length", String(page.length()));
-  server->send(200, "text/html", page);
+  WiFiManagerPageWriter page(server.get());
+  page.begin(200, "text/html");
+  sendPageHead(page, "Info");
+  page.print(F("Module will reset in a few seconds."));
+  page.print_P(WM_HTTP_END);
+  page.end();
 
   DEBUG_WM(F("Sent reset page"));
-  delay(5000);
-#if defined(ESP8266)
-  ESP.reset();
-#else
-  ESP.restart();
-#endif
-  delay(2000);
+
+  // processConfigPortal() restarts the module after RESET_DELAY
+  _resetRequested = true;
+  _resetRequestTime = millis();
+}
+
+/** Whether an If-None-Match header names etag: a list of ETags separated by
+ * commas, weak (W/) ones included, or "*" */
+static bool etagMatches(const char *header, PGM_P etag) {
+  size_t etagLength = strlen_P(etag);
+
+  while (*header != 0) {
+    while (*header == ' ' || *header == '\t' || *header == ',') {
+      header++;
+    }
+    const char *end = header;
+    while (*end != 0 && *end != ',') {
+      end++;
+    }
+    const char *tag = header;
+    size_t length = end - header;
+    while (length > 0 && (tag[length - 1] == ' ' || tag[length - 1] == '\t')) {
+      length--;
+    }
+    if (length == 1 && tag[0] == '*') {
+      return true;
+    }
+    if (length > 2 && tag[0] == 'W' && tag[1] == '/') {
+      tag += 2;
+      length -= 2;
+    }
+    if (length == etagLength && strncmp_P(tag, etag, length) == 0) {
+      return true;
+    }
+    header = end;
+  }
+  return false;
+}
+
+/** Serve a precompressed static asset. The pages link the assets with
+ * their version in the URL (see WM_HTTP_ASSETS), so browsers may cache those
+ * for a long time; without it they have to check the ETag */
+void WiFiManager::handleAsset(const uint8_t *data, size_t length,
+                              const char *contentType, PGM_P etag) {
+  server->sendHeader("ETag", FPSTR(etag));
+  if (server->hasArg("v")) {
+    server->sendHeader("Cache-Control", "public, max-age=31536000");
+  } else {
+    server->sendHeader("Cache-Control", "no-cache");
+  }
+  if (etagMatches(server->header("If-None-Match").c_str(), etag)) {
+    server->send(304);
+    return;
+  }
+  server->sendHeader("Content-Encoding", "gzip");
+  server->send_P(200, contentType, (PGM_P)data, length);
+  responseBytes += length;
 }
 
 void WiFiManager::handleNotFound() {
@@ -1008,23 +3250,161 @@ void WiFiManager::handleNotFound() {
                           // the error page.
     return;
   }
-  String message = "File Not Found\n\n";
-  message += "URI: ";
-  message += server->uri();
-  message += "\nMethod: ";
-  message += (server->method() == HTTP_GET) ? "GET" : "POST";
-  message += "\nArguments: ";
-  message += server->args();
-  message += "\n";
+  static const char message[] PROGMEM = "Not found";
+  // too long for the inline buffer of a String; copied to the heap only once
+  static const String noCache(F("no-cache, no-store, must-revalidate"));
+  server->sendHeader("Cache-Control", noCache);
+  server->send_P(404, "text/plain", message);
+  responseBytes += sizeof(message) - 1;
+}
+
+/** Answer a captive portal check with a redirect to the portal, so the OS
+ * shows its sign in page */
+void WiFiManager::handleProbe() { redirectToPortal(); }
+
+void WiFiManager::onRoute(const char *uri, Route route,
+                          std::function<void()> handler) {
+  server->on(uri, [this, route, handler]() { handleRoute(route, handler); });
+}
+
+/** Run a request handler and record its latency, response size and the heap
+ * around it. Costs a few calls to read the clock and the heap */
+void WiFiManager::handleRoute(Route route,
+                              const std::function<void()> &handler) {
+  RouteMetrics &metrics = _metrics.routes[route];
+  uint32_t bytes = responseBytes;
+
+  _metrics.freeHeapBefore = ESP.getFreeHeap();
+#if defined(ESP8266)
+  _metrics.largestFreeBlockBefore = ESP.getMaxFreeBlockSize();
+#else
+  _metrics.largestFreeBlockBefore = ESP.getMaxAllocHeap();
+#endif
+  unsigned long start = micros();
+
+  handler();
+
+  uint32_t latency = micros() - start;
+  _metrics.freeHeapAfter = ESP.getFreeHeap();
+#if defined(ESP8266)
+  _metrics.largestFreeBlockAfter = ESP.getMaxFreeBlockSize();
+  if (_metrics.minFreeHeap == 0 ||
+      _metrics.freeHeapAfter < _metrics.minFreeHeap) {
+    _metrics.minFreeHeap = _metrics.freeHeapAfter;
+  }
+#else
+  _metrics.largestFreeBlockAfter = ESP.getMaxAllocHeap();
+  _metrics.minFreeHeap = ESP.getMinFreeHeap();
+#endif
+
+  metrics.requests++;
+  metrics.bytesSent += responseBytes - bytes;
+  metrics.latencySum += latency;
+  uint8_t bucket = 0;
+  while (bucket < LATENCY_BUCKETS - 1 && latency > latencyBounds[bucket]) {
+    bucket++;
+  }
+  metrics.latency[bucket]++;
+}
+
+const WiFiManager::Metrics &WiFiManager::getMetrics() { return _metrics; }
+
+/** Handle the metrics page (Prometheus text format) */
+void WiFiManager::handleMetrics() {
+  WiFiManagerPageWriter page(server.get());
+  char line[160];
+
+  server->sendHeader("Cache-Control", "no-store");
+  page.begin(200, "text/plain; version=0.0.4");
+
+  page.print(F("# TYPE wifimanager_http_requests_total counter\n"));
+  for (int i = 0; i < ROUTE_COUNT; i++) {
+    snprintf(line, sizeof(line),
+             "wifimanager_http_requests_total{route=\"%s\"} %u\n",
+             routeNames[i], (unsigned)_metrics.routes[i].requests);
+    page.print(line);
+  }
+
+  page.print(F("# TYPE wifimanager_http_response_bytes_total counter\n"));
+  for (int i = 0; i < ROUTE_COUNT; i++) {
+    snprintf(line, sizeof(line),
+             "wifimanager_http_response_bytes_total{route=\"%s\"} %u\n",
+             routeNames[i], (unsigned)_metrics.routes[i].bytesSent);
+    page.print(line);
+  }
 
-  for (uint8_t i = 0; i < server->args(); i++) {
-    message += " " + server->argName(i) + ": " + server->arg(i) + "\n";
+  page.print(
+      F("# TYPE wifimanager_http_request_duration_seconds histogram\n"));
+  for (int i = 0; i < ROUTE_COUNT; i++) {
+    const RouteMetrics &metrics = _metrics.routes[i];
+    uint32_t count = 0;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+      count += metrics.latency[bucket];
+      snprintf(line, sizeof(line),
+               "wifimanager_http_request_duration_seconds_bucket{route=\"%s\","
+               "le=\"%s\"} %u\n",
+               routeNames[i], latencyLabels[bucket], (unsigned)count);
+      page.print(line);
+    }
+    snprintf(line, sizeof(line),
+             "wifimanager_http_request_duration_seconds_sum{route=\"%s\"} "
+             "%u.%06u\n",
+             routeNames[i], (unsigned)(metrics.latencySum / 1000000),
+             (unsigned)(metrics.latencySum % 1000000));
+    page.print(line);
+    snprintf(line, sizeof(line),
+             "wifimanager_http_request_duration_seconds_count{route=\"%s\"} "
+             "%u\n",
+             routeNames[i], (unsigned)count);
+    page.print(line);
   }
-  server->sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-  server->sendHeader("Pragma", "no-cache");
-  server->sendHeader("Expires", "-1");
-  server->sendHeader("Content-Length", String(message.length()));
-  server->send(404, "text/plain", message);
+
+  page.print(F("# TYPE wifimanager_heap_free_bytes gauge\n"));
+  snprintf(line, sizeof(line),
+           "wifimanager_heap_free_bytes{when=\"before\"} %u\n"
+           "wifimanager_heap_free_bytes{when=\"after\"} %u\n",
+           (unsigned)_metrics.freeHeapBefore,
+           (unsigned)_metrics.freeHeapAfter);
+  page.print(line);
+  page.print(F("# TYPE wifimanager_heap_largest_free_block_bytes gauge\n"));
+  snprintf(line, sizeof(line),
+           "wifimanager_heap_largest_free_block_bytes{when=\"before\"} %u\n"
+           "wifimanager_heap_largest_free_block_bytes{when=\"after\"} %u\n",
+           (unsigned)_metrics.largestFreeBlockBefore,
+           (unsigned)_metrics.largestFreeBlockAfter);
+  page.print(line);
+  page.print(F("# TYPE wifimanager_heap_min_free_bytes gauge\n"));
+  snprintf(line, sizeof(line), "wifimanager_heap_min_free_bytes %u\n",
+           (unsigned)_metrics.minFreeHeap);
+  page.print(line);
+
+  page.print(F("# TYPE wifimanager_dns_queries_total counter\n"));
+  snprintf(line, sizeof(line), "wifimanager_dns_queries_total %u\n",
+           (unsigned)_metrics.dnsQueries);
+  page.print(line);
+
+  page.print(F("# TYPE wifimanager_page_cache_hits_total counter\n"
+               "# TYPE wifimanager_page_cache_misses_total counter\n"));
+  snprintf(line, sizeof(line),
+           "wifimanager_page_cache_hits_total %u\n"
+           "wifimanager_page_cache_misses_total %u\n",
+           (unsigned)_metrics.pageCacheHits,
+           (unsigned)_metrics.pageCacheMisses);
+  page.print(line);
+
+  page.print(F("# TYPE wifimanager_time_to_portal_seconds gauge\n"));
+  snprintf(line, sizeof(line),
+           "wifimanager_time_to_portal_seconds %lu.%03lu\n",
+           _timeToPortal / 1000, _timeToPortal % 1000);
+  page.print(line);
+  page.print(F("# TYPE wifimanager_config_writes_total counter\n"));
+  snprintf(line, sizeof(line),
+           "wifimanager_config_writes_total %u\n"
+           "# TYPE wifimanager_config_written_bytes_total counter\n"
+           "wifimanager_config_written_bytes_total %u\n",
+           (unsigned)_configWrites, (unsigned)_configBytesWritten);
+  page.print(line);
+  page.end();
 }
 
 /** Redirect to captive portal if we got a request for another domain. Return
@@ -1033,18 +3413,20 @@ void WiFiManager::handleNotFound() {
 boolean WiFiManager::captivePortal() {
   if (!isIp(server->hostHeader())) {
     DEBUG_WM(F("Request redirected to captive portal"));
-    server->sendHeader("Location",
-                       String("http://") + toStringIp(WiFi.softAPIP()), true);
-    server->send(302, "text/plain",
-                 "");  // Empty content inhibits Content-length header so we
-                       // have to close the socket ourselves.
-    server->client()
-        .stop();  // Stop is needed because we sent no content length
+    redirectToPortal();
     return true;
   }
   return false;
 }
 
+void WiFiManager::redirectToPortal() {
+  if (_portalUrl.length() == 0) {
+    _portalUrl = String("http://") + toStringIp(WiFi.softAPIP());
+  }
+  server->sendHeader("Location", _portalUrl, true);
+  server->send(302, "text/plain", "");
+}
+
 // start up config portal callback
 void WiFiManager::setAPCallback(void (*func)(WiFiManager *myWiFiManager)) {
   _apcallback = func;
@@ -1055,9 +3437,15 @@ void WiFiManager::setSaveConfigCallback(void (*func)(void)) {
   _savecallback = func;
 }
 
+void WiFiManager::setConfigChangedCallback(
+    void (*func)(const ConfigChanges &changes)) {
+  _configChangedCallback = func;
+}
+
 // sets a custom element to add to head, like a new style tag
 void WiFiManager::setCustomHeadElement(const char *element) {
   _customHeadElement = element;
+  invalidatePages();
 }
 
 // if this is true, remove duplicated Access Points - defaut true
@@ -1065,11 +3453,17 @@ void WiFiManager::setRemoveDuplicateAPs(boolean removeDuplicates) {
   _removeDuplicateAPs = removeDuplicates;
 }
 
-void WiFiManager::setDefaultHostname(String hostname) {
-  _defaultHostname = hostname;
+void WiFiManager::setDefaultHostname(const char *hostname) {
+  copyString(_defaultHostname, hostname, sizeof(_defaultHostname));
+}
+
+void WiFiManager::setDefaultHostname(const String &hostname) {
+  setDefaultHostname(hostname.c_str());
 }
 
-String WiFiManager::getHostname() { return _hostname; }
+String WiFiManager::getHostname() { return getHostnameCStr(); }
+
+const char *WiFiManager::getHostnameCStr() { return _hostname; }
 
 uint64_t WiFiManager::getMac() {
   uint64_t tmp;
@@ -1110,23 +3504,41 @@ String WiFiManager::getMacAsString(bool insertColons) {
 }
 
 void WiFiManager::readHostname() {
-  String macStr;
   uint64_t mac64;
-  if (preferences.getBool("useHostname", false)) {
-    _hostname = preferences.getString("hostname", "ESP");
+  if (_useHostname) {
+    // loaded by loadConfig()
   } else {
     if (_appendMacToHostname) {
-      macStr = getMacAsString(false);
-      _hostname = (_defaultHostname + "-" + macStr);
+      // same as getMacAsString(false)
+      mac64 = getMac();
+      if (snprintf(_hostname, sizeof(_hostname), "%s-%X%X", _defaultHostname,
+                   (unsigned)(uint16_t)(mac64 >> 32),
+                   (unsigned)(uint32_t)mac64) >= (int)sizeof(_hostname)) {
+        DEBUG_WM(F("Hostname cut to fit"));
+      }
     } else {
-      _hostname = _defaultHostname;
+      copyString(_hostname, _defaultHostname, sizeof(_hostname));
     }
   }
+  invalidatePages();
 }
 
 void WiFiManager::readNetworkCredentials() {
-  _ssid = preferences.getString("ssid", "ESP");
-  _pass = preferences.getString("pass", "ESP");
+  if (_networkCount == 0) {
+    copyString(_ssid, "ESP", sizeof(_ssid));
+    copyString(_pass, "ESP", sizeof(_pass));
+    _cachedChannel = 0;
+    return;
+  }
+
+  // the one connectWifi() and the portal use until autoConnect() picks one
+  int best = 0;
+  for (int i = 1; i < _networkCount; i++) {
+    if (networkIsBetter(_networks[i], 0, _networks[best], 0)) {
+      best = i;
+    }
+  }
+  selectNetwork(best);
 }
 
 void WiFiManager::appendMacToHostname(bool value) {
@@ -1156,10 +3568,9 @@ int WiFiManager::getRSSIasQuality(int RSSI) {
 }
 
 /** Is this an IP? */
-boolean WiFiManager::isIp(String str) {
-  for (int i = 0; i < str.length(); i++) {
-    int c = str.charAt(i);
-    if (c != '.' && (c < '0' || c > '9')) {
+boolean WiFiManager::isIp(const String &str) {
+  for (const char *p = str.c_str(); *p; p++) {
+    if (*p != '.' && (*p < '0' || *p > '9')) {
       return false;
     }
   }
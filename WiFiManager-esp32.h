@@ -20,9 +20,10 @@
 #include <WebServer.h>
 #include <WiFi.h>
 #endif
-#include <DNSServer.h>
+#include <WiFiUdp.h>
 
 #include <memory>
+#include <vector>
 
 #if defined(ESP8266)
 extern "C" {
@@ -31,6 +32,10 @@ extern "C" {
 #define ESP_getChipId() (ESP.getChipId())
 #else
 #include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
 #define ESP_getChipId() ((uint32_t)ESP.getEfuseMac())
 #endif
 
@@ -72,6 +77,8 @@ const char WM_HTTP_PORTAL_OPTIONS[] PROGMEM =
 const char WM_HTTP_ITEM[] PROGMEM =
     "<div><a href='#p' onclick='c(this)'>{v}</a>&nbsp;<span class='q "
     "{i}'>{r}%</span></div>";
+const char WM_HTTP_SCAN_LIST[] PROGMEM =
+    "<div id='n' data-scan='{s}'>Scanning...</div>";
 const char WM_HTTP_FORM_START[] PROGMEM =
     "<form method='get' action='wifisave'><input id='s' name='s' length=32 "
     "placeholder='SSID'><br/><input id='p' name='p' length=64 type='password' "
@@ -79,6 +86,7 @@ const char WM_HTTP_FORM_START[] PROGMEM =
 const char WM_HTTP_FORM_PARAM[] PROGMEM =
     "<br/><input id='{i}' name='{n}' length={l} placeholder='{p}' value='{v}' "
     "{c}>";
+const char WM_HTTP_FORM_GROUP[] PROGMEM = "<h4>{g}</h4>";
 const char WM_HTTP_FORM_END[] PROGMEM =
     "<br/><button type='submit'>save</button></form>";
 const char WM_HTTP_CHANGE_NAME_ERROR_MSG[] PROGMEM =
@@ -96,29 +104,265 @@ const char WM_HTTP_SAVED[] PROGMEM =
     "/>If it fails reconnect to AP to try again</div>";
 const char WM_HTTP_END[] PROGMEM = "</div></body></html>";
 
+// initial capacity of the parameter registry; it grows when more parameters
+// are added
+#ifndef WIFI_MANAGER_MAX_PARAMS
 #define WIFI_MANAGER_MAX_PARAMS 10
+#endif
+
+// minimum size of the blocks parameter values are allocated from
+#ifndef WIFI_MANAGER_ARENA_BLOCK_SIZE
+#define WIFI_MANAGER_ARENA_BLOCK_SIZE 256
+#endif
+
+// maximum number of access points kept from a scan
+#ifndef WIFI_MANAGER_MAX_SCAN_RESULTS
+#define WIFI_MANAGER_MAX_SCAN_RESULTS 64
+#endif
+
+// number of networks remembered
+#ifndef WIFI_MANAGER_MAX_NETWORKS
+#define WIFI_MANAGER_MAX_NETWORKS 5
+#endif
+
+// ms a hidden known network the scan did not see gets to connect, at most;
+// one attempt, no retry
+#ifndef WIFI_MANAGER_HIDDEN_CONNECT_TIMEOUT
+#define WIFI_MANAGER_HIDDEN_CONNECT_TIMEOUT 5000
+#endif
+
+// number of connect attempts kept in RTC memory
+#ifndef WIFI_MANAGER_CONNECT_LOG_SIZE
+#define WIFI_MANAGER_CONNECT_LOG_SIZE 8
+#endif
+
+// number of events the portal task can queue for the application
+#ifndef WIFI_MANAGER_EVENT_QUEUE_LENGTH
+#define WIFI_MANAGER_EVENT_QUEUE_LENGTH 8
+#endif
+
+// maximum number of DNS queries answered per call of processConfigPortal()
+#ifndef WIFI_MANAGER_DNS_BURST
+#define WIFI_MANAGER_DNS_BURST 32
+#endif
+
+// size of the buffer used to stream portal pages; peak heap used per request
+// is bounded by this instead of by the size of the page
+#ifndef WIFI_MANAGER_PAGE_BUFFER_SIZE
+#define WIFI_MANAGER_PAGE_BUFFER_SIZE 256
+#endif
+
+// heap used to keep rendered portal pages for repeat views; 0 disables the
+// cache. Nothing is cached, and cached pages are dropped, while the free heap
+// is below WIFI_MANAGER_PAGE_CACHE_MIN_HEAP
+#ifndef WIFI_MANAGER_PAGE_CACHE_SIZE
+#define WIFI_MANAGER_PAGE_CACHE_SIZE 8192
+#endif
+#ifndef WIFI_MANAGER_PAGE_CACHE_MIN_HEAP
+#define WIFI_MANAGER_PAGE_CACHE_MIN_HEAP 32768
+#endif
+
+// One access point (or, with duplicate removal, one SSID) found by a scan
+struct WiFiManagerScanResult {
+  char ssid[33];
+  uint32_t hash;  // of ssid
+  int8_t rssi;
+  uint8_t channel;
+  uint8_t auth;  // wifi_auth_mode_t
+  uint8_t bssid[6];
+  uint8_t bssidCount;  // number of APs merged into this entry
+};
+
+// A known network; see WiFiManager::addNetwork(). Stored as is in Preferences
+struct WiFiManagerNetwork {
+  char ssid[33];
+  char pass[65];
+  uint8_t bssid[6];  // AP of the last successful connection
+  uint8_t channel;   // of that AP; 0 if there was none yet
+  uint8_t priority;  // higher is tried first
+  uint8_t failures;  // failed connects since the last successful one
+  // does not broadcast its SSID, so it is tried even if the scan did not see
+  // it. In what used to be padding: stored networks read back as 0
+  uint8_t hidden;
+  // sequence number of the last successful connect (the device has no clock);
+  // the most recently used network has the highest. 0: never
+  uint32_t lastSuccess;
+};
+
+// One connect attempt; see WiFiManager::getConnectLog(). Phase times are in ms
+// since the start of the attempt, -1 if the phase was not reached
+struct WiFiManagerConnectRecord {
+  uint32_t boot;         // number of the boot the attempt was made in
+  uint32_t start;        // millis() at the start of the attempt
+  int32_t scan;          // duration of the scan that picked the network
+  int32_t connected;     // associated and authenticated
+  int32_t gotIp;         // DHCP done
+  int32_t disconnected;  // last disconnect
+  int32_t end;           // result known
+  uint8_t reason;        // of the last disconnect; 0 if none
+  uint8_t attempt;       // 0: first, 1: retry in connectWifi(), 2: WPS
+  uint8_t path;          // WiFiManager::ConnectPath
+  uint8_t result;        // wl_status_t
+};
+
+// How to scan for networks; see WiFiManager::setScanProfile()
+struct WiFiManagerScanProfile {
+  uint16_t channels;   // bit n set: scan channel n (1-14); 0: all channels
+  bool passive;        // listen for beacons instead of sending probe requests
+  uint32_t dwellTime;  // ms per channel; 0: driver default
+  bool showHidden;     // include networks that do not broadcast their SSID
+};
+
+// Value for a "{k}" placeholder in one of the WM_HTTP_* templates
+struct WiFiManagerSlot {
+  char key;
+  const char *value;
+};
+
+// Streams a page to the client using chunked transfer encoding. Static parts
+// (PROGMEM) and dynamic parts are copied into a small fixed buffer that is sent
+// whenever it fills up.
+class WiFiManagerPageWriter {
+ public:
+#ifdef ESP8266
+  WiFiManagerPageWriter(ESP8266WebServer *server);
+#else
+  WiFiManagerPageWriter(WebServer *server);
+#endif
+  ~WiFiManagerPageWriter();
+
+  void begin(int code, const char *contentType);
+  void print(const char *str);
+  void print(const String &str);
+  void print(const __FlashStringHelper *str);
+  void print(uint32_t value);
+  void print(int32_t value);
+  void print_P(PGM_P str);
+  // prints str as a quoted and escaped JSON string
+  void printJSON(const char *str);
+  // Renders a template in a single pass: literal runs are copied as-is and
+  // each "{k}" placeholder is replaced by the value of the matching slot.
+  // Placeholders without a slot are copied unchanged.
+  void printTemplate(PGM_P tmpl, const WiFiManagerSlot *slots, size_t count);
+  template <size_t N>
+  void printTemplate(PGM_P tmpl, const WiFiManagerSlot (&slots)[N]) {
+    printTemplate(tmpl, slots, N);
+  }
+  void end();
+
+  size_t getBytesSent();
+  // Also keep a copy of what is sent, as long as it fits in limit bytes
+  void keepCopy(size_t limit);
+  // The copy, to be freed by the caller; NULL if the page did not fit
+  char *takeCopy(size_t *length);
+
+ private:
+#ifdef ESP8266
+  ESP8266WebServer *_server;
+#else
+  WebServer *_server;
+#endif
+  char _buffer[WIFI_MANAGER_PAGE_BUFFER_SIZE];
+  size_t _used = 0;
+  size_t _sent = 0;
+  char *_copy = NULL;
+  size_t _copyLength = 0;
+  size_t _copySize = 0;
+  size_t _copyLimit = 0;
+
+  void write(const char *data, size_t len, bool progmem);
+  void flush();
+};
+
+// Bump allocator for the value buffers of custom parameters: buffers are
+// carved out of blocks of at least WIFI_MANAGER_ARENA_BLOCK_SIZE bytes and
+// only freed all at once by reset()
+class WiFiManagerArena {
+ public:
+  ~WiFiManagerArena();
+
+  char *allocate(size_t size);
+  void reset();
+  // bytes taken from the heap, and the part of it that is in use
+  size_t getSize();
+  size_t getUsed();
+
+ private:
+  struct Block {
+    Block *next;
+    size_t size;
+    size_t used;
+  };
+  Block *_blocks = NULL;
+};
+
+// Captive portal DNS server: answers every A query with the address of the
+// portal and every other query with an empty answer, so clients do not keep
+// retrying AAAA lookups. Replies are built in place in a fixed buffer, so
+// the responder itself does not allocate; WiFiUDP::parsePacket() of the core
+// still allocates a receive buffer for every packet
+class WiFiManagerDNS {
+ public:
+  bool start(uint16_t port, IPAddress ip);
+  void stop();
+  // answers up to max pending queries; returns the number of queries read
+  int process(int max);
+
+ private:
+  // a DNS message header, name compression pointer to the question, then type
+  // A, class IN, TTL and the address
+  static const size_t HEADER_SIZE = 12;
+  static const size_t ANSWER_SIZE = 16;
+  static const size_t PACKET_SIZE = 512;
+
+  WiFiUDP _udp;
+  uint8_t _answer[ANSWER_SIZE];
+  uint8_t _packet[PACKET_SIZE + ANSWER_SIZE];
+
+  void reply(size_t size);
+};
+
+class WiFiManager;
 
 class WiFiManagerParameter {
  public:
   WiFiManagerParameter(const char *custom);
+  // The value buffer is allocated when the parameter is added to a
+  // WiFiManager; until then getValue() returns defaultValue, which must stay
+  // valid until then
   WiFiManagerParameter(const char *id, const char *placeholder,
                        const char *defaultValue, int length);
   WiFiManagerParameter(const char *id, const char *placeholder,
                        const char *defaultValue, int length,
                        const char *custom);
+  // a parameter that is destroyed or moved is removed from, or replaced in,
+  // the WiFiManager it was added to. Once removed, or once that WiFiManager
+  // is destroyed, getValue() returns defaultValue again
+  ~WiFiManagerParameter();
+  WiFiManagerParameter(WiFiManagerParameter &&other);
+  WiFiManagerParameter &operator=(WiFiManagerParameter &&other);
+  WiFiManagerParameter(const WiFiManagerParameter &) = delete;
+  WiFiManagerParameter &operator=(const WiFiManagerParameter &) = delete;
 
   const char *getID();
   const char *getValue();
   const char *getPlaceholder();
   int getValueLength();
   const char *getCustomHTML();
+  // parameters of the same group are shown together on the config page,
+  // under the group name; NULL (default) for no group
+  void setGroup(const char *group);
+  const char *getGroup();
 
  private:
   const char *_id;
   const char *_placeholder;
-  char *_value;
+  const char *_defaultValue = NULL;
+  char *_value = NULL;  // in the arena of _manager; NULL until added
   int _length;
   const char *_customHTML;
+  const char *_group = NULL;
+  WiFiManager *_manager = NULL;  // that it was added to
 
   void init(const char *id, const char *placeholder, const char *defaultValue,
             int length, const char *custom);
@@ -129,6 +373,7 @@ class WiFiManagerParameter {
 class WiFiManager {
  public:
   WiFiManager();
+  ~WiFiManager();
 
   enum Mode {
     CONNECTING,
@@ -144,7 +389,95 @@ class WiFiManager {
     Mode mode;
   };
 
-  void configure(String hostname, void (*statusCb)(Status status));
+  enum ConnectPath {
+    CONNECT_PATH_NONE,
+    CONNECT_PATH_FAST,  // directed connect to the cached BSSID and channel
+    CONNECT_PATH_FULL,  // scan all channels for the SSID
+  };
+
+  // milliseconds from the start of a connection attempt until each phase was
+  // reached, or -1 if it was not reached
+  struct ConnectTiming {
+    int32_t connected;     // associated and authenticated
+    int32_t gotIp;         // IP address assigned; connection complete
+    int32_t disconnected;  // last disconnect during the attempt
+    uint8_t reason;        // its reason code (wifi_err_reason_t)
+    ConnectPath path;
+  };
+
+  // HTTP routes of the config portal, for getMetrics()
+  enum Route {
+    ROUTE_ROOT,
+    ROUTE_WIFI,
+    ROUTE_WIFI_NO_SCAN,
+    ROUTE_WIFI_SAVE,
+    ROUTE_SCAN_JSON,
+    ROUTE_INFO,
+    ROUTE_RESET,
+    ROUTE_CHANGE_NAME,
+    ROUTE_SAVE_NAME,
+    ROUTE_FWLINK,
+    ROUTE_ASSET,  // /wm.css and /wm.js
+    ROUTE_METRICS,
+    ROUTE_PROBE,  // captive portal checks of phones and PCs
+    ROUTE_NOT_FOUND,
+    ROUTE_COUNT,
+  };
+
+  // upper bounds of the latency histogram buckets, in us; the last bucket
+  // counts the rest
+  static const uint8_t LATENCY_BUCKETS = 8;
+
+  struct RouteMetrics {
+    uint32_t requests;
+    uint32_t bytesSent;  // response bodies
+    uint64_t latencySum;  // us
+    uint32_t latency[LATENCY_BUCKETS];  // requests per bucket, not cumulative
+  };
+
+  // Counters since boot. Heap sizes are in bytes; "before" and "after" are
+  // taken around the last request
+  struct Metrics {
+    RouteMetrics routes[ROUTE_COUNT];
+    uint32_t freeHeapBefore;
+    uint32_t freeHeapAfter;
+    uint32_t largestFreeBlockBefore;
+    uint32_t largestFreeBlockAfter;
+    uint32_t minFreeHeap;  // lowest free heap since boot
+    uint32_t dnsQueries;
+    uint32_t pageCacheHits;
+    uint32_t pageCacheMisses;
+  };
+
+  // where a scan is done; each has its own scan profile
+  enum ScanPurpose {
+    SCAN_PORTAL_START,    // when the config portal starts
+    SCAN_PORTAL_REFRESH,  // when the config page asks for fresh results
+    SCAN_RECONNECT,       // when autoConnect() picks one of several networks
+    SCAN_PURPOSE_COUNT,
+  };
+
+  enum PortalResult {
+    PORTAL_RUNNING,
+    PORTAL_CONNECTED,  // new credentials were saved and connection succeeded
+    PORTAL_FAILED,     // config done but no connection (setBreakAfterConfig)
+    PORTAL_TIMEOUT,
+    PORTAL_IDLE,  // portal not running (never started or stopped)
+  };
+
+  // how WiFiManager stores its settings in Preferences
+  enum ConfigFormat {
+    CONFIG_FORMAT_KEYS,  // one key per setting; custom parameters not stored
+    // everything, including custom parameters, in one CRC protected blob;
+    // written alternately to two keys so a power cut while saving leaves the
+    // previous version intact. Settings stored as keys are converted
+    CONFIG_FORMAT_BLOB,
+  };
+  // must be called before configure()
+  void setConfigFormat(ConfigFormat format);
+
+  void configure(const char *hostname, void (*statusCb)(Status status));
+  void configure(const String &hostname, void (*statusCb)(Status status));
 
   boolean autoConnect();
   boolean autoConnect(char const *apName, char const *apPassword = NULL);
@@ -154,10 +487,81 @@ class WiFiManager {
   boolean startConfigPortal();
   boolean startConfigPortal(char const *apName, char const *apPassword = NULL);
 
+  // non-blocking variant of startConfigPortal(): beginConfigPortal() brings up
+  // the portal and returns, processConfigPortal() must then be called from
+  // loop(). Every call returns within a bounded time; once it returns
+  // something other than PORTAL_RUNNING the portal has been stopped.
+  void beginConfigPortal();
+  void beginConfigPortal(char const *apName, char const *apPassword = NULL);
+  PortalResult processConfigPortal();
+  void stopConfigPortal();
+
+  // what was changed in the portal; see setConfigChangedCallback()
+  enum ConfigField {
+    CONFIG_SSID = 1 << 0,
+    CONFIG_PASSWORD = 1 << 1,
+    CONFIG_HOSTNAME = 1 << 2,
+    CONFIG_STATIC_IP = 1 << 3,
+    CONFIG_PARAMETERS = 1 << 4,  // see ConfigChanges::parameters
+  };
+
+  struct ConfigChanges {
+    uint32_t fields;      // ConfigField bits
+    // bit n: the n-th parameter passed to addParameter(), for the first 32
+    uint32_t parameters;
+  };
+
+#if !defined(ESP8266)
+  enum PortalEventType {
+    PORTAL_EVENT_STATUS,        // status.mode changed
+    PORTAL_EVENT_AP_STARTED,    // replaces the AP callback
+    PORTAL_EVENT_CONFIG_SAVED,  // replaces the save config callback
+    PORTAL_EVENT_DONE,          // portal stopped; result is valid
+  };
+
+  struct PortalEvent {
+    PortalEventType type;
+    Mode mode;
+    PortalResult result;
+    ConfigChanges changes;  // valid for PORTAL_EVENT_CONFIG_SAVED
+  };
+
+  // Runs the config portal (DNS, web server and connection attempts) in its
+  // own FreeRTOS task. While it runs, status changes and callbacks are
+  // delivered as events that the application fetches with getPortalEvent(),
+  // which never blocks; other WiFiManager methods must not be called until
+  // PORTAL_EVENT_DONE has been received.
+  boolean startConfigPortalTask(char const *apName,
+                                char const *apPassword = NULL,
+                                BaseType_t core = tskNO_AFFINITY,
+                                UBaseType_t priority = 1,
+                                uint32_t stackSize = 8192);
+  void stopConfigPortalTask();
+  boolean getPortalEvent(PortalEvent *event);
+  // minimum amount of free stack (in words) the portal task has had so far,
+  // as last measured by the task: about once a second while it runs, and
+  // when it ends; 0 until the first measurement
+  UBaseType_t getPortalTaskStackHighWaterMark();
+#endif
+
   // get the AP name of the config portal, so it can be used in the callback
   String getConfigPortalSSID();
   String getSSID();
   String getPassword();
+  // the same without a String copy; valid until the network changes
+  const char *getSSIDCStr();
+  const char *getPasswordCStr();
+  // Known networks. autoConnect() tries the visible ones by priority, then the
+  // most recently successful one; of those the scan did not see, only hidden
+  // ones are tried. Adding a known SSID updates it; if the list is full, the
+  // least important network is replaced. The network saved in the portal is
+  // added with priority 0 (or keeps its priority), and as hidden if it was
+  // not in the scan results of the portal
+  bool addNetwork(const char *ssid, const char *pass, uint8_t priority = 0,
+                  bool hidden = false);
+  bool removeNetwork(const char *ssid);
+  int getNetworkCount();
+  bool getNetwork(int index, WiFiManagerNetwork *network);
   void resetSettings();
 
   // sets timeout before webserver loop ends and exits even if there has been no
@@ -182,8 +586,27 @@ class WiFiManager {
   void setAPCallback(void (*func)(WiFiManager *));
   // called when settings have been changed and connection was successful
   void setSaveConfigCallback(void (*func)(void));
+  // same, but tells which settings were changed
+  void setConfigChangedCallback(void (*func)(const ConfigChanges &changes));
+  // writes to Preferences (flash) done by WiFiManager since boot; settings
+  // are only written if their value changed
+  uint32_t getConfigWriteCount();
+  uint32_t getConfigBytesWritten();
+  // time configure() took to read the settings, in us
+  unsigned long getConfigLoadTime();
   // adds a custom parameter
   void addParameter(WiFiManagerParameter *p);
+  void addParameter(WiFiManagerParameter *p, const char *group);
+  // lookup of an added parameter by id; NULL if there is none
+  WiFiManagerParameter *getParameter(const char *id);
+  int getParameterCount();
+  WiFiManagerParameter *getParameter(int index);
+  // Remove all parameters and free their value buffers, e.g. to add a
+  // different set for re-provisioning
+  void resetParameters();
+  // heap used for the value buffers of parameters, and the part in use
+  size_t getParameterArenaSize();
+  size_t getParameterArenaUsed();
   // if this is set, it will exit after config, even if connection is
   // unsuccessful.
   void setBreakAfterConfig(boolean shouldBreak);
@@ -194,15 +617,44 @@ class WiFiManager {
   void setCustomHeadElement(const char *element);
   // if this is true, remove duplicated Access Points - defaut true
   void setRemoveDuplicateAPs(boolean removeDuplicates);
-
-  void setDefaultHostname(String hostname);
+  // scan results younger than this are shown without scanning again; older
+  // ones are shown while a new scan runs in the background. Default 30 s
+  void setScanCacheTTL(unsigned long seconds);
+  // e.g. only scan channels 1, 6 and 11:
+  // setScanProfile(WiFiManager::SCAN_PORTAL_START,
+  //                {(1 << 1) | (1 << 6) | (1 << 11), false, 0, false});
+  void setScanProfile(ScanPurpose purpose,
+                      const WiFiManagerScanProfile &profile);
+  // measured duration of the last scan done for purpose, in ms
+  unsigned long getLastScanDuration(ScanPurpose purpose);
+
+  // at most 63 characters; longer names are truncated
+  void setDefaultHostname(const char *hostname);
+  void setDefaultHostname(const String &hostname);
   String getHostname();
+  // the same without a String copy; valid until the hostname changes
+  const char *getHostnameCStr();
   uint64_t getMac();
   String getMacAsString(bool insertColons);
+  ConnectTiming getLastConnectTiming();
+  // The last WIFI_MANAGER_CONNECT_LOG_SIZE connect attempts, newest (index 0)
+  // first. Kept in RTC memory, so it survives soft resets but not power loss
+  int getConnectLogCount();
+  bool getConnectLog(int index, WiFiManagerConnectRecord *record);
+  void clearConnectLog();
+  // total time of the last connect, including the retry on the full path
+  unsigned long getLastConnectDuration();
+  // time from starting the config portal until its AP, DNS and HTTP server
+  // were up, in ms. 0 while the portal is still starting
+  unsigned long getTimeToPortal();
+  // request counts, latencies and heap use of the portal; also served as
+  // Prometheus text at /metrics. While the portal task runs, values may be
+  // read in the middle of an update
+  const Metrics &getMetrics();
   void appendMacToHostname(bool value);
 
  private:
-  std::unique_ptr<DNSServer> dnsServer;
+  std::unique_ptr<WiFiManagerDNS> dnsServer;
 #ifdef ESP8266
   std::unique_ptr<ESP8266WebServer> server;
 #else
@@ -216,20 +668,42 @@ class WiFiManager {
   // name=\"viewport\" content=\"width=device-width,
   // initial-scale=1\"/><title>{v}</title>";
 
+  enum PortalPhase {
+    PORTAL_PHASE_IDLE,
+    PORTAL_PHASE_STARTING,  // AP up, waiting for its IP before starting DNS
+    PORTAL_PHASE_SERVING,
+    PORTAL_PHASE_CONNECT_DELAY,  // credentials saved, let the page go out
+    PORTAL_PHASE_CONNECTING,
+  };
+
   void setupConfigPortal();
+  void setPortalPhase(PortalPhase phase);
+  void notifyStatus();
+  void notifyAPStarted();
+  void notifyConfigSaved();
   void startWPS();
 
   const char *_apName = "no-net";
   const char *_apPassword = NULL;
-  String _ssid = "";
-  String _pass = "";
-  String _defaultHostname = "ESP";
-  String _hostname = "ESP";
+  // fixed size, so connecting and serving pages do not allocate
+  char _ssid[33] = "";
+  char _pass[65] = "";
+  char _defaultHostname[64] = "ESP";
+  char _hostname[64] = "ESP";
   bool _appendMacToHostname = true;
   unsigned long _configPortalTimeout = 0;
   unsigned long _connectTimeout = 0;
   unsigned long _configPortalStart = 0;
 
+  PortalPhase _portalPhase = PORTAL_PHASE_IDLE;
+  unsigned long _portalPhaseStart = 0;
+  unsigned long _portalBegin = 0;
+  unsigned long _timeToPortal = 0;
+  int _connectAttempt = 0;
+  unsigned long _connectStart = 0;
+  boolean _resetRequested = false;
+  unsigned long _resetRequestTime = 0;
+
   IPAddress _ap_static_ip;
   IPAddress _ap_static_gw;
   IPAddress _ap_static_sn;
@@ -237,7 +711,43 @@ class WiFiManager {
   IPAddress _sta_static_gw;
   IPAddress _sta_static_sn;
 
-  int _paramsCount = 0;
+  // WIFI_MANAGER_MAX_SCAN_RESULTS entries each; only allocated while the
+  // portal runs or a scan is in flight (NULL otherwise)
+  std::unique_ptr<WiFiManagerScanResult[]> _scanResults;
+  int _scanResultCount = 0;
+  // key (SSID or BSSID hash) and RSSI of the previous scan, sorted by key
+  struct RssiSample {
+    uint32_t key;
+    int8_t rssi;
+  };
+  std::unique_ptr<RssiSample[]> _rssiHistory;
+  int _rssiHistoryCount = 0;
+  bool allocateScanTable();
+  void freeScanTable();
+  boolean _scanInFlight = false;
+  unsigned long _scanCompleted = 0;
+  unsigned long _scanCacheTTL = 30000;
+  // incremented on every finished scan; 0 while there are no results
+  uint32_t _scanGeneration = 0;
+  static const uint16_t SCAN_ALL_CHANNELS = 1;  // channel "0"
+  WiFiManagerScanProfile _scanProfiles[SCAN_PURPOSE_COUNT] = {
+      {0, false, 0, false}, {0, false, 0, false}, {0, false, 0, false}};
+  unsigned long _scanDuration[SCAN_PURPOSE_COUNT] = {0, 0, 0};
+  ScanPurpose _scanPurpose = SCAN_PORTAL_START;
+  unsigned long _scanStarted = 0;
+  uint16_t _scanChannelsLeft = 0;
+  int _scanRawCount = 0;  // entries collected by the scan in progress
+  uint8_t _scanChannelsDone = 0;  // that returned results, even if none
+  void addScanResults(int n);
+  void finishScan();
+  void prepareScan(ScanPurpose purpose);
+  boolean startScanChannel(boolean async);
+  void runScan(ScanPurpose purpose);
+  void startScan(ScanPurpose purpose);
+  void pollScan();
+  int getScanProgress();
+  boolean scanIsStale();
+
   int _minimumQuality = -1;
   boolean _removeDuplicateAPs = true;
   boolean _shouldBreakAfterConfig = false;
@@ -249,24 +759,122 @@ class WiFiManager {
   // void          setEEPROMString(int start, int len, String string);
 
   int wifiStatus = WL_IDLE_STATUS;
-  int connectWifi(String ssid, String pass);
-  int doConnectWifi(String ssid, String pass, int count);
+  int connectWifi(const char *ssid, const char *pass, bool hidden = false);
+  int doConnectWifi(const char *ssid, const char *pass, int count);
+  boolean beginConnectWifi(const char *ssid, const char *pass, int count);
   uint8_t waitForConnectResult();
-
-  bool checkName(String tmp);
+  int pollConnectResult();
+  unsigned long attemptTimeout();
+  bool _hiddenAttempt = false;  // connectWifi() of a hidden network
+  void startConnectTiming(uint8_t attempt);
+  void finishConnectTiming(int result);
+  WiFiManagerConnectRecord *_connectRecord = NULL;  // attempt in progress
+  int32_t _connectScanTime = -1;  // for the next record
+  void onWiFiEvent(int event, uint8_t reason);
+
+  EventGroupHandle_t _wifiEvents = NULL;
+  wifi_event_id_t _wifiEventId = 0;  // valid if _wifiEvents is not NULL
+  ConnectTiming _connectTiming = {-1, -1, -1, 0, CONNECT_PATH_NONE};
+  unsigned long _connectDuration = 0;
+
+  // BSSID and channel to try first when connecting to _ssid; valid if the
+  // channel is not 0
+  uint8_t _cachedBssid[6];
+  uint8_t _cachedChannel = 0;
+
+  WiFiManagerNetwork _networks[WIFI_MANAGER_MAX_NETWORKS];
+  int _networkCount = 0;
+  uint32_t _networkSequence = 0;  // highest lastSuccess
+  int findNetwork(const char *ssid);
+  void selectNetwork(int index);
+  int stageNetwork(const char *ssid, const char *pass, uint8_t priority,
+                   bool hidden = false);
+  void loadNetworks();
+  void saveConnectResult(const char *ssid, bool connected);
+  boolean connectKnownNetworks();
+
+  // Settings are changed in RAM and marked dirty; commitConfig() then writes
+  // the dirty ones whose value differs from the stored one. It returns false
+  // if a write failed
+  enum ConfigKey {
+    CONFIG_KEY_NETWORKS = 1 << 0,
+    CONFIG_KEY_HOSTNAME = 1 << 1,
+    CONFIG_KEY_PARAMETERS = 1 << 2,  // only stored in the blob format
+    CONFIG_KEY_ALL = 0x07,
+  };
+  ConfigFormat _configFormat = CONFIG_FORMAT_KEYS;
+  uint8_t _configDirty = 0;
+  ConfigChanges _configChanges = {0, 0};  // since the portal was started
+  uint32_t _configWrites = 0;
+  uint32_t _configBytesWritten = 0;
+  bool commitConfig();
+  bool putIfChanged(const char *key, const void *value, size_t len);
+  bool putIfChanged(const char *key, const char *value);
+  bool putIfChanged(const char *key, bool value);
+  unsigned long _configLoadTime = 0;
+  void loadConfig();
+
+  // blob format: slot that holds the newest version and its sequence number
+  // and CRC, so an unchanged config is not written again
+  int8_t _configSlot = -1;
+  uint32_t _configSequence = 0;
+  uint32_t _configCRC = 0;
+  // custom parameters as stored in the blob; applied by addParameter()
+  std::unique_ptr<uint8_t[]> _storedParams;
+  size_t _storedParamsLength = 0;
+  bool loadConfigBlob();
+  bool saveConfigBlob();
+  void restoreParameter(WiFiManagerParameter *param);
+  bool hasParameter(const uint8_t *id, size_t idLength);
+
+  bool _useHostname = false;  // _hostname was set in the portal
+  bool checkName(const String &name);
   void readHostname();
   void readNetworkCredentials();
 
+  void sendPageHead(WiFiManagerPageWriter &page, const char *title);
+
   void handleRoot();
   void handleWifi(boolean scan);
   void handleWifiSave();
+  void handleScanJSON();
+  void handleMetrics();
+  Metrics _metrics = {};
+  void onRoute(const char *uri, Route route, std::function<void()> handler);
+  void handleRoute(Route route, const std::function<void()> &handler);
   void handleChangeName(boolean showError);
   void handleSaveName();
   void handleInfo();
   void handleReset();
   void handleNotFound();
-  void handle204();
+  void handleAsset(const uint8_t *data, size_t length, const char *contentType,
+                   PGM_P etag);
+  void handleProbe();
   boolean captivePortal();
+  void redirectToPortal();
+  String _portalUrl;  // Location of redirects; set when the AP has its IP
+
+  // Rendered pages, valid as long as _pageGeneration does not change. Anything
+  // shown on these pages must call invalidatePages() when it changes
+  enum CachedPage {
+    PAGE_WIFI,
+    PAGE_WIFI_NO_SCAN,
+    PAGE_INFO,
+    PAGE_COUNT,
+  };
+  struct PageCacheEntry {
+    char *body;
+    size_t length;
+    uint32_t generation;
+    unsigned long lastUsed;
+  };
+  PageCacheEntry _pageCache[PAGE_COUNT] = {};
+  uint32_t _pageGeneration = 0;
+  void invalidatePages();
+  bool sendCachedPage(CachedPage id);
+  void cachePage(CachedPage id, WiFiManagerPageWriter &page);
+  void clearPageCache();
+
   boolean configPortalHasTimeout();
 
   // DNS server
@@ -274,7 +882,7 @@ class WiFiManager {
 
   // helpers
   int getRSSIasQuality(int RSSI);
-  boolean isIp(String str);
+  boolean isIp(const String &str);
   String toStringIp(IPAddress ip);
 
   boolean connect;
@@ -283,11 +891,35 @@ class WiFiManager {
 
   void (*_apcallback)(WiFiManager *) = NULL;
   void (*_savecallback)(void) = NULL;
+  void (*_configChangedCallback)(const ConfigChanges &changes) = NULL;
   void (*_statusCb)(Status status) = nullptr;
 
   Status status;
 
-  WiFiManagerParameter *_params[WIFI_MANAGER_MAX_PARAMS];
+#if !defined(ESP8266)
+  QueueHandle_t _portalEvents = NULL;
+  QueueHandle_t _portalCommands = NULL;
+  // stored by the portal task itself, about once a second and when it ends
+  volatile UBaseType_t _portalTaskStackHighWaterMark = 0;
+
+  static void portalTask(void *arg);
+  void postPortalEvent(PortalEventType type, PortalResult result,
+                       TickType_t wait);
+#endif
+
+  // in the order they were added, with an open addressing hash table of
+  // indices into _params by id (-1: empty slot)
+  std::vector<WiFiManagerParameter *> _params;
+  std::vector<int16_t> _paramIndex;
+  // which of _params a save submitted; kept so saving does not allocate
+  std::vector<bool> _paramSubmitted;
+  WiFiManagerArena _paramArena;  // value buffers of _params
+  int findParameter(const char *id);
+  void indexParameter(int index);
+  void rebuildParameterIndex();
+  void removeParameter(WiFiManagerParameter *p);
+  void replaceParameter(WiFiManagerParameter *from, WiFiManagerParameter *to);
+  friend class WiFiManagerParameter;
 
   template <typename Generic>
   void DEBUG_WM(Generic text);
@@ -1,7 +1,6 @@
 #include <WiFiManager.h>          //https://github.com/admarschoonen/WiFiManager
 #include <ESPmDNS.h>
 
-String hostname;
 WiFiServer server(80);
 
 void setup() {
@@ -28,8 +27,7 @@ void setup() {
     Serial.print("connected with address: ");
     Serial.println(WiFi.localIP());
 
-    hostname = wifiManager.getHostname();
-    if (!MDNS.begin(hostname.c_str())) {
+    if (!MDNS.begin(wifiManager.getHostnameCStr())) {
       Serial.println("Error setting up MDNS responder!");
       while(1) {
         delay(1000);
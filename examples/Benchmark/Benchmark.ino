@@ -0,0 +1,147 @@
+// Measures how fast WiFiManager reads its settings, brings up the portal and
+// serves its pages, and prints the results as "bench,<name>,<value>,<unit>"
+// lines so runs of different versions of the library can be compared.
+//
+// The pages are requested by the ESP32 itself, over the access point of the
+// portal, while the portal runs in its own task. Use a spare board: the
+// benchmark adds and removes a network in the stored settings.
+#if defined(ESP8266)
+#error "This benchmark needs the portal task, which is only available on ESP32"
+#endif
+
+#include <WiFi.h>
+#include <WiFiManager-esp32.h>
+
+// custom parameters on the config page
+#define NUM_PARAMS 10
+// requests per page
+#define REQUESTS 20
+
+WiFiManager wifiManager;
+WiFiManagerParameter *params[NUM_PARAMS];
+char paramIds[NUM_PARAMS][8];
+
+struct Page {
+  const char *path;
+  WiFiManager::Route route;
+};
+
+const Page pages[] = {
+    {"/wifi", WiFiManager::ROUTE_WIFI},
+    {"/0wifi", WiFiManager::ROUTE_WIFI_NO_SCAN},
+    {"/scan.json", WiFiManager::ROUTE_SCAN_JSON},
+    {"/i", WiFiManager::ROUTE_INFO},
+    {"/wm.css", WiFiManager::ROUTE_ASSET},
+    {"/generate_204", WiFiManager::ROUTE_PROBE},
+    {"/metrics", WiFiManager::ROUTE_METRICS},
+};
+
+void report(const char *name, unsigned long value, const char *unit) {
+  Serial.printf("bench,%s,%lu,%s\n", name, value, unit);
+}
+
+// GET a page of the portal; returns the size of the response or -1
+long get(const char *path) {
+  WiFiClient client;
+
+  if (!client.connect(WiFi.softAPIP(), 80)) {
+    return -1;
+  }
+  client.printf("GET %s HTTP/1.0\r\nHost: %s\r\n\r\n", path,
+                WiFi.softAPIP().toString().c_str());
+  long size = 0;
+  unsigned long start = millis();
+  while ((client.connected() || client.available()) &&
+         millis() - start < 5000) {
+    uint8_t buf[256];
+    int n = client.read(buf, sizeof(buf));
+    if (n > 0) {
+      size += n;
+    } else {
+      delay(1);
+    }
+  }
+  client.stop();
+  return size;
+}
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println();
+
+  wifiManager.setDebugOutput(false);
+  wifiManager.setConfigFormat(WiFiManager::CONFIG_FORMAT_BLOB);
+  wifiManager.configure("bench", nullptr);
+  report("config_load", wifiManager.getConfigLoadTime(), "us");
+
+  unsigned long start = micros();
+  for (int i = 0; i < NUM_PARAMS; i++) {
+    snprintf(paramIds[i], sizeof(paramIds[i]), "p%d", i);
+    params[i] = new WiFiManagerParameter(paramIds[i], paramIds[i], "value", 32);
+    wifiManager.addParameter(params[i]);
+  }
+  report("add_parameters", micros() - start, "us");
+
+  start = micros();
+  wifiManager.addNetwork("wifimanager-bench", "password");
+  report("config_save", micros() - start, "us");
+  start = micros();
+  wifiManager.removeNetwork("wifimanager-bench");
+  report("config_save_remove", micros() - start, "us");
+
+  start = micros();
+  for (int i = 0; i < 1000; i++) {
+    wifiManager.getMacAsString(true);
+  }
+  report("mac_as_string_x1000", micros() - start, "us");
+
+  // core 0, priority 1, 8 KB stack
+  if (!wifiManager.startConfigPortalTask("bench", NULL, 0, 1, 8192)) {
+    Serial.println("could not start the portal task");
+    return;
+  }
+  start = millis();
+  while (wifiManager.getTimeToPortal() == 0 && millis() - start < 10000) {
+    delay(10);
+  }
+  report("time_to_portal", wifiManager.getTimeToPortal(), "ms");
+  while (wifiManager.getLastScanDuration(WiFiManager::SCAN_PORTAL_START) == 0 &&
+         millis() - start < 20000) {
+    delay(10);
+  }
+  report("first_scan",
+         wifiManager.getLastScanDuration(WiFiManager::SCAN_PORTAL_START), "ms");
+
+  for (size_t i = 0; i < sizeof(pages) / sizeof(pages[0]); i++) {
+    long size = 0;
+    start = micros();
+    for (int n = 0; n < REQUESTS; n++) {
+      size = get(pages[i].path);
+    }
+    char name[48];
+    snprintf(name, sizeof(name), "get%s", pages[i].path);
+    report(name, (micros() - start) / REQUESTS, "us");
+    snprintf(name, sizeof(name), "size%s", pages[i].path);
+    report(name, size, "bytes");
+  }
+
+  // time spent in the handlers, as measured by the portal itself
+  const WiFiManager::Metrics &metrics = wifiManager.getMetrics();
+  for (size_t i = 0; i < sizeof(pages) / sizeof(pages[0]); i++) {
+    const WiFiManager::RouteMetrics &route = metrics.routes[pages[i].route];
+    char name[48];
+    snprintf(name, sizeof(name), "handler%s", pages[i].path);
+    unsigned long mean =
+        route.requests ? (unsigned long)(route.latencySum / route.requests) : 0;
+    report(name, mean, "us");
+  }
+  report("page_cache_hits", metrics.pageCacheHits, "requests");
+  report("min_free_heap", metrics.minFreeHeap, "bytes");
+  report("portal_stack_left", wifiManager.getPortalTaskStackHighWaterMark(),
+         "words");
+
+  wifiManager.stopConfigPortalTask();
+  Serial.println("bench,done");
+}
+
+void loop() {}
@@ -0,0 +1,271 @@
+'use strict';
+
+// Load generator for the config portal: simulates a number of phones that
+// join the access point at the same time and reports throughput, latency,
+// errors and the heap of the device.
+//
+// Connect the computer running this to the access point of the portal, then
+//   node loadgen.js [--host 192.168.4.1] [--port 80] [--dns-port 53]
+//                   [--phones 20] [--duration 30] [--submit]
+// With --submit the last phone saves the config form, after which the device
+// stops the portal and tries to connect.
+//
+// Against the host build of the portal (test/portal_host.cpp) use
+//   --host 127.0.0.1 --port 8080 --dns-port 5353
+// Each phone then sends from its own loopback address, 127.0.0.2 and up, so
+// the portal tells them apart as it does phones on its access point.
+// --address is the address of the portal as the phones know it, sent as the
+// Host header.
+
+const dgram = require('dgram');
+const http = require('http');
+
+const options = {
+  host: '192.168.4.1',
+  port: 80,
+  'dns-port': 53,
+  address: '192.168.4.1',
+  phones: 20,
+  duration: 30,
+  submit: false,
+};
+
+for (let i = 2; i < process.argv.length; i++) {
+  const name = process.argv[i].replace(/^--/, '');
+  if (!(name in options)) {
+    console.log('unknown option', process.argv[i]);
+    process.exit(1);
+  }
+  if (typeof options[name] === 'boolean') {
+    options[name] = true;
+  } else {
+    options[name] = typeof options[name] === 'number' ?
+      Number(process.argv[++i]) : process.argv[++i];
+  }
+}
+
+// URLs that operating systems request to detect a captive portal
+const probes = [
+  '/generate_204', '/hotspot-detect.html', '/connecttest.txt', '/ncsi.txt',
+];
+
+// names looked up by a phone right after joining a network
+const names = [
+  'connectivitycheck.gstatic.com', 'captive.apple.com',
+  'www.msftconnecttest.com', 'clients3.google.com', 'time.android.com',
+  'mtalk.google.com',
+];
+
+const timeout = 5000;
+const stats = {};
+
+// kind null: not part of the load, not counted
+function record(kind, start, outcome) {
+  if (kind === null) {
+    return;
+  }
+  if (!(kind in stats)) {
+    stats[kind] = { latencies: [], errors: 0, dropped: 0 };
+  }
+  const s = stats[kind];
+  if (outcome === 'ok') {
+    s.latencies.push(Number(process.hrtime.bigint() - start) / 1e6);
+  } else {
+    s[outcome]++;
+  }
+}
+
+function sleep(ms) {
+  return new Promise((resolve) => setTimeout(resolve, ms));
+}
+
+// the address phone index sends from; undefined: let the system pick
+function localAddress(index) {
+  if (index === undefined || !options.host.startsWith('127.')) {
+    return undefined;
+  }
+  return '127.0.0.' + (2 + index % 250);
+}
+
+function request(kind, method, path, body, index) {
+  return new Promise((resolve) => {
+    const start = process.hrtime.bigint();
+    const req = http.request({
+      host: options.host,
+      port: options.port,
+      localAddress: localAddress(index),
+      path: path,
+      method: method,
+      agent: false,
+      timeout: timeout,
+      headers: body ? {
+        'Host': options.address,
+        'Content-Type': 'application/x-www-form-urlencoded',
+        'Content-Length': Buffer.byteLength(body),
+      } : { 'Host': options.address },
+    }, (res) => {
+      let data = '';
+      res.setEncoding('utf8');
+      res.on('data', (chunk) => { data += chunk; });
+      res.on('end', () => {
+        if (res.statusCode >= 400) {
+          record(kind, start, 'errors');
+        } else {
+          record(kind, start, 'ok');
+        }
+        resolve(data);
+      });
+      res.on('error', () => {
+        record(kind, start, 'dropped');
+        resolve(null);
+      });
+    });
+    req.on('timeout', () => req.destroy(new Error('timeout')));
+    req.on('error', () => {
+      record(kind, start, 'dropped');
+      resolve(null);
+    });
+    if (body) {
+      req.write(body);
+    }
+    req.end();
+  });
+}
+
+function dnsQuery(name, type, id) {
+  const labels = name.split('.').map((label) =>
+    Buffer.concat([Buffer.from([label.length]), Buffer.from(label)]));
+  return Buffer.concat([
+    Buffer.from([id >> 8, id & 0xff, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0]),
+    ...labels,
+    Buffer.from([0, type >> 8, type & 0xff, 0, 1]),
+  ]);
+}
+
+// one A and one AAAA lookup per name, all sent at once like a phone does
+function dnsBurst(index) {
+  return new Promise((resolve) => {
+    const socket = dgram.createSocket('udp4');
+    const pending = new Map();
+    let id = Math.floor(Math.random() * 0x8000);
+
+    socket.on('message', (msg) => {
+      const start = pending.get(msg.readUInt16BE(0));
+      if (start !== undefined) {
+        pending.delete(msg.readUInt16BE(0));
+        record('dns', start, (msg[3] & 0x0f) === 0 ? 'ok' : 'errors');
+      }
+      if (pending.size === 0) {
+        finish();
+      }
+    });
+    const timer = setTimeout(finish, 1000);
+    function finish() {
+      clearTimeout(timer);
+      for (const start of pending.values()) {
+        record('dns', start, 'dropped');
+      }
+      pending.clear();
+      socket.close();
+      resolve();
+    }
+
+    socket.bind({ address: localAddress(index) }, () => {
+      for (const name of names) {
+        for (const type of [1, 28]) {
+          id = (id + 1) & 0xffff;
+          pending.set(id, process.hrtime.bigint());
+          socket.send(dnsQuery(name, type, id), options['dns-port'],
+            options.host);
+        }
+      }
+    });
+  });
+}
+
+async function phone(index, end) {
+  // phones do not all join in the same millisecond
+  await sleep(Math.random() * 2000);
+  await dnsBurst(index);
+  await Promise.all(probes.map((path) =>
+    request('probe', 'GET', path, null, index)));
+  await request('wifi', 'GET', '/wifi', null, index);
+
+  let next = 0;
+  while (Date.now() < end) {
+    await request('scan.json', 'GET', '/scan.json?scan=1', null, index);
+    if (next++ % 5 === 4) {
+      // the page reloads itself after a save; some users also hit refresh
+      await request('0wifi', 'GET', '/0wifi', null, index);
+      await Promise.all(probes.slice(0, 2).map((path) =>
+        request('probe', 'GET', path, null, index)));
+    }
+    await sleep(1000);
+  }
+  if (options.submit && index === options.phones - 1) {
+    await request('wifisave', 'POST', '/wifisave',
+      's=loadgen&p=password&p0=value', index);
+  }
+}
+
+function percentile(sorted, p) {
+  if (sorted.length === 0) {
+    return 0;
+  }
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+function metric(text, name) {
+  const match = text && text.match(new RegExp('^' + name + ' (\\d+)', 'm'));
+  return match ? Number(match[1]) : NaN;
+}
+
+async function main() {
+  const before = await request(null, 'GET', '/metrics');
+  if (before === null) {
+    console.log('cannot reach the portal at', options.host);
+    process.exit(1);
+  }
+
+  console.log('simulating', options.phones, 'phones for', options.duration,
+    'seconds');
+  const start = Date.now();
+  const end = start + options.duration * 1000;
+  const phones = [];
+  for (let i = 0; i < options.phones; i++) {
+    phones.push(phone(i, end));
+  }
+  await Promise.all(phones);
+  const elapsed = (Date.now() - start) / 1000;
+
+  console.log('kind        requests   req/s   p50 ms   p99 ms  errors' +
+    '  dropped');
+  for (const kind of Object.keys(stats)) {
+    const s = stats[kind];
+    const sorted = s.latencies.slice().sort((a, b) => a - b);
+    const total = sorted.length + s.errors + s.dropped;
+    console.log(kind.padEnd(10),
+      String(total).padStart(9),
+      (total / elapsed).toFixed(1).padStart(7),
+      percentile(sorted, 0.5).toFixed(1).padStart(8),
+      percentile(sorted, 0.99).toFixed(1).padStart(8),
+      String(s.errors).padStart(7),
+      String(s.dropped).padStart(8));
+  }
+
+  if (options.submit) {
+    // the portal is gone once the form has been saved
+    return;
+  }
+  const after = await request(null, 'GET', '/metrics');
+  console.log('lowest free heap:',
+    metric(after, 'wifimanager_heap_min_free_bytes'), 'bytes');
+  console.log('page cache hits:',
+    metric(after, 'wifimanager_page_cache_hits_total') -
+    metric(before, 'wifimanager_page_cache_hits_total'));
+  console.log('dns queries:',
+    metric(after, 'wifimanager_dns_queries_total') -
+    metric(before, 'wifimanager_dns_queries_total'));
+}
+
+main();
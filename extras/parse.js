@@ -1,11 +1,25 @@
 'use strict';
 
 const fs = require('fs');
+const zlib = require('zlib');
+const crypto = require('crypto');
 
 console.log('starting');
 
 const inFile = 'WiFiManager.template.html';
 const outFile = 'template.h';
+const assetsFile = '../WiFiManager-esp32-assets.h';
+
+// blocks that are also served as separate, cacheable files; the wrapping
+// <style>/<script> tag is stripped and the content is gzip compressed. The
+// pages link them with a hash of the content in the URL ({v}), so a changed
+// asset is never taken from the cache of the browser
+const assets = {
+  HTTP_STYLE: { name: 'WM_ASSET_STYLE', tag: 'style',
+    link: '<link rel="stylesheet" href="/wm.css?v={v}">' },
+  HTTP_SCRIPT: { name: 'WM_ASSET_SCRIPT', tag: 'script',
+    link: '<script src="/wm.js?v={v}"></script>' },
+};
 
 const defineRegEx = /<!-- ([A-Z_]+) -->/gm;
 console.log('parsing', inFile);
@@ -19,8 +33,13 @@ fs.readFile(inFile, 'utf8', function (err,data) {
   let defines = data.match(defineRegEx);
 
   //console.log(defines);
+  var assetStream = fs.createWriteStream(assetsFile);
+  assetStream.write('// Generated by extras/parse.js from WiFiManager.template.html; do not edit\n\n');
+  assetStream.write('#ifndef WiFiManager_assets_h\n#define WiFiManager_assets_h\n\n');
+
   var stream = fs.createWriteStream(outFile);
   stream.once('open', function(fd) {
+    let links = '';
     for (const i in defines) {
 
       const start = defines[i];
@@ -53,8 +72,35 @@ fs.readFile(inFile, 'utf8', function (err,data) {
         }
         string += '= "' + def + '";\n';
         stream.write(string);
+
+        if (assets[constantName]) {
+          links += writeAsset(assetStream, assets[constantName], extractArray[1]);
+        }
       }
     }
     stream.end();
+    assetStream.write('const char WM_HTTP_ASSETS[] PROGMEM = "' + links.replace(/"/g, '\\"') + '";\n\n');
+    assetStream.write('#endif\n');
+    assetStream.end();
   });
 });
+
+// returns the link to the asset
+function writeAsset(stream, asset, html) {
+  let content = html.replace(/\s+/g, ' ').trim();
+  content = content.replace(new RegExp('^<' + asset.tag + '>\\s*'), '');
+  content = content.replace(new RegExp('\\s*</' + asset.tag + '>$'), '');
+
+  const gz = zlib.gzipSync(Buffer.from(content, 'utf8'), { level: 9 });
+  const version = crypto.createHash('sha1').update(content).digest('hex').substr(0, 16);
+  const etag = '"' + version + '"';
+  console.log(asset.name, content.length, 'bytes,', gz.length, 'bytes compressed');
+
+  stream.write('const char ' + asset.name + '_ETAG[] PROGMEM = "' + etag.replace(/"/g, '\\"') + '";\n');
+  stream.write('const uint8_t ' + asset.name + '_GZ[] PROGMEM = {');
+  for (let i = 0; i < gz.length; i++) {
+    stream.write((i % 16 === 0 ? '\n    ' : ' ') + '0x' + ('0' + gz[i].toString(16)).substr(-2) + (i < gz.length - 1 ? ',' : ''));
+  }
+  stream.write('};\n\n');
+  return asset.link.replace('{v}', version);
+}
@@ -0,0 +1,25 @@
+// Stand-in for the DNSServer library of the core, which the library used
+// before it answered DNS itself; only for rendering the baseline pages
+
+#ifndef DNSServer_h
+#define DNSServer_h
+
+#include <stdint.h>
+
+#include "IPAddress.h"
+#include "WString.h"
+
+enum class DNSReplyCode { NoError = 0 };
+
+class DNSServer {
+ public:
+  void setErrorReplyCode(DNSReplyCode /* code */) {}
+  bool start(uint16_t /* port */, const String & /* domainName */,
+             IPAddress /* resolvedIP */) {
+    return true;
+  }
+  void processNextRequest() {}
+  void stop() {}
+};
+
+#endif
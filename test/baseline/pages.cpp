@@ -0,0 +1,82 @@
+// Renders /, /wifi, /0wifi and /i with the library as it was before the page
+// writer, from the portal of test_pages.cpp as far as that library can set it
+// up; built and run by render.sh. The portal is set up the way
+// startConfigPortal() did, without its blocking loop, so the handlers are
+// reached through the private members.
+
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+
+#include "DNSServer.h"
+#include "WebServer.h"
+#include "WiFi.h"
+#include "esp_wifi.h"
+#include "host.h"
+// everything the header includes comes first, so only its classes change
+#define private public
+#include <WiFiManager-esp32.h>
+#undef private
+
+// the scan results of the library at that time
+extern int n_wifi_networks;
+
+namespace {
+
+bool save(const std::string &dir, const char *name, const std::string &body) {
+  std::string path = dir + "/" + name;
+  FILE *file = fopen(path.c_str(), "wb");
+  if (file == NULL) {
+    perror(path.c_str());
+    return false;
+  }
+  fwrite(body.data(), 1, body.size(), file);
+  fclose(file);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: pages <directory of the goldens>\n");
+    return 1;
+  }
+  std::string dir = argv[1];
+
+  host::reset();
+  host::addNetwork("home", "secret", 2, -50);
+  host::addNetwork("office \"5G\"", "password", 1, -70);
+  host::addNetwork("cafe <free>", "", 1, -85);
+
+  WiFiManager wm;
+  WiFiManagerParameter text("<p>MQTT</p>");
+  WiFiManagerParameter server("server", "Server", "mqtt.local", 40);
+  WiFiManagerParameter port("port", "Port", "1883", 6);
+  WiFiManagerParameter token("token", "API token", "", 32,
+                             "type='password'");
+  wm.setDebugOutput(false);
+  wm.configure("pages", nullptr);
+  wm.addParameter(&text);
+  wm.addParameter(&server);
+  wm.addParameter(&port);
+  wm.addParameter(&token);
+  wm.setSTAStaticIPConfig(IPAddress(192, 168, 1, 50),
+                          IPAddress(192, 168, 1, 1),
+                          IPAddress(255, 255, 255, 0));
+
+  // the scan before the portal, then the AP and the servers
+  WiFi.disconnect(true);
+  n_wifi_networks = WiFi.scanNetworks();
+  WiFi.mode(WIFI_AP_STA);
+  wm._apName = "pages";
+  wm.setupConfigPortal();
+
+  bool ok = save(dir, "root.html", host::get("/").body) &&
+            save(dir, "0wifi.html", host::get("/0wifi").body) &&
+            save(dir, "info.html", host::get("/i").body) &&
+            // starts a new scan, so last
+            save(dir, "wifi.html", host::get("/wifi").body);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,20 @@
+#!/bin/sh
+# Writes the goldens of /, /wifi, /0wifi and /i in pages/ with the library of
+# a past revision, by default the one before the page writer, built against
+# the stand-ins in host/. test_pages.cpp lists the changes made to these
+# pages since. From the test directory:
+#   baseline/render.sh [revision]
+
+set -e
+
+revision=${1:-dbfa359}
+build=$(mktemp -d)
+trap 'rm -rf "$build"' EXIT
+
+for file in WiFiManager-esp32.cpp WiFiManager-esp32.h; do
+  git show "$revision:$file" > "$build/$file"
+done
+# the library of that time does not build warning-clean
+${CXX:-c++} -std=c++17 -w -Ibaseline -Ihost -I"$build" -o "$build/pages" \
+  baseline/pages.cpp "$build/WiFiManager-esp32.cpp" host/*.cpp
+"$build/pages" pages
@@ -0,0 +1,296 @@
+// Host benchmarks of WiFiManager, printed as "bench,<name>,<value>,<unit>"
+// lines like examples/Benchmark, so runs of different commits can be
+// compared. Times are of the host CPU; the radio and the clock of the device
+// are simulated, so they do not add to them. Allocation counts and peak heap
+// are those of the library only.
+//
+//   bench [--quick]
+//
+// --quick does few repetitions, to check that the benchmarks still run.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <WiFiManager-esp32.h>
+
+#include "host.h"
+
+namespace {
+
+int repetitions = 200;
+
+// access points in the scan; NETWORKS SSIDs with several APs each
+const int APS = 48;
+const int NETWORKS = 16;
+const int PARAMS = 10;
+
+void report(const char *name, unsigned long value, const char *unit) {
+  printf("bench,%s,%lu,%s\n", name, value, unit);
+}
+
+double now() {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// mean time and allocations of fn, run repetitions times
+template <typename Fn>
+void measure(const char *name, Fn fn) {
+  unsigned long allocations = host::heapStats().allocations;
+  double start = now();
+  for (int i = 0; i < repetitions; i++) {
+    fn(i);
+  }
+  double elapsed = now() - start;
+  char label[64];
+  snprintf(label, sizeof(label), "%s", name);
+  report(label, (unsigned long)(1000 * elapsed / repetitions), "ns");
+  snprintf(label, sizeof(label), "%s_allocations", name);
+  report(label,
+         (host::heapStats().allocations - allocations) / repetitions,
+         "allocations");
+}
+
+void addAccessPoints(int aps, int networks) {
+  char ssid[33];
+  for (int i = 0; i < aps; i++) {
+    host::AccessPoint ap;
+    snprintf(ssid, sizeof(ssid), "network-%02d", i % networks);
+    ap.ssid = ssid;
+    ap.pass = "password";
+    memset(ap.bssid, 0, sizeof(ap.bssid));
+    ap.bssid[0] = 0x02;
+    ap.bssid[4] = i >> 8;
+    ap.bssid[5] = i;
+    ap.channel = 1 + i % 13;
+    ap.rssi = -40 - (i * 7) % 50;
+    ap.hidden = false;
+    host::addAccessPoint(ap);
+  }
+}
+
+// a DNS query for name, of type 1 (A), 28 (AAAA), ...
+std::vector<uint8_t> dnsQuery(uint16_t id, const char *name, uint16_t type) {
+  std::vector<uint8_t> packet = {(uint8_t)(id >> 8), (uint8_t)id, 0x01, 0x00,
+                                 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                 0x00};
+  while (*name) {
+    const char *dot = strchr(name, '.');
+    size_t length = dot ? dot - name : strlen(name);
+    packet.push_back(length);
+    packet.insert(packet.end(), name, name + length);
+    name += length + (dot ? 1 : 0);
+  }
+  packet.insert(packet.end(), {0x00, (uint8_t)(type >> 8), (uint8_t)type,
+                               0x00, 0x01});
+  return packet;
+}
+
+// runs the portal until the scan it started has been collected
+void runPortal(WiFiManager &wm, unsigned long ms) {
+  for (unsigned long i = 0; i < ms; i++) {
+    wm.processConfigPortal();
+    host::advance(1);
+  }
+}
+
+// time and allocations of collecting the results of a scan the portal
+// started; the radio itself takes no host time
+void measureScanCollect(WiFiManager &wm, const char *name) {
+  wm.setScanCacheTTL(0);
+  double collect = 0;
+  unsigned long allocations = 0;
+  for (int i = 0; i < repetitions; i++) {
+    host::get("/scan.json?scan=1");
+    host::advance(5000);
+    unsigned long before = host::heapStats().allocations;
+    double start = now();
+    wm.processConfigPortal();
+    collect += now() - start;
+    allocations += host::heapStats().allocations - before;
+  }
+  char label[64];
+  report(name, (unsigned long)(1000 * collect / repetitions), "ns");
+  snprintf(label, sizeof(label), "%s_allocations", name);
+  report(label, allocations / repetitions, "allocations");
+  wm.setScanCacheTTL(3600);
+}
+
+void benchConfig() {
+  host::reset();
+  {
+    WiFiManager wm;
+    wm.setDebugOutput(false);
+    wm.setConfigFormat(WiFiManager::CONFIG_FORMAT_BLOB);
+    wm.configure("bench", nullptr);
+    for (int i = 0; i < WIFI_MANAGER_MAX_NETWORKS; i++) {
+      char ssid[16];
+      snprintf(ssid, sizeof(ssid), "network-%02d", i);
+      wm.addNetwork(ssid, "password", i);
+    }
+  }
+
+  measure("config_load", [](int) {
+    WiFiManager wm;
+    wm.setDebugOutput(false);
+    wm.setConfigFormat(WiFiManager::CONFIG_FORMAT_BLOB);
+    wm.configure("bench", nullptr);
+  });
+
+  WiFiManager wm;
+  wm.setDebugOutput(false);
+  wm.setConfigFormat(WiFiManager::CONFIG_FORMAT_BLOB);
+  wm.configure("bench", nullptr);
+  measure("config_save", [&wm](int i) {
+    // alternately changes and restores the stored settings
+    wm.addNetwork("network-00", i % 2 ? "password" : "changed");
+  });
+
+  measure("add_parameters", [](int) {
+    WiFiManager wm;
+    WiFiManagerParameter params[PARAMS] = {
+        {"p0", "p0", "value", 32}, {"p1", "p1", "value", 32},
+        {"p2", "p2", "value", 32}, {"p3", "p3", "value", 32},
+        {"p4", "p4", "value", 32}, {"p5", "p5", "value", 32},
+        {"p6", "p6", "value", 32}, {"p7", "p7", "value", 32},
+        {"p8", "p8", "value", 32}, {"p9", "p9", "value", 32},
+    };
+    for (int i = 0; i < PARAMS; i++) {
+      wm.addParameter(&params[i]);
+    }
+  });
+
+  measure("mac_as_string", [&wm](int) { wm.getMacAsString(true); });
+}
+
+void benchPortal() {
+  host::reset();
+  addAccessPoints(APS, NETWORKS);
+
+  WiFiManager wm;
+  wm.setDebugOutput(false);
+  wm.configure("bench", nullptr);
+  WiFiManagerParameter params[PARAMS] = {
+      {"p0", "p0", "value", 32}, {"p1", "p1", "value", 32},
+      {"p2", "p2", "value", 32}, {"p3", "p3", "value", 32},
+      {"p4", "p4", "value", 32}, {"p5", "p5", "value", 32},
+      {"p6", "p6", "value", 32}, {"p7", "p7", "value", 32},
+      {"p8", "p8", "value", 32}, {"p9", "p9", "value", 32},
+  };
+  for (int i = 0; i < PARAMS; i++) {
+    wm.addParameter(&params[i]);
+  }
+
+  wm.beginConfigPortal("bench");
+  runPortal(wm, 5000);
+  report("time_to_portal", wm.getTimeToPortal(), "ms");
+  report("first_scan", wm.getLastScanDuration(WiFiManager::SCAN_PORTAL_START),
+         "ms");
+
+  // collecting the results of a scan: dedupe, smoothing and sorting
+  measureScanCollect(wm, "scan_collect");
+
+  const char *pages[] = {"/wifi", "/0wifi", "/scan.json", "/i", "/wm.css",
+                         "/metrics"};
+  for (size_t p = 0; p < sizeof(pages) / sizeof(pages[0]); p++) {
+    const char *page = pages[p];
+    char name[48];
+    snprintf(name, sizeof(name), "get%s", page);
+    host::resetHeapPeak();
+    size_t size = 0;
+    measure(name, [page, &size](int) { size = host::get(page).raw.size(); });
+    snprintf(name, sizeof(name), "size%s", page);
+    report(name, size, "bytes");
+    snprintf(name, sizeof(name), "peak_heap%s", page);
+    report(name, host::heapStats().peak - host::heapStats().inUse, "bytes");
+  }
+
+  // rendered every time: too little heap left for the page cache
+  host::setHeapSize(host::heapStats().inUse + 16 * 1024);
+  measure("render/wifi", [](int) { host::get("/wifi"); });
+  measure("render/i", [](int) { host::get("/i"); });
+  host::setHeapSize(200 * 1024);
+
+  // captive portal checks of new clients, redirected to the portal
+  std::vector<host::Request> probes(repetitions);
+  for (int i = 0; i < repetitions; i++) {
+    probes[i].uri = "/generate_204";
+    probes[i].headers["Host"] = "connectivitycheck.gstatic.com";
+    probes[i].client = IPAddress(10, 0, i >> 8, i);
+  }
+  measure("captive_redirect",
+          [&probes](int i) { host::request(probes[i]); });
+
+  // bursts of DNS lookups of phones joining the AP, answered per call
+  std::vector<std::vector<uint8_t>> burst;
+  for (int i = 0; i < WIFI_MANAGER_DNS_BURST; i++) {
+    burst.push_back(
+        dnsQuery(i, "connectivitycheck.gstatic.com", i % 2 ? 28 : 1));
+  }
+  double dns = 0;
+  unsigned long answers = 0;
+  for (int i = 0; i < repetitions; i++) {
+    for (const std::vector<uint8_t> &packet : burst) {
+      host::sendPacket(53, packet);
+    }
+    double start = now();
+    wm.processConfigPortal();
+    dns += now() - start;
+    answers += host::receivePackets().size();
+  }
+  report("dns_answers_per_s", (unsigned long)(answers / dns * 1e6),
+         "answers/s");
+
+  std::string form = "s=network-03&p=password&ip=&gw=&sn=";
+  for (int i = 0; i < PARAMS; i++) {
+    form += "&p" + std::to_string(i) + "=changed-value-" + std::to_string(i);
+  }
+  measure("wifisave", [&form](int) { host::post("/wifisave", form); });
+
+  wm.stopConfigPortal();
+}
+
+// synthetic scans of 10, 100 and 500 APs, a quarter of them with an SSID
+// of their own; the portal keeps the first WIFI_MANAGER_MAX_SCAN_RESULTS
+void benchScanSizes() {
+  const int sizes[] = {10, 100, 500};
+  for (int aps : sizes) {
+    host::reset();
+    addAccessPoints(aps, aps / 4);
+
+    WiFiManager wm;
+    wm.setDebugOutput(false);
+    wm.configure("bench", nullptr);
+    wm.beginConfigPortal("bench");
+    runPortal(wm, 5000);
+
+    char name[48];
+    snprintf(name, sizeof(name), "scan_collect/%d", aps);
+    measureScanCollect(wm, name);
+    // the list of networks the portal shows
+    size_t size = 0;
+    snprintf(name, sizeof(name), "get/scan.json/%d", aps);
+    measure(name, [&size](int) { size = host::get("/scan.json").raw.size(); });
+    snprintf(name, sizeof(name), "size/scan.json/%d", aps);
+    report(name, size, "bytes");
+    wm.stopConfigPortal();
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--quick") == 0) {
+    repetitions = 3;
+  }
+  benchConfig();
+  benchPortal();
+  benchScanSizes();
+  printf("bench,done\n");
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include "Arduino.h"
+
+#include <stdlib.h>
+
+#include <chrono>
+#include <map>
+#include <thread>
+
+#include "host.h"
+#include "sim.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace {
+
+uint64_t fakeNow = 0;  // us
+bool useReal = false;
+std::chrono::steady_clock::time_point realStart;
+int restarts = 0;
+int serialOutput = -1;  // -1: not decided yet
+std::map<uint16_t, uint16_t> ports;
+
+// wait on the clock of the host, delivering radio events meanwhile
+void waitReal(uint64_t us) {
+  uint64_t end = host::sim::now() + us;
+  host::sim::runEvents();
+  while (host::sim::now() < end) {
+    uint64_t left = end - host::sim::now();
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(left < 1000 ? left : 1000));
+    host::sim::runEvents();
+  }
+}
+
+}  // namespace
+
+namespace host {
+
+namespace sim {
+
+uint64_t now() {
+  if (useReal) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - realStart)
+        .count();
+  }
+  return fakeNow;
+}
+
+bool realClock() { return useReal; }
+
+void setNow(uint64_t time) { fakeNow = time; }
+
+uint16_t hostPort(uint16_t port) {
+  std::map<uint16_t, uint16_t>::const_iterator i = ports.find(port);
+  return i == ports.end() ? 0 : i->second;
+}
+
+}  // namespace sim
+
+void reset() {
+  fakeNow = 0;
+  restarts = 0;
+  sim::resetHeap();
+  sim::resetRadio();
+  sim::resetFlash();
+  sim::resetServers();
+  sim::resetUdp();
+}
+
+void advance(unsigned long ms) {
+  if (useReal) {
+    waitReal((uint64_t)ms * 1000);
+    return;
+  }
+  uint64_t target = fakeNow + (uint64_t)ms * 1000;
+  uint64_t time;
+  while (sim::nextEventTime(&time) && time <= target) {
+    if (time > fakeNow) {
+      fakeNow = time;
+    }
+    sim::runEvents();
+  }
+  fakeNow = target;
+}
+
+void useRealClock() {
+  useReal = true;
+  realStart = std::chrono::steady_clock::now();
+}
+
+int getRestartCount() { return restarts; }
+
+void mapPort(uint16_t port, uint16_t hostPort) { ports[port] = hostPort; }
+
+void setSerialOutput(bool enabled) { serialOutput = enabled; }
+
+}  // namespace host
+
+unsigned long millis() {
+  if (useReal) {
+    host::sim::runEvents();
+  }
+  return host::sim::now() / 1000;
+}
+
+unsigned long micros() {
+  if (useReal) {
+    host::sim::runEvents();
+  }
+  return host::sim::now();
+}
+
+void delay(uint32_t ms) { host::advance(ms); }
+
+void yield() {
+  if (useReal) {
+    host::sim::runEvents();
+    std::this_thread::yield();
+  } else {
+    host::advance(1);
+  }
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  if (serialOutput < 0) {
+    serialOutput = getenv("WM_HOST_SERIAL") != NULL;
+  }
+  if (serialOutput) {
+    fwrite(buffer, 1, size, stderr);
+  }
+  return size;
+}
+
+uint32_t EspClass::getFreeHeap() { return host::sim::heapFree(); }
+
+uint32_t EspClass::getMinFreeHeap() { return host::sim::heapMinFree(); }
+
+uint32_t EspClass::getMaxAllocHeap() { return host::sim::heapLargestFree(); }
+
+// MAC 24:0a:c4:12:34:56, first byte in the lowest bits like the efuse
+uint64_t EspClass::getEfuseMac() { return 0x563412c40a24ULL; }
+
+void EspClass::restart() { restarts++; }
@@ -0,0 +1,72 @@
+// Stand-in for the Arduino core of the ESP32, enough to build WiFiManager on
+// a Linux host. The clock, heap and radio are simulated; see host.h
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// there is no separate flash address space on the host
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define memcpy_P memcpy
+#define snprintf_P snprintf
+
+class __FlashStringHelper;
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper *>(p))
+#define F(s) FPSTR(PSTR(s))
+
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
+
+#include "IPAddress.h"
+#include "Print.h"
+#include "WString.h"
+#include "esp_arduino_version.h"
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void yield();
+
+class HardwareSerial : public Print {
+ public:
+  void begin(unsigned long /* baud */) {}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+ public:
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint64_t getEfuseMac();
+  uint32_t getFlashChipSize() { return 4 * 1024 * 1024; }
+  // only counted; see host::getRestartCount()
+  void restart();
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,51 @@
+#include "IPAddress.h"
+
+#include <stdio.h>
+
+const IPAddress INADDR_NONE(0, 0, 0, 0);
+
+bool IPAddress::fromString(const char *address) {
+  uint16_t acc = 0;
+  uint8_t dots = 0;
+  bool digits = false;
+
+  for (; *address; address++) {
+    char c = *address;
+    if (c >= '0' && c <= '9') {
+      acc = acc * 10 + (c - '0');
+      if (acc > 255) {
+        return false;
+      }
+      digits = true;
+    } else if (c == '.' && digits && dots < 3) {
+      _address.bytes[dots++] = acc;
+      acc = 0;
+      digits = false;
+    } else {
+      return false;
+    }
+  }
+  if (dots != 3 || !digits) {
+    return false;
+  }
+  _address.bytes[3] = acc;
+  return true;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _address.bytes[0],
+           _address.bytes[1], _address.bytes[2], _address.bytes[3]);
+  return String(buf);
+}
+
+size_t IPAddress::printTo(Print &p) const {
+  size_t n = 0;
+  for (int i = 0; i < 4; i++) {
+    if (i > 0) {
+      n += p.print('.');
+    }
+    n += p.print(_address.bytes[i], DEC);
+  }
+  return n;
+}
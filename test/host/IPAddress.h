@@ -0,0 +1,57 @@
+// Stand-in for IPAddress of the Arduino core. The address is kept in network
+// order, so on a little endian host the first octet is the lowest byte of
+// the uint32_t, as on the ESP32
+
+#ifndef IPAddress_h
+#define IPAddress_h
+
+#include <stdint.h>
+#include <string.h>
+
+#include "Print.h"
+#include "WString.h"
+
+class IPAddress : public Printable {
+ public:
+  IPAddress() { _address.dword = 0; }
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    _address.bytes[0] = a;
+    _address.bytes[1] = b;
+    _address.bytes[2] = c;
+    _address.bytes[3] = d;
+  }
+  IPAddress(uint32_t address) { _address.dword = address; }
+  IPAddress(const uint8_t *address) { memcpy(_address.bytes, address, 4); }
+
+  bool fromString(const char *address);
+  bool fromString(const String &address) {
+    return fromString(address.c_str());
+  }
+
+  operator uint32_t() const { return _address.dword; }
+  bool operator==(const IPAddress &addr) const {
+    return _address.dword == addr._address.dword;
+  }
+  bool operator==(const uint8_t *addr) const {
+    return memcmp(addr, _address.bytes, 4) == 0;
+  }
+  uint8_t operator[](int index) const { return _address.bytes[index]; }
+  uint8_t &operator[](int index) { return _address.bytes[index]; }
+  IPAddress &operator=(uint32_t address) {
+    _address.dword = address;
+    return *this;
+  }
+
+  String toString() const;
+  size_t printTo(Print &p) const override;
+
+ private:
+  union {
+    uint8_t bytes[4];
+    uint32_t dword;
+  } _address;
+};
+
+extern const IPAddress INADDR_NONE;
+
+#endif
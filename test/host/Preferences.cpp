@@ -0,0 +1,222 @@
+#include "Preferences.h"
+
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "host.h"
+#include "sim.h"
+
+namespace {
+
+enum Type { TYPE_U8, TYPE_U32, TYPE_STR, TYPE_BLOB };
+
+struct Entry {
+  Type type;
+  std::vector<uint8_t> value;  // strings without the terminating zero
+};
+
+typedef std::map<std::string, Entry> Namespace;
+
+std::map<std::string, Namespace> flash;
+bool failWrites = false;
+
+// NVS keys and namespaces have at most 15 characters
+bool validKey(const char *key) {
+  return key != NULL && key[0] != 0 && strlen(key) <= 15;
+}
+
+const Entry *find(const char *ns, const char *key, Type type) {
+  host::sim::Untracked untracked;
+  std::map<std::string, Namespace>::const_iterator n = flash.find(ns);
+  if (n == flash.end()) {
+    return NULL;
+  }
+  Namespace::const_iterator e = n->second.find(key);
+  if (e == n->second.end() || e->second.type != type) {
+    return NULL;
+  }
+  return &e->second;
+}
+
+bool store(const char *ns, const char *key, Type type, const void *value,
+           size_t len) {
+  if (failWrites || !validKey(key)) {
+    return false;
+  }
+  host::sim::Untracked untracked;
+  const uint8_t *bytes = (const uint8_t *)value;
+  Entry &entry = flash[ns][key];
+  entry.type = type;
+  entry.value.assign(bytes, bytes + len);
+  return true;
+}
+
+}  // namespace
+
+namespace host {
+
+namespace sim {
+
+void resetFlash() {
+  Untracked untracked;
+  flash.clear();
+  failWrites = false;
+}
+
+}  // namespace sim
+
+void failFlashWrites(bool fail) { failWrites = fail; }
+
+bool hasFlashKey(const char *ns, const char *key) {
+  sim::Untracked untracked;
+  std::map<std::string, Namespace>::const_iterator n = flash.find(ns);
+  return n != flash.end() && n->second.count(key) > 0;
+}
+
+std::vector<uint8_t> readFlash(const char *ns, const char *key) {
+  sim::Untracked untracked;
+  std::map<std::string, Namespace>::const_iterator n = flash.find(ns);
+  if (n == flash.end() || n->second.count(key) == 0) {
+    return std::vector<uint8_t>();
+  }
+  return n->second.at(key).value;
+}
+
+void writeFlash(const char *ns, const char *key,
+                const std::vector<uint8_t> &value) {
+  sim::Untracked untracked;
+  Entry &entry = flash[ns][key];
+  // a value that was not there before is taken to be a blob
+  if (entry.value.empty() && entry.type != TYPE_STR) {
+    entry.type = TYPE_BLOB;
+  }
+  entry.value = value;
+}
+
+void eraseFlash() {
+  sim::Untracked untracked;
+  flash.clear();
+}
+
+}  // namespace host
+
+bool Preferences::begin(const char *name, bool readOnly) {
+  if (_started || !validKey(name)) {
+    return false;
+  }
+  snprintf(_name, sizeof(_name), "%s", name);
+  _readOnly = readOnly;
+  _started = true;
+  return true;
+}
+
+void Preferences::end() { _started = false; }
+
+bool Preferences::remove(const char *key) {
+  if (!_started || _readOnly || failWrites) {
+    return false;
+  }
+  host::sim::Untracked untracked;
+  std::map<std::string, Namespace>::iterator n = flash.find(_name);
+  return n != flash.end() && n->second.erase(key) > 0;
+}
+
+bool Preferences::clear() {
+  if (!_started || _readOnly || failWrites) {
+    return false;
+  }
+  host::sim::Untracked untracked;
+  flash.erase(_name);
+  return true;
+}
+
+size_t Preferences::putUChar(const char *key, uint8_t value) {
+  if (!_started || _readOnly) {
+    return 0;
+  }
+  return store(_name, key, TYPE_U8, &value, 1) ? 1 : 0;
+}
+
+size_t Preferences::putUInt(const char *key, uint32_t value) {
+  if (!_started || _readOnly) {
+    return 0;
+  }
+  return store(_name, key, TYPE_U32, &value, 4) ? 4 : 0;
+}
+
+size_t Preferences::putBool(const char *key, bool value) {
+  return putUChar(key, value ? 1 : 0);
+}
+
+size_t Preferences::putString(const char *key, const char *value) {
+  if (!_started || _readOnly || value == NULL) {
+    return 0;
+  }
+  size_t len = strlen(value);
+  return store(_name, key, TYPE_STR, value, len) ? len : 0;
+}
+
+size_t Preferences::putString(const char *key, const String &value) {
+  return putString(key, value.c_str());
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+  if (!_started || _readOnly || value == NULL || len == 0) {
+    return 0;
+  }
+  return store(_name, key, TYPE_BLOB, value, len) ? len : 0;
+}
+
+uint8_t Preferences::getUChar(const char *key, uint8_t defaultValue) {
+  const Entry *entry = _started ? find(_name, key, TYPE_U8) : NULL;
+  return entry != NULL ? entry->value[0] : defaultValue;
+}
+
+uint32_t Preferences::getUInt(const char *key, uint32_t defaultValue) {
+  const Entry *entry = _started ? find(_name, key, TYPE_U32) : NULL;
+  if (entry == NULL) {
+    return defaultValue;
+  }
+  uint32_t value;
+  memcpy(&value, entry->value.data(), 4);
+  return value;
+}
+
+bool Preferences::getBool(const char *key, bool defaultValue) {
+  return getUChar(key, defaultValue ? 1 : 0) == 1;
+}
+
+size_t Preferences::getString(const char *key, char *value, size_t maxLen) {
+  const Entry *entry = _started ? find(_name, key, TYPE_STR) : NULL;
+  if (entry == NULL || value == NULL || entry->value.size() + 1 > maxLen) {
+    return 0;
+  }
+  memcpy(value, entry->value.data(), entry->value.size());
+  value[entry->value.size()] = 0;
+  return entry->value.size() + 1;
+}
+
+String Preferences::getString(const char *key, const String &defaultValue) {
+  const Entry *entry = _started ? find(_name, key, TYPE_STR) : NULL;
+  if (entry == NULL) {
+    return defaultValue;
+  }
+  return String((const char *)entry->value.data(), entry->value.size());
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+  const Entry *entry = _started ? find(_name, key, TYPE_BLOB) : NULL;
+  return entry != NULL ? entry->value.size() : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+  const Entry *entry = _started ? find(_name, key, TYPE_BLOB) : NULL;
+  if (entry == NULL || buf == NULL || entry->value.size() > maxLen) {
+    return 0;
+  }
+  memcpy(buf, entry->value.data(), entry->value.size());
+  return entry->value.size();
+}
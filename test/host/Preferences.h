@@ -0,0 +1,42 @@
+// Stand-in for Preferences of the ESP32 core, on a simulated NVS partition
+// that host::reset() erases; see host.h. Returns what the core returns,
+// including 0 for a value that does not fit the buffer given
+
+#ifndef Preferences_h
+#define Preferences_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "WString.h"
+
+class Preferences {
+ public:
+  bool begin(const char *name, bool readOnly = false);
+  void end();
+
+  bool remove(const char *key);
+  bool clear();
+
+  size_t putUChar(const char *key, uint8_t value);
+  size_t putUInt(const char *key, uint32_t value);
+  size_t putBool(const char *key, bool value);
+  size_t putString(const char *key, const char *value);
+  size_t putString(const char *key, const String &value);
+  size_t putBytes(const char *key, const void *value, size_t len);
+
+  uint8_t getUChar(const char *key, uint8_t defaultValue = 0);
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+  bool getBool(const char *key, bool defaultValue = false);
+  size_t getString(const char *key, char *value, size_t maxLen);
+  String getString(const char *key, const String &defaultValue = String());
+  size_t getBytesLength(const char *key);
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+ private:
+  char _name[16] = "";
+  bool _started = false;
+  bool _readOnly = false;
+};
+
+#endif
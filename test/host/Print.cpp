@@ -0,0 +1,98 @@
+#include "Print.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size-- > 0 && write(*buffer++) == 1) {
+    n++;
+  }
+  return n;
+}
+
+size_t Print::write(const char *str) {
+  return str == NULL ? 0 : write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::printf(const char *format, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (len < 0) {
+    return 0;
+  }
+  return write((const uint8_t *)buf,
+               (size_t)len < sizeof(buf) ? len : sizeof(buf) - 1);
+}
+
+size_t Print::print(const __FlashStringHelper *str) {
+  return write((const char *)str);
+}
+
+size_t Print::print(const String &str) {
+  return write((const uint8_t *)str.c_str(), str.length());
+}
+
+size_t Print::print(const char str[]) { return write(str); }
+
+size_t Print::print(char c) { return write((uint8_t)c); }
+
+size_t Print::print(unsigned char value, int base) {
+  return print((unsigned long long)value, base);
+}
+
+size_t Print::print(int value, int base) {
+  return print((long long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+  return print((unsigned long long)value, base);
+}
+
+size_t Print::print(long value, int base) {
+  return print((long long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  return print((unsigned long long)value, base);
+}
+
+size_t Print::print(long long value, int base) {
+  if (base == DEC) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%lld", value);
+    return write(buf);
+  }
+  return print((unsigned long long)value, base);
+}
+
+size_t Print::print(unsigned long long value, int base) {
+  char buf[66];
+  char *p = buf + sizeof(buf) - 1;
+  *p = 0;
+  if (base < 2) {
+    base = DEC;
+  }
+  do {
+    int digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    value /= base;
+  } while (value > 0);
+  return write(p);
+}
+
+size_t Print::print(double value, int digits) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", digits, value);
+  return write(buf);
+}
+
+size_t Print::print(const Printable &printable) {
+  return printable.printTo(*this);
+}
+
+size_t Print::println() { return write("\r\n"); }
@@ -0,0 +1,423 @@
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility>
+
+void String::init() {
+  _buffer = _sso;
+  _sso[0] = 0;
+  _length = 0;
+  _capacity = SSO_SIZE - 1;
+}
+
+void String::release() {
+  if (_buffer != _sso) {
+    free(_buffer);
+  }
+  init();
+}
+
+bool String::reserve(unsigned int size) {
+  if (size <= _capacity) {
+    return true;
+  }
+  char *buffer;
+  if (_buffer == _sso) {
+    buffer = (char *)malloc(size + 1);
+    if (buffer != NULL) {
+      memcpy(buffer, _sso, _length + 1);
+    }
+  } else {
+    buffer = (char *)realloc(_buffer, size + 1);
+  }
+  if (buffer == NULL) {
+    return false;
+  }
+  _buffer = buffer;
+  _capacity = size;
+  return true;
+}
+
+bool String::copy(const char *cstr, unsigned int length) {
+  if (!reserve(length)) {
+    release();
+    return false;
+  }
+  memmove(_buffer, cstr, length);
+  _buffer[length] = 0;
+  _length = length;
+  return true;
+}
+
+void String::move(String &rhs) {
+  release();
+  if (rhs._buffer == rhs._sso) {
+    memcpy(_sso, rhs._sso, rhs._length + 1);
+    _length = rhs._length;
+  } else {
+    _buffer = rhs._buffer;
+    _length = rhs._length;
+    _capacity = rhs._capacity;
+  }
+  rhs.init();
+}
+
+String::String(const char *cstr) {
+  init();
+  if (cstr != NULL) {
+    copy(cstr, strlen(cstr));
+  }
+}
+
+String::String(const char *cstr, unsigned int length) {
+  init();
+  if (cstr != NULL) {
+    copy(cstr, length);
+  }
+}
+
+String::String(const String &str) {
+  init();
+  copy(str._buffer, str._length);
+}
+
+String::String(String &&str) {
+  init();
+  move(str);
+}
+
+String::String(const __FlashStringHelper *str) : String((const char *)str) {}
+
+String::String(char c) : String(&c, 1) {}
+
+static void formatUnsigned(char *buf, unsigned long long value,
+                           unsigned char base) {
+  char tmp[66];
+  int n = 0;
+  do {
+    int digit = value % base;
+    tmp[n++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value > 0);
+  while (n > 0) {
+    *buf++ = tmp[--n];
+  }
+  *buf = 0;
+}
+
+static void formatSigned(char *buf, long long value, unsigned char base) {
+  if (value < 0 && base == 10) {
+    *buf++ = '-';
+    formatUnsigned(buf, -(unsigned long long)value, base);
+  } else {
+    formatUnsigned(buf, (unsigned long long)value, base);
+  }
+}
+
+String::String(unsigned char value, unsigned char base) {
+  char buf[66];
+  init();
+  formatUnsigned(buf, value, base);
+  copy(buf, strlen(buf));
+}
+
+String::String(int value, unsigned char base) {
+  char buf[66];
+  init();
+  // like the core, a negative number in another base is shown as unsigned
+  if (base == 10) {
+    formatSigned(buf, value, base);
+  } else {
+    formatUnsigned(buf, (unsigned int)value, base);
+  }
+  copy(buf, strlen(buf));
+}
+
+String::String(unsigned int value, unsigned char base) {
+  char buf[66];
+  init();
+  formatUnsigned(buf, value, base);
+  copy(buf, strlen(buf));
+}
+
+String::String(long value, unsigned char base) {
+  char buf[66];
+  init();
+  if (base == 10) {
+    formatSigned(buf, value, base);
+  } else {
+    formatUnsigned(buf, (unsigned long)value, base);
+  }
+  copy(buf, strlen(buf));
+}
+
+String::String(unsigned long value, unsigned char base) {
+  char buf[66];
+  init();
+  formatUnsigned(buf, value, base);
+  copy(buf, strlen(buf));
+}
+
+String::String(long long value, unsigned char base) {
+  char buf[66];
+  init();
+  formatSigned(buf, value, base);
+  copy(buf, strlen(buf));
+}
+
+String::String(unsigned long long value, unsigned char base) {
+  char buf[66];
+  init();
+  formatUnsigned(buf, value, base);
+  copy(buf, strlen(buf));
+}
+
+String::String(double value, unsigned int decimalPlaces) {
+  char buf[64];
+  init();
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+  copy(buf, strlen(buf));
+}
+
+String::~String() { release(); }
+
+String &String::operator=(const String &rhs) {
+  if (this != &rhs) {
+    copy(rhs._buffer, rhs._length);
+  }
+  return *this;
+}
+
+String &String::operator=(String &&rhs) {
+  if (this != &rhs) {
+    move(rhs);
+  }
+  return *this;
+}
+
+String &String::operator=(const char *cstr) {
+  if (cstr == NULL) {
+    release();
+  } else {
+    copy(cstr, strlen(cstr));
+  }
+  return *this;
+}
+
+String &String::operator=(const __FlashStringHelper *str) {
+  return *this = (const char *)str;
+}
+
+bool String::concat(const char *cstr, unsigned int length) {
+  if (cstr == NULL) {
+    return false;
+  }
+  if (length == 0) {
+    return true;
+  }
+  unsigned int newLength = _length + length;
+  if (cstr >= _buffer && cstr < _buffer + _length) {
+    // appending a part of itself; the buffer may move
+    unsigned int offset = cstr - _buffer;
+    if (!reserve(newLength)) {
+      return false;
+    }
+    cstr = _buffer + offset;
+  } else if (!reserve(newLength)) {
+    return false;
+  }
+  memmove(_buffer + _length, cstr, length);
+  _length = newLength;
+  _buffer[_length] = 0;
+  return true;
+}
+
+bool String::concat(const char *cstr) {
+  return cstr != NULL && concat(cstr, strlen(cstr));
+}
+
+bool String::concat(const __FlashStringHelper *str) {
+  return concat((const char *)str);
+}
+
+int String::compareTo(const String &str) const {
+  return strcmp(_buffer, str._buffer);
+}
+
+bool String::equals(const String &str) const {
+  return _length == str._length && memcmp(_buffer, str._buffer, _length) == 0;
+}
+
+bool String::equals(const char *cstr) const {
+  return strcmp(_buffer, cstr != NULL ? cstr : "") == 0;
+}
+
+bool String::startsWith(const String &prefix) const {
+  return prefix._length <= _length &&
+         memcmp(_buffer, prefix._buffer, prefix._length) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+  return suffix._length <= _length &&
+         memcmp(_buffer + _length - suffix._length, suffix._buffer,
+                suffix._length) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+  return index < _length ? _buffer[index] : 0;
+}
+
+char &String::operator[](unsigned int index) {
+  static char dummy;
+  if (index >= _length) {
+    dummy = 0;
+    return dummy;
+  }
+  return _buffer[index];
+}
+
+void String::toCharArray(char *buf, unsigned int bufsize,
+                         unsigned int index) const {
+  getBytes((unsigned char *)buf, bufsize, index);
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize,
+                      unsigned int index) const {
+  if (bufsize == 0 || buf == NULL) {
+    return;
+  }
+  if (index >= _length) {
+    buf[0] = 0;
+    return;
+  }
+  unsigned int n = bufsize - 1;
+  if (n > _length - index) {
+    n = _length - index;
+  }
+  memcpy(buf, _buffer + index, n);
+  buf[n] = 0;
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const {
+  if (fromIndex >= _length) {
+    return -1;
+  }
+  const char *p = strchr(_buffer + fromIndex, c);
+  return p == NULL ? -1 : p - _buffer;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const {
+  if (fromIndex >= _length) {
+    return -1;
+  }
+  const char *p = strstr(_buffer + fromIndex, str._buffer);
+  return p == NULL ? -1 : p - _buffer;
+}
+
+String String::substring(unsigned int beginIndex) const {
+  return substring(beginIndex, _length);
+}
+
+String String::substring(unsigned int beginIndex,
+                         unsigned int endIndex) const {
+  if (beginIndex > endIndex) {
+    std::swap(beginIndex, endIndex);
+  }
+  if (beginIndex >= _length) {
+    return String();
+  }
+  if (endIndex > _length) {
+    endIndex = _length;
+  }
+  return String(_buffer + beginIndex, endIndex - beginIndex);
+}
+
+void String::replace(const String &find, const String &replace) {
+  if (_length == 0 || find._length == 0) {
+    return;
+  }
+  String result;
+  const char *p = _buffer;
+  const char *match;
+  while ((match = strstr(p, find._buffer)) != NULL) {
+    result.concat(p, match - p);
+    result.concat(replace);
+    p = match + find._length;
+  }
+  result.concat(p);
+  *this = std::move(result);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index >= _length) {
+    return;
+  }
+  if (count > _length - index) {
+    count = _length - index;
+  }
+  memmove(_buffer + index, _buffer + index + count,
+          _length - index - count + 1);
+  _length -= count;
+}
+
+void String::toLowerCase() {
+  for (unsigned int i = 0; i < _length; i++) {
+    _buffer[i] = tolower((unsigned char)_buffer[i]);
+  }
+}
+
+void String::toUpperCase() {
+  for (unsigned int i = 0; i < _length; i++) {
+    _buffer[i] = toupper((unsigned char)_buffer[i]);
+  }
+}
+
+void String::trim() {
+  unsigned int begin = 0;
+  while (begin < _length && isspace((unsigned char)_buffer[begin])) {
+    begin++;
+  }
+  unsigned int end = _length;
+  while (end > begin && isspace((unsigned char)_buffer[end - 1])) {
+    end--;
+  }
+  memmove(_buffer, _buffer + begin, end - begin);
+  _length = end - begin;
+  _buffer[_length] = 0;
+}
+
+long String::toInt() const { return atol(_buffer); }
+
+String operator+(const String &lhs, const String &rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator+(const String &lhs, const char *rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator+(const char *lhs, const String &rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator+(const String &lhs, char rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator+(const String &lhs, const __FlashStringHelper *rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
@@ -0,0 +1,112 @@
+// Stand-in for the String class of the Arduino core. Like the one of the
+// ESP32 core it keeps strings of up to 14 characters in place (SSO), so the
+// heap allocations counted on the host are the ones made on the device.
+
+#ifndef String_class_h
+#define String_class_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+class __FlashStringHelper;
+
+class String {
+ public:
+  String(const char *cstr = "");
+  String(const char *cstr, unsigned int length);
+  String(const String &str);
+  String(String &&str);
+  String(const __FlashStringHelper *str);
+  explicit String(char c);
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(double value, unsigned int decimalPlaces = 2);
+  ~String();
+
+  String &operator=(const String &rhs);
+  String &operator=(String &&rhs);
+  String &operator=(const char *cstr);
+  String &operator=(const __FlashStringHelper *str);
+
+  bool reserve(unsigned int size);
+  unsigned int length() const { return _length; }
+  bool isEmpty() const { return _length == 0; }
+  const char *c_str() const { return _buffer; }
+  explicit operator bool() const { return true; }
+
+  bool concat(const char *cstr, unsigned int length);
+  bool concat(const String &str) { return concat(str._buffer, str._length); }
+  bool concat(const char *cstr);
+  bool concat(const __FlashStringHelper *str);
+  bool concat(char c) { return concat(&c, 1); }
+  bool concat(unsigned char value) { return concat(String(value)); }
+  bool concat(int value) { return concat(String(value)); }
+  bool concat(unsigned int value) { return concat(String(value)); }
+  bool concat(long value) { return concat(String(value)); }
+  bool concat(unsigned long value) { return concat(String(value)); }
+  bool concat(long long value) { return concat(String(value)); }
+  bool concat(unsigned long long value) { return concat(String(value)); }
+  bool concat(double value) { return concat(String(value)); }
+  template <typename T>
+  String &operator+=(const T &rhs) {
+    concat(rhs);
+    return *this;
+  }
+
+  int compareTo(const String &str) const;
+  bool equals(const String &str) const;
+  bool equals(const char *cstr) const;
+  bool operator==(const String &rhs) const { return equals(rhs); }
+  bool operator==(const char *cstr) const { return equals(cstr); }
+  bool operator!=(const String &rhs) const { return !equals(rhs); }
+  bool operator!=(const char *cstr) const { return !equals(cstr); }
+  bool operator<(const String &rhs) const { return compareTo(rhs) < 0; }
+  bool startsWith(const String &prefix) const;
+  bool endsWith(const String &suffix) const;
+
+  char charAt(unsigned int index) const;
+  char operator[](unsigned int index) const { return charAt(index); }
+  char &operator[](unsigned int index);
+  void toCharArray(char *buf, unsigned int bufsize,
+                   unsigned int index = 0) const;
+  void getBytes(unsigned char *buf, unsigned int bufsize,
+                unsigned int index = 0) const;
+
+  int indexOf(char c, unsigned int fromIndex = 0) const;
+  int indexOf(const String &str, unsigned int fromIndex = 0) const;
+  String substring(unsigned int beginIndex) const;
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void replace(const String &find, const String &replace);
+  void remove(unsigned int index, unsigned int count = (unsigned int)-1);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+  long toInt() const;
+
+ private:
+  static const unsigned int SSO_SIZE = 15;  // characters plus the 0
+
+  char *_buffer;
+  unsigned int _length = 0;
+  unsigned int _capacity = SSO_SIZE - 1;  // without the 0
+  char _sso[SSO_SIZE];
+
+  void init();
+  void release();
+  bool copy(const char *cstr, unsigned int length);
+  void move(String &rhs);
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
+String operator+(const String &lhs, const __FlashStringHelper *rhs);
+
+#endif
@@ -0,0 +1,647 @@
+#include "WebServer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <map>
+
+#include "host.h"
+#include "sim.h"
+
+namespace {
+
+// web servers that have begun, by port of the device
+std::map<int, WebServer *> servers;
+
+// a loopback client gets this long to send its request, like the core's
+// HTTP_MAX_DATA_WAIT
+const int REQUEST_TIMEOUT = 5000;  // ms
+
+const char *codeText(int code) {
+  switch (code) {
+    case 200:
+      return "OK";
+    case 204:
+      return "No Content";
+    case 302:
+      return "Found";
+    case 304:
+      return "Not Modified";
+    case 400:
+      return "Bad Request";
+    case 404:
+      return "Not Found";
+    case 429:
+      return "Too Many Requests";
+    case 500:
+      return "Internal Server Error";
+    default:
+      return "";
+  }
+}
+
+HTTPMethod parseMethod(const std::string &method) {
+  if (method == "POST") {
+    return HTTP_POST;
+  } else if (method == "HEAD") {
+    return HTTP_HEAD;
+  } else if (method == "PUT") {
+    return HTTP_PUT;
+  } else if (method == "PATCH") {
+    return HTTP_PATCH;
+  } else if (method == "DELETE") {
+    return HTTP_DELETE;
+  } else if (method == "OPTIONS") {
+    return HTTP_OPTIONS;
+  }
+  return HTTP_GET;
+}
+
+int hexDigit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+std::string urlDecode(const std::string &text) {
+  std::string decoded;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == '+') {
+      decoded += ' ';
+    } else if (text[i] == '%' && i + 2 < text.size() &&
+               hexDigit(text[i + 1]) >= 0 && hexDigit(text[i + 2]) >= 0) {
+      decoded += (char)(hexDigit(text[i + 1]) * 16 + hexDigit(text[i + 2]));
+      i += 2;
+    } else {
+      decoded += text[i];
+    }
+  }
+  return decoded;
+}
+
+void parseArguments(const std::string &query,
+                    std::vector<std::pair<std::string, std::string>> *args) {
+  size_t start = 0;
+  while (start < query.size()) {
+    size_t end = query.find('&', start);
+    if (end == std::string::npos) {
+      end = query.size();
+    }
+    std::string pair = query.substr(start, end - start);
+    if (!pair.empty()) {
+      size_t equals = pair.find('=');
+      if (equals == std::string::npos) {
+        args->push_back(std::make_pair(urlDecode(pair), std::string()));
+      } else {
+        args->push_back(std::make_pair(urlDecode(pair.substr(0, equals)),
+                                       urlDecode(pair.substr(equals + 1))));
+      }
+    }
+    start = end + 1;
+  }
+}
+
+std::string lower(std::string text) {
+  for (size_t i = 0; i < text.size(); i++) {
+    text[i] = tolower((unsigned char)text[i]);
+  }
+  return text;
+}
+
+host::Response parseResponse(const std::string &raw) {
+  host::Response response;
+  response.raw = raw;
+  size_t end = raw.find("\r\n\r\n");
+  if (end == std::string::npos || raw.compare(0, 5, "HTTP/") != 0) {
+    return response;
+  }
+  response.code = atoi(raw.c_str() + raw.find(' ') + 1);
+  size_t line = raw.find("\r\n") + 2;
+  while (line < end) {
+    size_t next = raw.find("\r\n", line);
+    std::string header = raw.substr(line, next - line);
+    size_t colon = header.find(':');
+    if (colon != std::string::npos) {
+      size_t value = header.find_first_not_of(' ', colon + 1);
+      response.headers[lower(header.substr(0, colon))] =
+          value == std::string::npos ? "" : header.substr(value);
+    }
+    line = next + 2;
+  }
+
+  std::string body = raw.substr(end + 4);
+  if (response.header("transfer-encoding") != "chunked") {
+    response.body = body;
+    return response;
+  }
+  response.chunked = true;
+  size_t pos = 0;
+  while (pos < body.size()) {
+    size_t sizeEnd = body.find("\r\n", pos);
+    if (sizeEnd == std::string::npos) {
+      break;
+    }
+    size_t size = strtoul(body.c_str() + pos, NULL, 16);
+    if (size == 0) {
+      break;
+    }
+    response.chunks.push_back(size);
+    response.body += body.substr(sizeEnd + 2, size);
+    pos = sizeEnd + 2 + size + 2;
+  }
+  return response;
+}
+
+}  // namespace
+
+namespace host {
+
+namespace sim {
+
+void resetServers() {
+  Untracked untracked;
+  servers.clear();
+}
+
+}  // namespace sim
+
+std::string Response::header(const char *name) const {
+  std::map<std::string, std::string>::const_iterator i =
+      headers.find(lower(name));
+  return i == headers.end() ? "" : i->second;
+}
+
+Response request(const Request &request) {
+  std::map<int, WebServer *>::iterator server = servers.find(80);
+  if (server == servers.end()) {
+    return Response();
+  }
+  std::string raw = server->second->serve(request);
+  sim::Untracked untracked;
+  return parseResponse(raw);
+}
+
+Response get(const char *uri, const char *hostHeader) {
+  Request r;
+  {
+    sim::Untracked untracked;
+    r.uri = uri;
+    r.headers["Host"] = hostHeader;
+  }
+  return request(r);
+}
+
+Response post(const char *uri, const std::string &form) {
+  Request r;
+  {
+    sim::Untracked untracked;
+    r.method = "POST";
+    r.uri = uri;
+    r.body = form;
+    r.headers["Content-Type"] = "application/x-www-form-urlencoded";
+  }
+  return request(r);
+}
+
+}  // namespace host
+
+WebServer::WebServer(int port) : _port(port) {}
+
+WebServer::~WebServer() { close(); }
+
+void WebServer::begin() {
+  host::sim::Untracked untracked;
+  servers[_port] = this;
+  _listening = true;
+
+  uint16_t hostPort = host::sim::hostPort(_port);
+  if (hostPort == 0 || _socket >= 0) {
+    return;
+  }
+  _socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  int on = 1;
+  setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(hostPort);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(_socket, (sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(_socket, 64) != 0) {
+    perror("WebServer: loopback port");
+    ::close(_socket);
+    _socket = -1;
+  }
+}
+
+void WebServer::close() {
+  host::sim::Untracked untracked;
+  std::map<int, WebServer *>::iterator i = servers.find(_port);
+  if (i != servers.end() && i->second == this) {
+    servers.erase(i);
+  }
+  _listening = false;
+  if (_socket >= 0) {
+    ::close(_socket);
+    _socket = -1;
+  }
+}
+
+void WebServer::stop() { close(); }
+
+void WebServer::handleClient() {
+  if (_socket < 0) {
+    return;
+  }
+  sockaddr_in peer;
+  socklen_t peerLength = sizeof(peer);
+  int client = accept4(_socket, (sockaddr *)&peer, &peerLength, 0);
+  if (client < 0) {
+    return;
+  }
+  IPAddress remoteIP((uint32_t)peer.sin_addr.s_addr);
+  serveSocket(client, remoteIP, ntohs(peer.sin_port));
+  ::close(client);
+}
+
+void WebServer::serveSocket(int client, IPAddress remoteIP,
+                            uint16_t remotePort) {
+  std::string data;
+  size_t headerEnd = std::string::npos;
+  size_t contentLength = 0;
+  unsigned long start = millis();
+  {
+    host::sim::Untracked untracked;
+    for (;;) {
+      if (headerEnd != std::string::npos &&
+          data.size() >= headerEnd + 4 + contentLength) {
+        break;
+      }
+      long left = REQUEST_TIMEOUT - (long)(millis() - start);
+      pollfd fd = {client, POLLIN, 0};
+      if (left <= 0 || poll(&fd, 1, left) <= 0) {
+        return;  // the core drops the client as well
+      }
+      char buf[2048];
+      ssize_t n = recv(client, buf, sizeof(buf), 0);
+      if (n <= 0) {
+        return;
+      }
+      data.append(buf, n);
+      if (headerEnd == std::string::npos) {
+        headerEnd = data.find("\r\n\r\n");
+        if (headerEnd != std::string::npos) {
+          std::string head = lower(data.substr(0, headerEnd));
+          size_t length = head.find("\r\ncontent-length:");
+          if (length != std::string::npos) {
+            contentLength = strtoul(head.c_str() + length + 17, NULL, 10);
+          }
+        }
+      }
+    }
+  }
+
+  std::string method;
+  std::string target;
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+  {
+    host::sim::Untracked untracked;
+    size_t lineEnd = data.find("\r\n");
+    std::string requestLine = data.substr(0, lineEnd);
+    size_t space1 = requestLine.find(' ');
+    size_t space2 = requestLine.rfind(' ');
+    if (space1 == std::string::npos || space2 == space1) {
+      return;
+    }
+    method = requestLine.substr(0, space1);
+    target = requestLine.substr(space1 + 1, space2 - space1 - 1);
+    _http10 = requestLine.compare(space2 + 1, 8, "HTTP/1.0") == 0;
+    size_t line = lineEnd + 2;
+    while (line < headerEnd) {
+      size_t next = data.find("\r\n", line);
+      std::string header = data.substr(line, next - line);
+      size_t colon = header.find(':');
+      if (colon != std::string::npos) {
+        size_t value = header.find_first_not_of(' ', colon + 1);
+        headers.push_back(std::make_pair(
+            header.substr(0, colon),
+            value == std::string::npos ? "" : header.substr(value)));
+      }
+      line = next + 2;
+    }
+    body = data.substr(headerEnd + 4, contentLength);
+  }
+
+  dispatch(method, target, headers, body, remoteIP, remotePort);
+
+  host::sim::Untracked untracked;
+  size_t sent = 0;
+  while (sent < _output.size()) {
+    ssize_t n = ::send(client, _output.data() + sent, _output.size() - sent,
+                       MSG_NOSIGNAL);
+    if (n <= 0) {
+      break;
+    }
+    sent += n;
+  }
+  shutdown(client, SHUT_WR);
+  _output.clear();
+}
+
+std::string WebServer::serve(const host::Request &request) {
+  std::vector<std::pair<std::string, std::string>> headers;
+  {
+    host::sim::Untracked untracked;
+    bool hasHost = false;
+    for (std::map<std::string, std::string>::const_iterator i =
+             request.headers.begin();
+         i != request.headers.end(); ++i) {
+      headers.push_back(*i);
+      hasHost = hasHost || strcasecmp(i->first.c_str(), "Host") == 0;
+    }
+    if (!hasHost) {
+      headers.push_back(std::make_pair("Host", "192.168.4.1"));
+    }
+  }
+  _http10 = false;
+  dispatch(request.method, request.uri, headers, request.body, request.client,
+           50000);
+  host::sim::Untracked untracked;
+  std::string raw;
+  raw.swap(_output);
+  return raw;
+}
+
+void WebServer::dispatch(
+    const std::string &method, const std::string &target,
+    const std::vector<std::pair<std::string, std::string>> &headers,
+    const std::string &body, IPAddress remoteIP, uint16_t remotePort) {
+  THandlerFunction handler;
+  {
+    host::sim::Untracked untracked;
+    _method = parseMethod(method);
+    size_t query = target.find('?');
+    _uri = target.substr(0, query);
+    _args.clear();
+    if (query != std::string::npos) {
+      parseArguments(target.substr(query + 1), &_args);
+    }
+    _headers.clear();
+    _hostHeader.clear();
+    bool form = false;
+    for (size_t i = 0; i < headers.size(); i++) {
+      const std::string &name = headers[i].first;
+      if (strcasecmp(name.c_str(), "Host") == 0) {
+        _hostHeader = headers[i].second;
+      }
+      if (strcasecmp(name.c_str(), "Content-Type") == 0) {
+        form = headers[i].second.compare(
+                   0, 33, "application/x-www-form-urlencoded") == 0;
+      }
+      for (size_t k = 0; k < _headerKeys.size(); k++) {
+        if (strcasecmp(name.c_str(), _headerKeys[k].c_str()) == 0) {
+          _headers.push_back(headers[i]);
+        }
+      }
+    }
+    if (!body.empty()) {
+      if (form) {
+        parseArguments(body, &_args);
+      } else {
+        _args.push_back(std::make_pair("plain", body));
+      }
+    }
+    _client = WiFiClient(remoteIP, remotePort);
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+    _chunked = false;
+    _responseHeaders.clear();
+    _output.clear();
+
+    for (size_t i = 0; i < _routes.size(); i++) {
+      if (_routes[i].uri == _uri &&
+          (_routes[i].method == HTTP_ANY || _routes[i].method == _method)) {
+        handler = _routes[i].handler;
+        break;
+      }
+    }
+    if (!handler) {
+      handler = _notFound;
+    }
+  }
+
+  if (handler) {
+    handler();
+  } else {
+    String message("Not found: ");
+    message += _uri.c_str();
+    send(404, "text/plain", message);
+  }
+  // a chunked response the handler did not end
+  if (_chunked) {
+    sendContent("", 0);
+  }
+
+  host::sim::Untracked untracked;
+  handler = nullptr;
+}
+
+String WebServer::uri() { return String(_uri.c_str()); }
+
+HTTPMethod WebServer::method() { return _method; }
+
+WiFiClient &WebServer::client() { return _client; }
+
+void WebServer::on(const String &uri, THandlerFunction handler) {
+  on(uri, HTTP_ANY, handler);
+}
+
+void WebServer::on(const String &uri, HTTPMethod method,
+                   THandlerFunction handler) {
+  host::sim::Untracked untracked;
+  Route route;
+  route.uri = uri.c_str();
+  route.method = method;
+  route.handler = handler;
+  _routes.push_back(route);
+}
+
+void WebServer::onNotFound(THandlerFunction handler) {
+  host::sim::Untracked untracked;
+  _notFound = handler;
+}
+
+String WebServer::arg(String name) {
+  for (size_t i = 0; i < _args.size(); i++) {
+    if (_args[i].first == name.c_str()) {
+      return String(_args[i].second.c_str(), _args[i].second.size());
+    }
+  }
+  return String();
+}
+
+String WebServer::arg(int i) {
+  if (i < 0 || (size_t)i >= _args.size()) {
+    return String();
+  }
+  return String(_args[i].second.c_str(), _args[i].second.size());
+}
+
+String WebServer::argName(int i) {
+  if (i < 0 || (size_t)i >= _args.size()) {
+    return String();
+  }
+  return String(_args[i].first.c_str());
+}
+
+int WebServer::args() { return _args.size(); }
+
+bool WebServer::hasArg(String name) {
+  for (size_t i = 0; i < _args.size(); i++) {
+    if (_args[i].first == name.c_str()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void WebServer::collectHeaders(const char *headerKeys[],
+                               const size_t headerKeysCount) {
+  host::sim::Untracked untracked;
+  _headerKeys.clear();
+  for (size_t i = 0; i < headerKeysCount; i++) {
+    _headerKeys.push_back(headerKeys[i]);
+  }
+}
+
+String WebServer::header(String name) {
+  for (size_t i = 0; i < _headers.size(); i++) {
+    if (strcasecmp(_headers[i].first.c_str(), name.c_str()) == 0) {
+      return String(_headers[i].second.c_str());
+    }
+  }
+  return String();
+}
+
+bool WebServer::hasHeader(String name) {
+  for (size_t i = 0; i < _headers.size(); i++) {
+    if (strcasecmp(_headers[i].first.c_str(), name.c_str()) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+String WebServer::hostHeader() { return String(_hostHeader.c_str()); }
+
+void WebServer::setContentLength(const size_t contentLength) {
+  _contentLength = contentLength;
+}
+
+void WebServer::sendHeader(const String &name, const String &value,
+                           bool first) {
+  host::sim::Untracked untracked;
+  std::string line = std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+  if (first) {
+    _responseHeaders.insert(0, line);
+  } else {
+    _responseHeaders += line;
+  }
+}
+
+void WebServer::prepareHeader(std::string &response, int code,
+                              const char *contentType, size_t contentLength) {
+  host::sim::Untracked untracked;
+  char statusLine[64];
+  snprintf(statusLine, sizeof(statusLine), "HTTP/1.%d %d %s\r\n",
+           _http10 ? 0 : 1, code, codeText(code));
+  response = statusLine;
+  if (contentType == NULL) {
+    contentType = "text/html";
+  }
+  sendHeader("Content-Type", contentType, true);
+  if (_contentLength == CONTENT_LENGTH_NOT_SET) {
+    sendHeader("Content-Length", String((unsigned long)contentLength));
+  } else if (_contentLength != CONTENT_LENGTH_UNKNOWN) {
+    sendHeader("Content-Length", String((unsigned long)_contentLength));
+  } else if (!_http10) {
+    _chunked = true;
+    sendHeader("Accept-Ranges", "none");
+    sendHeader("Transfer-Encoding", "chunked");
+  }
+  sendHeader("Connection", "close");
+  response += _responseHeaders;
+  response += "\r\n";
+  _responseHeaders.clear();
+}
+
+void WebServer::write(const char *data, size_t length) {
+  host::sim::Untracked untracked;
+  _output.append(data, length);
+}
+
+void WebServer::send(int code, const char *contentType,
+                     const String &content) {
+  std::string header;
+  prepareHeader(header, code, contentType, content.length());
+  write(header.data(), header.size());
+  if (content.length() > 0) {
+    sendContent(content);
+  }
+  host::sim::Untracked untracked;
+  header.clear();
+  header.shrink_to_fit();
+}
+
+void WebServer::send(int code, char *contentType, const String &content) {
+  send(code, (const char *)contentType, content);
+}
+
+void WebServer::send(int code, const String &contentType,
+                     const String &content) {
+  send(code, contentType.c_str(), content);
+}
+
+void WebServer::send_P(int code, PGM_P contentType, PGM_P content) {
+  send_P(code, contentType, content, strlen_P(content));
+}
+
+void WebServer::send_P(int code, PGM_P contentType, PGM_P content,
+                       size_t contentLength) {
+  std::string header;
+  prepareHeader(header, code, contentType, contentLength);
+  write(header.data(), header.size());
+  sendContent(content, contentLength);
+  host::sim::Untracked untracked;
+  header.clear();
+  header.shrink_to_fit();
+}
+
+void WebServer::sendContent(const String &content) {
+  sendContent(content.c_str(), content.length());
+}
+
+void WebServer::sendContent(const char *content, size_t contentLength) {
+  if (_chunked) {
+    char chunkSize[11];
+    snprintf(chunkSize, sizeof(chunkSize), "%zx\r\n", contentLength);
+    write(chunkSize, strlen(chunkSize));
+  }
+  write(content, contentLength);
+  if (_chunked) {
+    write("\r\n", 2);
+    if (contentLength == 0) {
+      _chunked = false;
+    }
+  }
+}
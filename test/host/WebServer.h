@@ -0,0 +1,126 @@
+// Stand-in for WebServer of the ESP32 core (2.x). Requests come from
+// host::request(), or over a loopback socket when the port is mapped with
+// host::mapPort(). Responses are written byte for byte as the core writes
+// them: status line and headers in the same order, chunked transfer encoding
+// for CONTENT_LENGTH_UNKNOWN, and Connection: close
+
+#ifndef WebServer_h
+#define WebServer_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+namespace host {
+struct Request;
+}
+
+enum HTTPMethod {
+  HTTP_ANY,
+  HTTP_GET,
+  HTTP_HEAD,
+  HTTP_POST,
+  HTTP_PUT,
+  HTTP_PATCH,
+  HTTP_DELETE,
+  HTTP_OPTIONS,
+};
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+class WebServer {
+ public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  WebServer(int port = 80);
+  ~WebServer();
+
+  void begin();
+  void close();
+  void stop();
+  // answers at most one pending request of a loopback client
+  void handleClient();
+
+  void on(const String &uri, THandlerFunction handler);
+  void on(const String &uri, HTTPMethod method, THandlerFunction handler);
+  void onNotFound(THandlerFunction handler);
+
+  String uri();
+  HTTPMethod method();
+  WiFiClient &client();
+
+  String arg(String name);
+  String arg(int i);
+  String argName(int i);
+  int args();
+  bool hasArg(String name);
+
+  void collectHeaders(const char *headerKeys[], const size_t headerKeysCount);
+  String header(String name);
+  bool hasHeader(String name);
+  String hostHeader();
+
+  void send(int code, const char *contentType = NULL,
+            const String &content = String(""));
+  void send(int code, char *contentType, const String &content);
+  void send(int code, const String &contentType, const String &content);
+  void send_P(int code, PGM_P contentType, PGM_P content);
+  void send_P(int code, PGM_P contentType, PGM_P content,
+              size_t contentLength);
+  void setContentLength(const size_t contentLength);
+  void sendHeader(const String &name, const String &value,
+                  bool first = false);
+  void sendContent(const String &content);
+  void sendContent(const char *content, size_t contentLength);
+
+  // the raw response to request; for host::request()
+  std::string serve(const host::Request &request);
+
+ private:
+  struct Route {
+    std::string uri;
+    HTTPMethod method;
+    THandlerFunction handler;
+  };
+
+  int _port;
+  bool _listening = false;
+  int _socket = -1;  // loopback mode
+  std::vector<Route> _routes;
+  THandlerFunction _notFound;
+  std::vector<std::string> _headerKeys;
+
+  // the request being handled
+  HTTPMethod _method = HTTP_GET;
+  std::string _uri;
+  bool _http10 = false;
+  std::vector<std::pair<std::string, std::string>> _args;
+  std::vector<std::pair<std::string, std::string>> _headers;  // collected
+  std::string _hostHeader;
+  WiFiClient _client;
+
+  // the response
+  size_t _contentLength = CONTENT_LENGTH_NOT_SET;
+  bool _chunked = false;
+  std::string _responseHeaders;
+  std::string _output;
+
+  void dispatch(const std::string &method, const std::string &target,
+                const std::vector<std::pair<std::string, std::string>> &headers,
+                const std::string &body, IPAddress remoteIP,
+                uint16_t remotePort);
+  void prepareHeader(std::string &response, int code,
+                     const char *contentType, size_t contentLength);
+  void write(const char *data, size_t length);
+  void serveSocket(int client, IPAddress remoteIP, uint16_t remotePort);
+};
+
+#endif
@@ -0,0 +1,590 @@
+#include "WiFi.h"
+
+#include <string>
+#include <vector>
+
+#include "host.h"
+#include "sim.h"
+
+WiFiClass WiFi;
+
+namespace {
+
+const host::RadioTiming DEFAULT_TIMING = {120, 300, 200, 1000};
+// scanned by a connect without a channel
+const int CHANNELS = 13;
+
+struct Event {
+  uint64_t time;
+  uint64_t order;  // events due at the same time run in order
+  std::function<void()> action;
+};
+
+struct Handler {
+  wifi_event_id_t id;
+  arduino_event_id_t event;
+  WiFiEventFuncCb callback;
+};
+
+std::vector<host::AccessPoint> accessPoints;
+host::RadioTiming timing = DEFAULT_TIMING;
+std::vector<Event> events;
+uint64_t eventOrder = 0;
+bool runningEvents = false;
+std::vector<Handler> handlers;
+wifi_event_id_t nextHandlerId = 1;
+
+// station
+wl_status_t staStatus = WL_IDLE_STATUS;
+wifi_mode_t wifiMode = WIFI_OFF;
+unsigned connectGeneration = 0;  // changed to cancel the attempt running
+std::vector<host::ConnectRequest> connectRequests;
+std::string lastSsid;
+std::string lastPass;
+host::AccessPoint connectedAp;
+IPAddress staticIp;
+char hostname[64] = "esp32";
+
+// access point
+bool apUp = false;
+IPAddress apIp(192, 168, 4, 1);
+
+// scans
+int scanFailures = 0;
+int scanCount = 0;
+int16_t scanState = WIFI_SCAN_FAILED;  // or the number of results
+std::vector<host::AccessPoint> scanResults;
+
+const uint8_t STA_MAC[6] = {0x24, 0x0a, 0xc4, 0x12, 0x34, 0x56};
+const uint8_t AP_MAC[6] = {0x24, 0x0a, 0xc4, 0x12, 0x34, 0x57};
+
+void schedule(unsigned long delayMs, std::function<void()> action) {
+  host::sim::Untracked untracked;
+  Event event;
+  event.time = host::sim::now() + (uint64_t)delayMs * 1000;
+  event.order = eventOrder++;
+  event.action = action;
+  events.push_back(event);
+}
+
+void fire(arduino_event_id_t event, uint8_t reason = 0) {
+  std::vector<WiFiEventFuncCb> callbacks;
+  {
+    host::sim::Untracked untracked;
+    for (size_t i = 0; i < handlers.size(); i++) {
+      if (handlers[i].event == ARDUINO_EVENT_MAX ||
+          handlers[i].event == event) {
+        callbacks.push_back(handlers[i].callback);
+      }
+    }
+  }
+  arduino_event_info_t info;
+  memset(&info, 0, sizeof(info));
+  if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+    info.wifi_sta_disconnected.reason = reason;
+  }
+  {
+    host::sim::Tracked tracked;
+    for (size_t i = 0; i < callbacks.size(); i++) {
+      callbacks[i](event, info);
+    }
+  }
+  host::sim::Untracked untracked;
+  callbacks.clear();
+  callbacks.shrink_to_fit();
+}
+
+bool sameBssid(const uint8_t *a, const uint8_t *b) {
+  return memcmp(a, b, 6) == 0;
+}
+
+// one try of the driver to connect; repeated until the attempt is cancelled
+void attempt(unsigned generation, std::string ssid, std::string pass,
+             int32_t channel, bool directed, std::vector<uint8_t> bssid) {
+  if (generation != connectGeneration) {
+    return;
+  }
+  const host::AccessPoint *ap = NULL;
+  for (size_t i = 0; i < accessPoints.size(); i++) {
+    const host::AccessPoint &candidate = accessPoints[i];
+    if (candidate.ssid != ssid ||
+        (channel != 0 && candidate.channel != channel) ||
+        (directed && !sameBssid(candidate.bssid, bssid.data()))) {
+      continue;
+    }
+    if (ap == NULL || candidate.rssi > ap->rssi) {
+      ap = &candidate;
+    }
+  }
+
+  unsigned long scanTime =
+      (channel != 0 ? 1 : CHANNELS) * timing.scanChannel;
+  std::function<void()> retry = [=]() {
+    schedule(timing.retry, [=]() {
+      attempt(generation, ssid, pass, channel, directed, bssid);
+    });
+  };
+
+  if (ap == NULL) {
+    schedule(scanTime, [=]() {
+      if (generation != connectGeneration) {
+        return;
+      }
+      staStatus = WL_NO_SSID_AVAIL;
+      fire(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND);
+      retry();
+    });
+    return;
+  }
+  if (ap->pass != pass) {
+    schedule(scanTime + timing.associate, [=]() {
+      if (generation != connectGeneration) {
+        return;
+      }
+      staStatus = WL_CONNECT_FAILED;
+      fire(ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+           WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT);
+      retry();
+    });
+    return;
+  }
+  host::AccessPoint found = *ap;
+  schedule(scanTime + timing.associate, [=]() {
+    if (generation != connectGeneration) {
+      return;
+    }
+    connectedAp = found;
+    staStatus = WL_IDLE_STATUS;
+    fire(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+    schedule(timing.dhcp, [=]() {
+      if (generation != connectGeneration) {
+        return;
+      }
+      staStatus = WL_CONNECTED;
+      fire(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    });
+  });
+}
+
+// cancel the attempt running; a connected station is disconnected
+void stopStation() {
+  connectGeneration++;
+  if (staStatus == WL_CONNECTED) {
+    schedule(0, []() {
+      fire(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_ASSOC_LEAVE);
+    });
+  }
+  staStatus = WL_DISCONNECTED;
+}
+
+std::vector<host::AccessPoint> scan(bool showHidden, uint8_t channel) {
+  host::sim::Untracked untracked;
+  std::vector<host::AccessPoint> results;
+  for (size_t i = 0; i < accessPoints.size(); i++) {
+    host::AccessPoint ap = accessPoints[i];
+    if (channel != 0 && ap.channel != channel) {
+      continue;
+    }
+    if (ap.hidden) {
+      if (!showHidden) {
+        continue;
+      }
+      ap.ssid.clear();
+    }
+    results.push_back(ap);
+  }
+  return results;
+}
+
+}  // namespace
+
+namespace host {
+
+namespace sim {
+
+bool nextEventTime(uint64_t *time) {
+  if (events.empty()) {
+    return false;
+  }
+  *time = events[0].time;
+  for (size_t i = 1; i < events.size(); i++) {
+    if (events[i].time < *time) {
+      *time = events[i].time;
+    }
+  }
+  return true;
+}
+
+void runEvents() {
+  if (runningEvents) {
+    return;
+  }
+  runningEvents = true;
+  for (;;) {
+    uint64_t now = sim::now();
+    int next = -1;
+    for (size_t i = 0; i < events.size(); i++) {
+      if (events[i].time <= now &&
+          (next < 0 || events[i].time < events[next].time ||
+           (events[i].time == events[next].time &&
+            events[i].order < events[next].order))) {
+        next = i;
+      }
+    }
+    if (next < 0) {
+      break;
+    }
+    // the radio's own work; fire() counts what the library's handlers do
+    Untracked untracked;
+    std::function<void()> action = events[next].action;
+    events.erase(events.begin() + next);
+    action();
+  }
+  runningEvents = false;
+}
+
+void resetRadio() {
+  Untracked untracked;
+  accessPoints.clear();
+  timing = DEFAULT_TIMING;
+  events.clear();
+  connectGeneration++;
+  connectRequests.clear();
+  staStatus = WL_IDLE_STATUS;
+  wifiMode = WIFI_OFF;
+  lastSsid.clear();
+  lastPass.clear();
+  staticIp = IPAddress();
+  apUp = false;
+  apIp = IPAddress(192, 168, 4, 1);
+  scanFailures = 0;
+  scanCount = 0;
+  scanState = WIFI_SCAN_FAILED;
+  scanResults.clear();
+}
+
+}  // namespace sim
+
+void addAccessPoint(const AccessPoint &ap) {
+  sim::Untracked untracked;
+  accessPoints.push_back(ap);
+}
+
+void addNetwork(const char *ssid, const char *pass, int count, int8_t rssi) {
+  static const uint8_t channels[] = {1, 6, 11};
+  for (int i = 0; i < count; i++) {
+    sim::Untracked untracked;
+    AccessPoint ap;
+    ap.ssid = ssid;
+    ap.pass = pass;
+    // locally administered, unique per network and AP
+    uint32_t hash = 2166136261u;
+    for (const char *p = ssid; *p; p++) {
+      hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    ap.bssid[0] = 0x02;
+    ap.bssid[1] = hash >> 24;
+    ap.bssid[2] = hash >> 16;
+    ap.bssid[3] = hash >> 8;
+    ap.bssid[4] = hash;
+    ap.bssid[5] = i;
+    ap.channel = channels[(accessPoints.size() + i) % 3];
+    ap.rssi = rssi - 3 * i;
+    ap.hidden = false;
+    accessPoints.push_back(ap);
+  }
+}
+
+void clearAccessPoints() {
+  sim::Untracked untracked;
+  accessPoints.clear();
+}
+
+RadioTiming &radioTiming() { return timing; }
+
+void failScans(int count) { scanFailures = count; }
+
+int getScanCount() { return scanCount; }
+
+const std::vector<ConnectRequest> &getConnectRequests() {
+  return connectRequests;
+}
+
+size_t getEventHandlerCount() { return handlers.size(); }
+
+}  // namespace host
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase,
+                             int32_t channel, const uint8_t *bssid,
+                             bool connect) {
+  stopStation();
+  if (wifiMode == WIFI_OFF || wifiMode == WIFI_AP) {
+    wifiMode = wifiMode == WIFI_AP ? WIFI_AP_STA : WIFI_STA;
+  }
+
+  host::sim::Untracked untracked;
+  host::ConnectRequest request;
+  request.ssid = ssid;
+  request.pass = passphrase != NULL ? passphrase : "";
+  request.channel = channel;
+  request.directed = bssid != NULL;
+  memset(request.bssid, 0, 6);
+  if (bssid != NULL) {
+    memcpy(request.bssid, bssid, 6);
+  }
+  request.time = millis();
+  connectRequests.push_back(request);
+  lastSsid = request.ssid;
+  lastPass = request.pass;
+
+  if (connect) {
+    unsigned generation = connectGeneration;
+    std::vector<uint8_t> target(request.bssid, request.bssid + 6);
+    schedule(0, [=]() {
+      attempt(generation, request.ssid, request.pass, request.channel,
+              request.directed, target);
+    });
+  }
+  return staStatus;
+}
+
+wl_status_t WiFiClass::begin() {
+  if (lastSsid.empty()) {
+    return staStatus;
+  }
+  std::string ssid;
+  std::string pass;
+  {
+    host::sim::Untracked untracked;
+    ssid = lastSsid;
+    pass = lastPass;
+  }
+  wl_status_t status = begin(ssid.c_str(), pass.c_str());
+  host::sim::Untracked untracked;
+  ssid.clear();
+  ssid.shrink_to_fit();
+  pass.clear();
+  pass.shrink_to_fit();
+  return status;
+}
+
+bool WiFiClass::config(IPAddress localIP, IPAddress /* gateway */,
+                       IPAddress /* subnet */) {
+  staticIp = localIP;
+  return true;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool /* eraseap */) {
+  stopStation();
+  if (wifioff) {
+    wifiMode = wifiMode == WIFI_AP_STA ? WIFI_AP : WIFI_OFF;
+  }
+  return true;
+}
+
+bool WiFiClass::setAutoReconnect(bool /* autoReconnect */) { return true; }
+
+wl_status_t WiFiClass::status() { return staStatus; }
+
+uint8_t WiFiClass::waitForConnectResult(unsigned long timeoutLength) {
+  unsigned long start = millis();
+  while ((staStatus == WL_IDLE_STATUS || staStatus >= WL_DISCONNECTED) &&
+         millis() - start < timeoutLength) {
+    delay(100);
+  }
+  return staStatus;
+}
+
+IPAddress WiFiClass::localIP() {
+  if (staStatus != WL_CONNECTED) {
+    return IPAddress();
+  }
+  return staticIp ? staticIp : IPAddress(192, 168, 1, 100);
+}
+
+uint8_t *WiFiClass::macAddress(uint8_t *mac) {
+  memcpy(mac, STA_MAC, 6);
+  return mac;
+}
+
+String WiFiClass::macAddress() {
+  char buf[18];
+  snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", STA_MAC[0],
+           STA_MAC[1], STA_MAC[2], STA_MAC[3], STA_MAC[4], STA_MAC[5]);
+  return String(buf);
+}
+
+uint8_t *WiFiClass::BSSID() {
+  return staStatus == WL_CONNECTED ? connectedAp.bssid : NULL;
+}
+
+int32_t WiFiClass::channel() {
+  return staStatus == WL_CONNECTED ? connectedAp.channel : 1;
+}
+
+String WiFiClass::SSID() {
+  return String(staStatus == WL_CONNECTED ? connectedAp.ssid.c_str() : "");
+}
+
+int32_t WiFiClass::RSSI() {
+  return staStatus == WL_CONNECTED ? connectedAp.rssi : 0;
+}
+
+bool WiFiClass::setHostname(const char *name) {
+  snprintf(hostname, sizeof(hostname), "%s", name);
+  return true;
+}
+
+const char *WiFiClass::getHostname() { return hostname; }
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+  if ((mode == WIFI_OFF || mode == WIFI_AP) &&
+      (wifiMode == WIFI_STA || wifiMode == WIFI_AP_STA)) {
+    stopStation();
+  }
+  if (mode == WIFI_OFF || mode == WIFI_STA) {
+    apUp = false;
+  }
+  wifiMode = mode;
+  return true;
+}
+
+wifi_mode_t WiFiClass::getMode() { return wifiMode; }
+
+bool WiFiClass::softAP(const char * /* ssid */, const char * /* passphrase */,
+                       int /* channel */, int /* ssidHidden */,
+                       int /* maxConnection */) {
+  if (wifiMode == WIFI_OFF || wifiMode == WIFI_STA) {
+    wifiMode = wifiMode == WIFI_STA ? WIFI_AP_STA : WIFI_AP;
+  }
+  apUp = true;
+  return true;
+}
+
+bool WiFiClass::softAPConfig(IPAddress localIP, IPAddress /* gateway */,
+                             IPAddress /* subnet */) {
+  apIp = localIP;
+  return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool /* wifioff */) {
+  apUp = false;
+  return true;
+}
+
+IPAddress WiFiClass::softAPIP() { return apUp ? apIp : IPAddress(); }
+
+uint8_t *WiFiClass::softAPmacAddress(uint8_t *mac) {
+  memcpy(mac, AP_MAC, 6);
+  return mac;
+}
+
+String WiFiClass::softAPmacAddress() {
+  char buf[18];
+  snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", AP_MAC[0],
+           AP_MAC[1], AP_MAC[2], AP_MAC[3], AP_MAC[4], AP_MAC[5]);
+  return String(buf);
+}
+
+uint8_t WiFiClass::softAPgetStationNum() { return 0; }
+
+int16_t WiFiClass::scanNetworks(bool async, bool showHidden, bool passive,
+                                uint32_t maxMsPerChannel, uint8_t channel) {
+  if (scanState == WIFI_SCAN_RUNNING) {
+    return WIFI_SCAN_FAILED;
+  }
+  if (scanFailures > 0) {
+    scanFailures--;
+    return WIFI_SCAN_FAILED;
+  }
+  scanCount++;
+  {
+    host::sim::Untracked untracked;
+    scanResults.clear();
+  }
+  unsigned long perChannel = timing.scanChannel;
+  if (passive || maxMsPerChannel < perChannel) {
+    perChannel = maxMsPerChannel;
+  }
+  unsigned long duration = (channel != 0 ? 1 : CHANNELS) * perChannel;
+
+  if (!async) {
+    delay(duration);
+    scanResults = scan(showHidden, channel);
+    scanState = scanResults.size();
+    return scanState;
+  }
+  scanState = WIFI_SCAN_RUNNING;
+  schedule(duration, [=]() {
+    scanResults = scan(showHidden, channel);
+    scanState = scanResults.size();
+    fire(ARDUINO_EVENT_WIFI_SCAN_DONE);
+  });
+  return WIFI_SCAN_RUNNING;
+}
+
+int16_t WiFiClass::scanComplete() { return scanState; }
+
+void WiFiClass::scanDelete() {
+  host::sim::Untracked untracked;
+  scanResults.clear();
+  scanResults.shrink_to_fit();
+  scanState = WIFI_SCAN_FAILED;
+}
+
+bool WiFiClass::getNetworkInfo(uint8_t index, String &ssid,
+                               uint8_t &encryptionType, int32_t &rssi,
+                               uint8_t *&bssid, int32_t &channel) {
+  if (index >= scanResults.size()) {
+    return false;
+  }
+  host::AccessPoint &ap = scanResults[index];
+  ssid = ap.ssid.c_str();
+  encryptionType = this->encryptionType(index);
+  rssi = ap.rssi;
+  bssid = ap.bssid;
+  channel = ap.channel;
+  return true;
+}
+
+String WiFiClass::SSID(uint8_t index) {
+  return String(index < scanResults.size() ? scanResults[index].ssid.c_str()
+                                           : "");
+}
+
+int32_t WiFiClass::RSSI(uint8_t index) {
+  return index < scanResults.size() ? scanResults[index].rssi : 0;
+}
+
+wifi_auth_mode_t WiFiClass::encryptionType(uint8_t index) {
+  if (index >= scanResults.size() || scanResults[index].pass.empty()) {
+    return WIFI_AUTH_OPEN;
+  }
+  return WIFI_AUTH_WPA2_PSK;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb callback,
+                                   arduino_event_id_t event) {
+  host::sim::Untracked untracked;
+  Handler handler;
+  handler.id = nextHandlerId++;
+  handler.event = event;
+  handler.callback = callback;
+  handlers.push_back(handler);
+  return handler.id;
+}
+
+void WiFiClass::removeEvent(wifi_event_id_t id) {
+  host::sim::Untracked untracked;
+  for (size_t i = 0; i < handlers.size(); i++) {
+    if (handlers[i].id == id) {
+      handlers.erase(handlers.begin() + i);
+      return;
+    }
+  }
+}
+
+esp_err_t esp_wifi_disconnect() {
+  WiFi.disconnect();
+  return ESP_OK;
+}
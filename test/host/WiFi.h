@@ -0,0 +1,114 @@
+// Stand-in for the WiFi library of the ESP32 core. Scans and connects are
+// answered by a simulated radio that takes time on the simulated clock and
+// reports through the same events as the driver; see host.h
+
+#ifndef WiFi_h
+#define WiFi_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiClient.h"
+#include "esp_wifi.h"
+
+typedef enum {
+  WL_NO_SHIELD = 255,
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL,
+  WL_SCAN_COMPLETED,
+  WL_CONNECTED,
+  WL_CONNECT_FAILED,
+  WL_CONNECTION_LOST,
+  WL_DISCONNECTED,
+} wl_status_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_READY = 0,
+  ARDUINO_EVENT_WIFI_SCAN_DONE,
+  ARDUINO_EVENT_WIFI_STA_START,
+  ARDUINO_EVENT_WIFI_STA_STOP,
+  ARDUINO_EVENT_WIFI_STA_CONNECTED,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP6,
+  ARDUINO_EVENT_WIFI_STA_LOST_IP,
+  ARDUINO_EVENT_WIFI_AP_START,
+  ARDUINO_EVENT_WIFI_AP_STOP,
+  ARDUINO_EVENT_MAX,
+} arduino_event_id_t;
+
+typedef union {
+  wifi_event_sta_disconnected_t wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+typedef arduino_event_info_t WiFiEventInfo_t;
+typedef size_t wifi_event_id_t;
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)>
+    WiFiEventFuncCb;
+
+class WiFiClass {
+ public:
+  // station
+  wl_status_t begin(const char *ssid, const char *passphrase = NULL,
+                    int32_t channel = 0, const uint8_t *bssid = NULL,
+                    bool connect = true);
+  wl_status_t begin();
+  bool config(IPAddress localIP, IPAddress gateway, IPAddress subnet);
+  bool disconnect(bool wifioff = false, bool eraseap = false);
+  bool setAutoReconnect(bool autoReconnect);
+  wl_status_t status();
+  uint8_t waitForConnectResult(unsigned long timeoutLength = 60000);
+  IPAddress localIP();
+  uint8_t *macAddress(uint8_t *mac);
+  String macAddress();
+  uint8_t *BSSID();
+  int32_t channel();
+  String SSID();
+  int32_t RSSI();
+  bool setHostname(const char *hostname);
+  const char *getHostname();
+
+  // mode
+  bool mode(wifi_mode_t mode);
+  wifi_mode_t getMode();
+
+  // access point
+  bool softAP(const char *ssid, const char *passphrase = NULL,
+              int channel = 1, int ssidHidden = 0, int maxConnection = 4);
+  bool softAPConfig(IPAddress localIP, IPAddress gateway, IPAddress subnet);
+  bool softAPdisconnect(bool wifioff = false);
+  IPAddress softAPIP();
+  uint8_t *softAPmacAddress(uint8_t *mac);
+  String softAPmacAddress();
+  uint8_t softAPgetStationNum();
+
+  // scan
+  int16_t scanNetworks(bool async = false, bool showHidden = false,
+                       bool passive = false, uint32_t maxMsPerChannel = 300,
+                       uint8_t channel = 0);
+  int16_t scanComplete();
+  void scanDelete();
+  bool getNetworkInfo(uint8_t index, String &ssid, uint8_t &encryptionType,
+                      int32_t &rssi, uint8_t *&bssid, int32_t &channel);
+  String SSID(uint8_t index);
+  int32_t RSSI(uint8_t index);
+  wifi_auth_mode_t encryptionType(uint8_t index);
+
+  // events
+  wifi_event_id_t onEvent(WiFiEventFuncCb callback,
+                          arduino_event_id_t event = ARDUINO_EVENT_MAX);
+  void removeEvent(wifi_event_id_t id);
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,24 @@
+// Stand-in for WiFiClient of the ESP32 core: only the peer of a request
+// served by the WebServer stand-in
+
+#ifndef WiFiClient_h
+#define WiFiClient_h
+
+#include "IPAddress.h"
+
+class WiFiClient {
+ public:
+  WiFiClient() : _port(0) {}
+  WiFiClient(IPAddress ip, uint16_t port) : _ip(ip), _port(port) {}
+
+  IPAddress remoteIP() const { return _ip; }
+  uint16_t remotePort() const { return _port; }
+  uint8_t connected() const { return _port != 0; }
+  void stop() {}
+
+ private:
+  IPAddress _ip;
+  uint16_t _port;
+};
+
+#endif
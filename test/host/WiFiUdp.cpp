@@ -0,0 +1,179 @@
+#include "WiFiUdp.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <deque>
+#include <map>
+
+#include "host.h"
+#include "sim.h"
+
+namespace {
+
+struct Packet {
+  std::vector<uint8_t> data;
+  IPAddress from;
+  uint16_t fromPort;
+};
+
+// packets to the device by port, and from it by port of the client
+std::map<uint16_t, std::deque<Packet>> inbound;
+std::map<uint16_t, std::vector<std::vector<uint8_t>>> outbound;
+
+// the core's buffer for a received packet
+const size_t MAX_PACKET = 1460;
+
+}  // namespace
+
+namespace host {
+
+namespace sim {
+
+void resetUdp() {
+  Untracked untracked;
+  inbound.clear();
+  outbound.clear();
+}
+
+}  // namespace sim
+
+void sendPacket(uint16_t port, const std::vector<uint8_t> &packet,
+                IPAddress from, uint16_t fromPort) {
+  sim::Untracked untracked;
+  Packet p;
+  p.data = packet;
+  p.from = from;
+  p.fromPort = fromPort;
+  inbound[port].push_back(p);
+}
+
+std::vector<std::vector<uint8_t>> receivePackets(uint16_t fromPort) {
+  sim::Untracked untracked;
+  std::vector<std::vector<uint8_t>> packets;
+  packets.swap(outbound[fromPort]);
+  return packets;
+}
+
+}  // namespace host
+
+WiFiUDP::~WiFiUDP() { stop(); }
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+  stop();
+  _port = port;
+  uint16_t hostPort = host::sim::hostPort(port);
+  if (hostPort == 0) {
+    return 1;
+  }
+  _socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(hostPort);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(_socket, (sockaddr *)&address, sizeof(address)) != 0) {
+    perror("WiFiUDP: loopback port");
+    close(_socket);
+    _socket = -1;
+    _port = 0;
+    return 0;
+  }
+  return 1;
+}
+
+void WiFiUDP::stop() {
+  if (_socket >= 0) {
+    close(_socket);
+    _socket = -1;
+  }
+  _port = 0;
+  host::sim::Untracked untracked;
+  std::vector<uint8_t>().swap(_rx);
+  std::vector<uint8_t>().swap(_tx);
+}
+
+int WiFiUDP::parsePacket() {
+  if (_port == 0) {
+    return 0;
+  }
+  host::sim::Untracked untracked;
+  _rx.clear();
+  _rxRead = 0;
+
+  if (_socket >= 0) {
+    uint8_t buffer[MAX_PACKET];
+    sockaddr_in peer;
+    socklen_t peerLength = sizeof(peer);
+    ssize_t n = recvfrom(_socket, buffer, sizeof(buffer), 0,
+                         (sockaddr *)&peer, &peerLength);
+    if (n <= 0) {
+      return 0;
+    }
+    _rx.assign(buffer, buffer + n);
+    _remoteIP = IPAddress((uint32_t)peer.sin_addr.s_addr);
+    _remotePort = ntohs(peer.sin_port);
+    return n;
+  }
+
+  std::deque<Packet> &queue = inbound[_port];
+  if (queue.empty()) {
+    return 0;
+  }
+  Packet &packet = queue.front();
+  size_t size = packet.data.size() < MAX_PACKET ? packet.data.size()
+                                                 : MAX_PACKET;
+  _rx.assign(packet.data.begin(), packet.data.begin() + size);
+  _remoteIP = packet.from;
+  _remotePort = packet.fromPort;
+  queue.pop_front();
+  return size;
+}
+
+int WiFiUDP::read(uint8_t *buffer, size_t len) {
+  size_t left = _rx.size() - _rxRead;
+  if (left == 0) {
+    return -1;
+  }
+  if (len > left) {
+    len = left;
+  }
+  memcpy(buffer, _rx.data() + _rxRead, len);
+  _rxRead += len;
+  return len;
+}
+
+void WiFiUDP::flush() { _rxRead = _rx.size(); }
+
+IPAddress WiFiUDP::remoteIP() { return _remoteIP; }
+
+uint16_t WiFiUDP::remotePort() { return _remotePort; }
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+  host::sim::Untracked untracked;
+  _tx.clear();
+  _txIP = ip;
+  _txPort = port;
+  return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *buffer, size_t size) {
+  host::sim::Untracked untracked;
+  _tx.insert(_tx.end(), buffer, buffer + size);
+  return size;
+}
+
+int WiFiUDP::endPacket() {
+  if (_socket >= 0) {
+    sockaddr_in peer = {};
+    peer.sin_family = AF_INET;
+    peer.sin_port = htons(_txPort);
+    peer.sin_addr.s_addr = (uint32_t)_txIP;
+    return sendto(_socket, _tx.data(), _tx.size(), 0, (sockaddr *)&peer,
+                  sizeof(peer)) == (ssize_t)_tx.size();
+  }
+  host::sim::Untracked untracked;
+  outbound[_txPort].push_back(_tx);
+  return 1;
+}
@@ -0,0 +1,48 @@
+// Stand-in for WiFiUDP of the ESP32 core. Packets are queued in memory, see
+// host::sendPacket() and host::receivePackets(), or go over a loopback socket
+// when the port is mapped with host::mapPort()
+
+#ifndef WiFiUdp_h
+#define WiFiUdp_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "IPAddress.h"
+
+class WiFiUDP {
+ public:
+  ~WiFiUDP();
+
+  uint8_t begin(uint16_t port);
+  void stop();
+
+  // size of the next packet, which is then read with read(); 0 if there is
+  // none
+  int parsePacket();
+  int read(uint8_t *buffer, size_t len);
+  void flush();
+  IPAddress remoteIP();
+  uint16_t remotePort();
+
+  int beginPacket(IPAddress ip, uint16_t port);
+  size_t write(const uint8_t *buffer, size_t size);
+  int endPacket();
+
+ private:
+  uint16_t _port = 0;  // 0: not started
+  int _socket = -1;    // loopback mode
+
+  std::vector<uint8_t> _rx;
+  size_t _rxRead = 0;
+  IPAddress _remoteIP;
+  uint16_t _remotePort = 0;
+
+  std::vector<uint8_t> _tx;
+  IPAddress _txIP;
+  uint16_t _txPort = 0;
+};
+
+#endif
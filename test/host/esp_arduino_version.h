@@ -0,0 +1,10 @@
+// Stand-in: the host build follows version 2 of the ESP32 Arduino core
+
+#ifndef ESP_ARDUINO_VERSION_H
+#define ESP_ARDUINO_VERSION_H
+
+#define ESP_ARDUINO_VERSION_MAJOR 2
+#define ESP_ARDUINO_VERSION_MINOR 0
+#define ESP_ARDUINO_VERSION_PATCH 14
+
+#endif
@@ -0,0 +1,118 @@
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include "Arduino.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "host.h"
+#include "sim.h"
+
+struct EventGroup {
+  EventBits_t bits;
+};
+
+struct Queue {
+  UBaseType_t length;
+  UBaseType_t itemSize;
+  std::deque<std::vector<uint8_t>> items;
+};
+
+EventGroupHandle_t xEventGroupCreate() { return new EventGroup(); }
+
+void vEventGroupDelete(EventGroupHandle_t group) { delete group; }
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+  group->bits |= bits;
+  return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+  EventBits_t old = group->bits;
+  group->bits &= ~bits;
+  return old;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+  return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                                BaseType_t clearOnExit, BaseType_t waitForAll,
+                                TickType_t wait) {
+  uint64_t deadline = host::sim::now() + (uint64_t)wait * 1000;
+
+  for (;;) {
+    host::sim::runEvents();
+    EventBits_t set = group->bits & bits;
+    if (waitForAll ? set == bits : set != 0) {
+      if (clearOnExit) {
+        group->bits &= ~bits;
+      }
+      return set | (group->bits & ~bits);
+    }
+    uint64_t now = host::sim::now();
+    if (now >= deadline) {
+      return group->bits;
+    }
+    // on to the next radio event, which may set the bits
+    uint64_t next;
+    if (host::sim::realClock()) {
+      delay(1);
+    } else if (host::sim::nextEventTime(&next) && next < deadline) {
+      host::sim::setNow(next > now ? next : now);
+    } else {
+      host::sim::setNow(deadline);
+    }
+  }
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  Queue *queue = new Queue();
+  queue->length = length;
+  queue->itemSize = itemSize;
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item,
+                      TickType_t /* wait */) {
+  if (queue->items.size() >= queue->length) {
+    return pdFALSE;
+  }
+  const uint8_t *bytes = (const uint8_t *)item;
+  queue->items.push_back(
+      std::vector<uint8_t>(bytes, bytes + queue->itemSize));
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item,
+                         TickType_t /* wait */) {
+  if (queue->items.empty()) {
+    return pdFALSE;
+  }
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  return pdTRUE;
+}
+
+// no tasks on the host; starting one fails
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t,
+                                   void *, UBaseType_t, TaskHandle_t *,
+                                   BaseType_t) {
+  return pdFAIL;
+}
+
+void vTaskDelete(TaskHandle_t /* task */) {}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks * portTICK_PERIOD_MS); }
+
+TickType_t xTaskGetTickCount() { return millis() / portTICK_PERIOD_MS; }
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t /* task */) {
+  return 0;
+}
@@ -0,0 +1,24 @@
+// Stand-in for the FreeRTOS of ESP-IDF. There is one task on the host:
+// blocking waits run the simulated clock instead, and no tasks can be
+// created
+
+#ifndef FreeRTOS_h
+#define FreeRTOS_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7fffffff
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef event_groups_h
+#define event_groups_h
+
+#include "FreeRTOS.h"
+
+typedef uint32_t EventBits_t;
+typedef struct EventGroup *EventGroupHandle_t;
+
+EventGroupHandle_t xEventGroupCreate();
+void vEventGroupDelete(EventGroupHandle_t group);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+// runs the clock until one (or all) of bits is set or wait ticks passed
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                                BaseType_t clearOnExit, BaseType_t waitForAll,
+                                TickType_t wait);
+
+#endif
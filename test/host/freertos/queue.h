@@ -0,0 +1,14 @@
+#ifndef queue_h
+#define queue_h
+
+#include "FreeRTOS.h"
+
+typedef struct Queue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+void vQueueDelete(QueueHandle_t queue);
+// nobody else can take from or add to a queue meanwhile, so these never wait
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait);
+
+#endif
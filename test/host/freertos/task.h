@@ -0,0 +1,19 @@
+#ifndef task_h
+#define task_h
+
+#include "FreeRTOS.h"
+
+typedef struct Task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+// fails: there are no other tasks on the host
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name,
+                                   uint32_t stackDepth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *task,
+                                   BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+#endif
@@ -0,0 +1,247 @@
+// Counts the heap used by the library. malloc() and friends are replaced for
+// the whole process and passed on to glibc; the blocks allocated outside of
+// an Untracked scope are kept in a hash set, so freeing them is accounted
+// for too. The set itself lives on the glibc heap directly.
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+
+#include "host.h"
+#include "sim.h"
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+}
+
+namespace {
+
+const size_t DEFAULT_HEAP_SIZE = 200 * 1024;
+
+size_t heapSize = DEFAULT_HEAP_SIZE;
+unsigned long allocations = 0;
+size_t inUse = 0;
+size_t peak = 0;
+size_t bootPeak = 0;  // since reset(), for ESP.getMinFreeHeap()
+int untracked = 0;
+
+// open addressing with linear probing
+void **slots = NULL;
+size_t slotCount = 0;
+size_t slotsUsed = 0;  // including removed ones
+void *const REMOVED = (void *)1;
+
+size_t slotOf(void *ptr) {
+  return ((uintptr_t)ptr >> 4) * 2654435761u & (slotCount - 1);
+}
+
+void insert(void *ptr);
+
+void grow() {
+  void **old = slots;
+  size_t oldCount = slotCount;
+
+  slotCount = slotCount == 0 ? 1024 : 2 * slotCount;
+  slots = (void **)__libc_calloc(slotCount, sizeof(void *));
+  if (slots == NULL) {
+    abort();
+  }
+  slotsUsed = 0;
+  for (size_t i = 0; i < oldCount; i++) {
+    if (old[i] != NULL && old[i] != REMOVED) {
+      insert(old[i]);
+    }
+  }
+  __libc_free(old);
+}
+
+void insert(void *ptr) {
+  if (2 * (slotsUsed + 1) > slotCount) {
+    grow();
+  }
+  size_t i = slotOf(ptr);
+  while (slots[i] != NULL && slots[i] != REMOVED) {
+    i = (i + 1) & (slotCount - 1);
+  }
+  if (slots[i] == NULL) {
+    slotsUsed++;
+  }
+  slots[i] = ptr;
+}
+
+bool remove(void *ptr) {
+  if (slotCount == 0) {
+    return false;
+  }
+  for (size_t i = slotOf(ptr); slots[i] != NULL;
+       i = (i + 1) & (slotCount - 1)) {
+    if (slots[i] == ptr) {
+      slots[i] = REMOVED;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool fits(size_t size) {
+  if (untracked > 0 || inUse + size <= heapSize) {
+    return true;
+  }
+  errno = ENOMEM;
+  return false;
+}
+
+void track(void *ptr) {
+  if (ptr == NULL || untracked > 0) {
+    return;
+  }
+  allocations++;
+  insert(ptr);
+  inUse += malloc_usable_size(ptr);
+  if (inUse > peak) {
+    peak = inUse;
+  }
+  if (inUse > bootPeak) {
+    bootPeak = inUse;
+  }
+}
+
+void untrack(void *ptr) {
+  if (ptr != NULL && remove(ptr)) {
+    inUse -= malloc_usable_size(ptr);
+  }
+}
+
+}  // namespace
+
+extern "C" void *malloc(size_t size) {
+  if (!fits(size)) {
+    return NULL;
+  }
+  void *ptr = __libc_malloc(size);
+  track(ptr);
+  return ptr;
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+  if (!fits(count * size)) {
+    return NULL;
+  }
+  void *ptr = __libc_calloc(count, size);
+  track(ptr);
+  return ptr;
+}
+
+extern "C" void *realloc(void *ptr, size_t size) {
+  if (ptr == NULL) {
+    return malloc(size);
+  }
+  if (size == 0) {
+    free(ptr);
+    return NULL;
+  }
+  size_t old = malloc_usable_size(ptr);
+  bool tracked = remove(ptr);
+  if (tracked) {
+    inUse -= old;
+  }
+  void *moved = fits(size) ? __libc_realloc(ptr, size) : NULL;
+  if (moved == NULL) {
+    // the block is unchanged
+    if (tracked) {
+      insert(ptr);
+      inUse += old;
+    }
+    return NULL;
+  }
+  if (tracked && untracked > 0) {
+    // keep counting it; it was the library's
+    insert(moved);
+    inUse += malloc_usable_size(moved);
+  } else {
+    track(moved);
+  }
+  return moved;
+}
+
+extern "C" void free(void *ptr) {
+  untrack(ptr);
+  __libc_free(ptr);
+}
+
+void *operator new(size_t size) {
+  void *ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == NULL) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  free(ptr);
+}
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  free(ptr);
+}
+
+namespace host {
+
+namespace sim {
+
+Untracked::Untracked() { untracked++; }
+
+Untracked::~Untracked() { untracked--; }
+
+Tracked::Tracked() : _untracked(untracked) { untracked = 0; }
+
+Tracked::~Tracked() { untracked = _untracked; }
+
+size_t heapFree() { return inUse < heapSize ? heapSize - inUse : 0; }
+
+size_t heapMinFree() { return bootPeak < heapSize ? heapSize - bootPeak : 0; }
+
+// no fragmentation is simulated
+size_t heapLargestFree() { return heapFree(); }
+
+void resetHeap() {
+  heapSize = DEFAULT_HEAP_SIZE;
+  allocations = 0;
+  peak = inUse;
+  bootPeak = inUse;
+}
+
+}  // namespace sim
+
+HeapStats heapStats() {
+  HeapStats stats;
+  stats.allocations = allocations;
+  stats.inUse = inUse;
+  stats.peak = peak;
+  return stats;
+}
+
+void resetHeapPeak() { peak = inUse; }
+
+void setHeapSize(size_t size) { heapSize = size; }
+
+}  // namespace host
@@ -0,0 +1,155 @@
+// Control over the simulated ESP32 that the stand-ins in this directory make
+// up: its clock, heap, radio, flash, and the clients of its web and DNS
+// servers. Used by the tests, the benchmarks and the portal harness.
+
+#ifndef host_h
+#define host_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "IPAddress.h"
+
+namespace host {
+
+// Back to power on: clock at 0, heap counters cleared, no access points,
+// empty flash, default timings and no injected failures. Call at the start
+// of every test
+void reset();
+
+// ---- clock
+
+// The simulated clock only moves when a test advances it or the library
+// waits: delay(), yield() (1 ms) and blocking waits for the radio. Radio
+// events that fall due on the way are delivered at their time
+void advance(unsigned long ms);
+// Use the clock of the host instead and really wait; for the portal harness
+void useRealClock();
+
+// calls of ESP.restart() since reset(); the device keeps running
+int getRestartCount();
+
+// ---- heap
+
+struct HeapStats {
+  unsigned long allocations;  // calls to malloc(), new, ... since reset()
+  size_t inUse;               // bytes
+  size_t peak;                // bytes, since reset() or resetHeapPeak()
+};
+// Only allocations made by the library (and by test code itself) are
+// counted; the stand-ins, host::request() included, do not count their own
+HeapStats heapStats();
+void resetHeapPeak();
+// Heap of the simulated device, reported by ESP.getFreeHeap(); allocations
+// beyond it fail. Default 200 KB, about what is left with WiFi running
+void setHeapSize(size_t size);
+
+// ---- radio
+
+struct AccessPoint {
+  std::string ssid;
+  std::string pass;  // empty: open network
+  uint8_t bssid[6];
+  uint8_t channel;
+  int8_t rssi;
+  bool hidden;  // does not broadcast its SSID
+};
+void addAccessPoint(const AccessPoint &ap);
+// A network of n APs named ssid, on channels 1, 6 and 11 in turn
+void addNetwork(const char *ssid, const char *pass, int count = 1,
+                int8_t rssi = -60);
+void clearAccessPoints();
+
+// milliseconds the radio takes for each step
+struct RadioTiming {
+  unsigned long scanChannel;  // per channel of an active scan
+  unsigned long associate;    // found the AP until associated
+  unsigned long dhcp;         // associated until the IP is assigned
+  unsigned long retry;        // between attempts of the driver
+};
+RadioTiming &radioTiming();
+
+// the next count scans fail to start
+void failScans(int count);
+int getScanCount();  // scans started since reset()
+
+struct ConnectRequest {
+  std::string ssid;
+  std::string pass;
+  int32_t channel;  // 0: scan all channels
+  bool directed;    // a BSSID was given
+  uint8_t bssid[6];
+  unsigned long time;  // millis()
+};
+// calls of WiFi.begin() since reset()
+const std::vector<ConnectRequest> &getConnectRequests();
+// handlers registered with WiFi.onEvent() and not removed
+size_t getEventHandlerCount();
+
+// ---- web server
+
+struct Request {
+  std::string method = "GET";
+  std::string uri;  // with the query
+  std::string body;
+  std::map<std::string, std::string> headers;  // Host is added if missing
+  IPAddress client = IPAddress(192, 168, 4, 2);
+};
+
+struct Response {
+  int code = 0;  // 0: no server listening
+  std::map<std::string, std::string> headers;  // names in lower case
+  std::string body;
+  bool chunked = false;
+  std::vector<size_t> chunks;  // sizes of the chunks, without the last one
+  std::string raw;             // as sent on the wire
+
+  std::string header(const char *name) const;
+};
+
+// Sent to the web server on port 80 of the device, which answers it right
+// away, like handleClient() would
+Response request(const Request &request);
+Response get(const char *uri, const char *hostHeader = "192.168.4.1");
+Response post(const char *uri, const std::string &form);
+
+// ---- UDP (DNS)
+
+// A packet from a client to port of the device, read by its next
+// parsePacket()
+void sendPacket(uint16_t port, const std::vector<uint8_t> &packet,
+                IPAddress from = IPAddress(192, 168, 4, 2),
+                uint16_t fromPort = 50000);
+// Packets the device sent to fromPort, oldest first; cleared by this call
+std::vector<std::vector<uint8_t>> receivePackets(uint16_t fromPort = 50000);
+
+// ---- flash (Preferences)
+
+// Writes fail (returning 0) while this is set
+void failFlashWrites(bool fail);
+// Raw access to the stored value of a key, to check or corrupt it
+bool hasFlashKey(const char *ns, const char *key);
+std::vector<uint8_t> readFlash(const char *ns, const char *key);
+void writeFlash(const char *ns, const char *key,
+                const std::vector<uint8_t> &value);
+void eraseFlash();
+
+// ---- loopback sockets, for the portal harness
+
+// Serve port of the device on 127.0.0.1:hostPort; TCP for the web server,
+// UDP for the DNS server. Must be set before the servers are started
+void mapPort(uint16_t port, uint16_t hostPort);
+
+// ---- serial
+
+// Serial output of the device goes to stderr while this is set; default:
+// set if the environment variable WM_HOST_SERIAL is
+void setSerialOutput(bool enabled);
+
+}  // namespace host
+
+#endif
@@ -0,0 +1,59 @@
+// Glue between the stand-ins; not for use by tests
+
+#ifndef sim_h
+#define sim_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace host {
+namespace sim {
+
+// current time in us
+uint64_t now();
+bool realClock();
+// runs the clock to time (us) without delivering events
+void setNow(uint64_t time);
+
+// time of the next scheduled radio event in us; false if there is none
+bool nextEventTime(uint64_t *time);
+// delivers the radio events that are due
+void runEvents();
+
+// Allocations made while an Untracked exists are not counted as made by the
+// library and ignore the size of the simulated heap
+class Untracked {
+ public:
+  Untracked();
+  ~Untracked();
+};
+
+// Counts allocations again inside an Untracked, while a stand-in calls back
+// into the library
+class Tracked {
+ public:
+  Tracked();
+  ~Tracked();
+
+ private:
+  int _untracked;
+};
+
+size_t heapFree();
+size_t heapMinFree();
+size_t heapLargestFree();
+
+// parts of host::reset()
+void resetHeap();
+void resetRadio();
+void resetFlash();
+void resetServers();
+void resetUdp();
+
+// loopback port for port of the device; 0 if it is not mapped
+uint16_t hostPort(uint16_t port);
+
+}  // namespace sim
+}  // namespace host
+
+#endif
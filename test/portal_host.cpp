@@ -0,0 +1,155 @@
+// The config portal on loopback sockets, for extras/loadgen.js: the real
+// portal loop with a simulated radio, on the clock of the host. The web
+// server listens on 127.0.0.1:--http-port and the DNS server on
+// 127.0.0.1:--dns-port; then, from another shell,
+//
+//   portal_host [--http-port 8080] [--dns-port 5353] [--aps 20]
+//               [--params 4] [--duration 0]
+//   node ../extras/loadgen.js --host 127.0.0.1 --port 8080 --dns-port 5353
+//
+// A form saved with SSID "loadgen" and password "password" connects and
+// ends the portal. On exit it prints the peak heap and the allocations of
+// the library. --duration 0 runs until the portal ends or Ctrl-C.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <WiFiManager-esp32.h>
+
+#include "host.h"
+
+namespace {
+
+struct Options {
+  int httpPort = 8080;
+  int dnsPort = 5353;
+  int aps = 20;
+  int params = 4;
+  unsigned long duration = 0;  // seconds
+};
+
+volatile sig_atomic_t stopping = 0;
+
+void onSignal(int) { stopping = 1; }
+
+bool parse(int argc, char **argv, Options *options) {
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 == argc) {
+      return false;
+    }
+    long value = strtol(argv[i + 1], NULL, 10);
+    if (strcmp(argv[i], "--http-port") == 0) {
+      options->httpPort = value;
+    } else if (strcmp(argv[i], "--dns-port") == 0) {
+      options->dnsPort = value;
+    } else if (strcmp(argv[i], "--aps") == 0) {
+      options->aps = value;
+    } else if (strcmp(argv[i], "--params") == 0) {
+      options->params = value;
+    } else if (strcmp(argv[i], "--duration") == 0) {
+      options->duration = value;
+    } else {
+      return false;
+    }
+    i++;
+  }
+  return true;
+}
+
+// the neighbours of an installation: a few networks with several APs each,
+// and the one loadgen.js saves
+void addAccessPoints(int aps) {
+  char ssid[33];
+  for (int i = 0; i < aps; i++) {
+    host::AccessPoint ap;
+    snprintf(ssid, sizeof(ssid), "neighbour-%02d", i % 8);
+    ap.ssid = ssid;
+    ap.pass = "secret";
+    memset(ap.bssid, 0, sizeof(ap.bssid));
+    ap.bssid[0] = 0x02;
+    ap.bssid[5] = i + 1;
+    ap.channel = 1 + i % 13;
+    ap.rssi = -45 - (i * 7) % 45;
+    ap.hidden = false;
+    host::addAccessPoint(ap);
+  }
+  host::addNetwork("loadgen", "password");
+}
+
+const char *resultName(WiFiManager::PortalResult result) {
+  switch (result) {
+    case WiFiManager::PORTAL_RUNNING:
+      return "running";
+    case WiFiManager::PORTAL_CONNECTED:
+      return "connected";
+    case WiFiManager::PORTAL_FAILED:
+      return "failed";
+    case WiFiManager::PORTAL_TIMEOUT:
+      return "timeout";
+    case WiFiManager::PORTAL_IDLE:
+      return "idle";
+  }
+  return "";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse(argc, argv, &options)) {
+    fprintf(stderr,
+            "usage: portal_host [--http-port 8080] [--dns-port 5353] "
+            "[--aps 20] [--params 4] [--duration 0]\n");
+    return 1;
+  }
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  host::reset();
+  host::useRealClock();
+  host::mapPort(80, options.httpPort);
+  host::mapPort(53, options.dnsPort);
+  addAccessPoints(options.aps);
+
+  WiFiManager wm;
+  wm.configure("portal-host", nullptr);
+  wm.setConfigPortalTimeout(0);
+  // the first is p0, the field loadgen.js fills in
+  std::vector<std::string> ids(options.params);
+  std::vector<WiFiManagerParameter> params;
+  params.reserve(options.params);
+  for (int i = 0; i < options.params; i++) {
+    ids[i] = "p" + std::to_string(i);
+    params.emplace_back(ids[i].c_str(), ids[i].c_str(), "", 32);
+    wm.addParameter(&params.back());
+  }
+
+  wm.beginConfigPortal();
+  printf("portal on http://127.0.0.1:%d, DNS on 127.0.0.1:%d\n",
+         options.httpPort, options.dnsPort);
+  fflush(stdout);
+
+  unsigned long start = millis();
+  WiFiManager::PortalResult result = WiFiManager::PORTAL_RUNNING;
+  while (result == WiFiManager::PORTAL_RUNNING && !stopping &&
+         (options.duration == 0 ||
+          millis() - start < options.duration * 1000)) {
+    result = wm.processConfigPortal();
+    delay(1);
+  }
+  if (result == WiFiManager::PORTAL_RUNNING) {
+    wm.stopConfigPortal();
+  }
+
+  host::HeapStats heap = host::heapStats();
+  printf("portal: %s after %lu s\n", resultName(result),
+         (millis() - start) / 1000);
+  printf("peak heap: %lu bytes\n", (unsigned long)heap.peak);
+  printf("allocations: %lu\n", heap.allocations);
+  return 0;
+}
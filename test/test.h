@@ -0,0 +1,63 @@
+// A minimal test framework: TEST() defines a test case, CHECK() and
+// CHECK_EQ() report a failure and go on. Each test starts from a powered on
+// simulated device (host::reset())
+
+#ifndef test_h
+#define test_h
+
+#include <string>
+
+#include "host.h"
+
+namespace test {
+
+typedef void (*TestFunction)();
+
+struct Registrar {
+  Registrar(const char *name, TestFunction function);
+};
+
+void fail(const char *file, int line, const std::string &message);
+
+template <typename T>
+std::string show(const T &value) {
+  return std::to_string(value);
+}
+std::string show(const std::string &value);
+std::string show(const char *value);
+std::string show(char *value);
+std::string show(bool value);
+
+// contents of a file in test/, for goldens
+bool readFile(const char *name, std::string *contents);
+// rewrites the goldens instead of comparing with them if WM_UPDATE_GOLDEN
+// is set
+bool updateGoldens();
+void writeFile(const char *name, const std::string &contents);
+
+}  // namespace test
+
+#define TEST(name)                                     \
+  static void name();                                  \
+  static test::Registrar name##_registrar(#name, name); \
+  static void name()
+
+#define CHECK(condition)                                      \
+  do {                                                        \
+    if (!(condition)) {                                       \
+      test::fail(__FILE__, __LINE__, "CHECK(" #condition ")"); \
+    }                                                         \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                        \
+  do {                                                                    \
+    auto actual_ = (actual);                                              \
+    auto expected_ = (expected);                                          \
+    if (!(actual_ == expected_)) {                                        \
+      test::fail(__FILE__, __LINE__,                                      \
+                 "CHECK_EQ(" #actual ", " #expected "): " +               \
+                     test::show(actual_) + " != " + test::show(expected_)); \
+    }                                                                     \
+  } while (0)
+
+#endif
@@ -0,0 +1,164 @@
+// Heap allocations of the library on the connect and request paths, counted
+// by the host heap. Once the portal is up and each page has been served
+// once (which fills the page cache and a few function statics), none of
+// these may allocate. Allocations inside the ESP32 core, like the header
+// lines WebServer::sendHeader() builds, are not the library's and are not
+// counted; see host.h.
+
+#include <WiFiManager-esp32.h>
+
+#include <string>
+
+#include "test.h"
+
+namespace {
+
+unsigned long allocations() { return host::heapStats().allocations; }
+
+void setUp(WiFiManager &wm) {
+  wm.setDebugOutput(false);
+  wm.configure("alloc", nullptr);
+  wm.clearConnectLog();
+}
+
+void runPortal(WiFiManager &wm, unsigned long ms) {
+  for (unsigned long i = 0; i < ms; i++) {
+    wm.processConfigPortal();
+    host::advance(1);
+  }
+}
+
+// pages and handlers that must not allocate once warmed up; the assets are
+// left out: their ETag and the If-None-Match of the client are Strings too
+// long for the inline buffer
+const char *const uris[] = {
+    "/",          "/wifi",      "/0wifi",        "/scan.json",
+    "/i",         "/metrics",   "/changename",   "/fwlink",
+    "/not-there", "/generate_204", "/hotspot-detect.html",
+};
+
+}  // namespace
+
+TEST(reconnectDoesNotAllocate) {
+  host::addNetwork("home", "secret");
+  WiFiManager wm;
+  setUp(wm);
+  wm.addNetwork("home", "secret");
+  // creates the event group and stores the AP it connected to
+  CHECK(wm.autoConnect());
+  WiFi.disconnect(true);
+  host::advance(100);
+
+  unsigned long before = allocations();
+  CHECK(wm.autoConnect());
+  CHECK_EQ(allocations() - before, 0ul);
+}
+
+TEST(accessorsDoNotAllocate) {
+  WiFiManager wm;
+  setUp(wm);
+  wm.addNetwork("home", "secret");
+
+  unsigned long before = allocations();
+  CHECK_EQ(std::string(wm.getSSIDCStr()), "home");
+  CHECK_EQ(std::string(wm.getPasswordCStr()), "secret");
+  CHECK(wm.getHostnameCStr()[0] != 0);
+  CHECK_EQ(allocations() - before, 0ul);
+}
+
+TEST(portalConnectDoesNotAllocate) {
+  host::addNetwork("home", "secret");
+  WiFiManager wm;
+  setUp(wm);
+  wm.addNetwork("home", "secret");
+  CHECK(wm.autoConnect());
+  WiFi.disconnect(true);
+
+  wm.beginConfigPortal();
+  runPortal(wm, 3000);
+  const std::string form = "s=home&p=secret";
+  host::post("/wifisave", form);
+
+  // connect delay, then beginConnectWifi() and pollConnectResult() until
+  // connected
+  unsigned long before = allocations();
+  WiFiManager::PortalResult result = WiFiManager::PORTAL_RUNNING;
+  for (int i = 0; i < 10000 && result == WiFiManager::PORTAL_RUNNING; i++) {
+    result = wm.processConfigPortal();
+    host::advance(1);
+  }
+  CHECK_EQ(result, WiFiManager::PORTAL_CONNECTED);
+  CHECK_EQ(allocations() - before, 0ul);
+}
+
+TEST(requestsDoNotAllocate) {
+  host::addNetwork("home", "secret", 3);
+  host::addNetwork("office", "secret");
+  WiFiManager wm;
+  setUp(wm);
+  WiFiManagerParameter server("server", "Server", "mqtt.local", 40);
+  wm.addParameter(&server);
+  wm.beginConfigPortal();
+  runPortal(wm, 3000);
+
+  for (const char *uri : uris) {
+    host::get(uri);
+  }
+  for (const char *uri : uris) {
+    unsigned long before = allocations();
+    host::Response response = host::get(uri);
+    CHECK(response.code != 0);
+    if (allocations() != before) {
+      test::fail(__FILE__, __LINE__, std::string(uri) + " allocated");
+    }
+  }
+
+  // a phone joining: its connectivity check is redirected to the portal
+  host::Request probe;
+  probe.uri = "/generate_204";
+  probe.headers["Host"] = "connectivitycheck.gstatic.com";
+  probe.client = IPAddress(192, 168, 4, 7);
+  unsigned long before = allocations();
+  CHECK_EQ(host::request(probe).code, 302);
+  CHECK_EQ(allocations() - before, 0ul);
+  wm.stopConfigPortal();
+}
+
+TEST(renderedPagesDoNotAllocate) {
+  host::addNetwork("home", "secret");
+  WiFiManager wm;
+  setUp(wm);
+  wm.beginConfigPortal();
+  runPortal(wm, 3000);
+  // too little heap left for the page cache, so pages are rendered each time
+  host::setHeapSize(host::heapStats().inUse + 16 * 1024);
+
+  for (const char *uri : {"/wifi", "/i"}) {
+    unsigned long before = allocations();
+    CHECK(host::get(uri).chunked);
+    CHECK_EQ(allocations() - before, 0ul);
+  }
+  wm.stopConfigPortal();
+}
+
+TEST(savingShortValuesDoesNotAllocate) {
+  host::addNetwork("home", "secret");
+  WiFiManager wm;
+  setUp(wm);
+  WiFiManagerParameter port("port", "Port", "1883", 6);
+  wm.addParameter(&port);
+  wm.beginConfigPortal();
+  runPortal(wm, 3000);
+
+  // values that fit the inline buffer of the Strings WebServer::arg()
+  // returns; longer ones are copied to the heap by the core. The password is
+  // wrong, so the portal is back after each attempt
+  const std::string form = "s=home&p=wrong&port=8883";
+  CHECK_EQ(host::post("/wifisave", form).code, 200);
+  runPortal(wm, 30000);
+
+  unsigned long before = allocations();
+  CHECK_EQ(host::post("/wifisave", form).code, 200);
+  CHECK_EQ(allocations() - before, 0ul);
+  wm.stopConfigPortal();
+}
@@ -0,0 +1,70 @@
+// Settings in the blob format (CONFIG_FORMAT_BLOB), which also stores the
+// values of custom parameters: a value saved in the portal must come back in
+// the next WiFiManager, whether the parameter is added before or after
+// configure() reads the settings, and survive the writes that follow.
+
+#include <WiFiManager-esp32.h>
+
+#include <string>
+
+#include "test.h"
+
+namespace {
+
+void setUp(WiFiManager &wm) {
+  wm.setDebugOutput(false);
+  wm.setConfigFormat(WiFiManager::CONFIG_FORMAT_BLOB);
+}
+
+// saves value for the parameter server in the portal
+void saveInPortal(const char *value) {
+  WiFiManager wm;
+  setUp(wm);
+  wm.configure("config", nullptr);
+  WiFiManagerParameter server("server", "Server", "default", 32);
+  wm.addParameter(&server);
+  wm.beginConfigPortal();
+  for (int i = 0; i < 3000; i++) {
+    wm.processConfigPortal();
+    host::advance(1);
+  }
+  host::post("/wifisave", std::string("s=home&p=secret&server=") + value);
+  wm.stopConfigPortal();
+}
+
+}  // namespace
+
+TEST(parameterAddedAfterConfigureIsRestored) {
+  saveInPortal("stored");
+
+  WiFiManager wm;
+  setUp(wm);
+  wm.configure("config", nullptr);
+  WiFiManagerParameter server("server", "Server", "default", 32);
+  wm.addParameter(&server);
+
+  CHECK_EQ(std::string(server.getValue()), "stored");
+}
+
+TEST(parameterAddedBeforeConfigureIsRestored) {
+  saveInPortal("stored");
+
+  {
+    WiFiManager wm;
+    setUp(wm);
+    WiFiManagerParameter server("server", "Server", "default", 32);
+    wm.addParameter(&server);
+    wm.configure("config", nullptr);
+    CHECK_EQ(std::string(server.getValue()), "stored");
+
+    // writes the settings, parameters included
+    wm.addNetwork("office", "secret");
+  }
+
+  WiFiManager wm;
+  setUp(wm);
+  wm.configure("config", nullptr);
+  WiFiManagerParameter server("server", "Server", "default", 32);
+  wm.addParameter(&server);
+  CHECK_EQ(std::string(server.getValue()), "stored");
+}
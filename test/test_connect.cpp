@@ -0,0 +1,130 @@
+// Connecting on the WiFi events of the simulated radio: the attempt ends the
+// moment the IP is assigned or the driver reports a failure, with the time of
+// each step recorded, and not on the next poll of WiFi.status().
+
+#include <WiFiManager-esp32.h>
+
+#include "test.h"
+
+namespace {
+
+void setUp(WiFiManager &wm) {
+  wm.setDebugOutput(false);
+  wm.configure("connect", nullptr);
+  wm.clearConnectLog();
+}
+
+WiFiManagerConnectRecord lastAttempt(WiFiManager &wm) {
+  WiFiManagerConnectRecord record;
+  memset(&record, 0, sizeof(record));
+  CHECK(wm.getConnectLog(0, &record));
+  return record;
+}
+
+}  // namespace
+
+TEST(connectEndsWhenTheIpIsAssigned) {
+  host::addNetwork("home", "secret");
+  const host::RadioTiming &timing = host::radioTiming();
+  WiFiManager wm;
+  setUp(wm);
+  wm.addNetwork("home", "secret");
+
+  CHECK(wm.autoConnect());
+
+  // the driver scans all 13 channels, associates, then DHCP
+  unsigned long connected = 13 * timing.scanChannel + timing.associate;
+  unsigned long gotIp = connected + timing.dhcp;
+  CHECK_EQ(millis(), gotIp);
+  CHECK_EQ(wm.getLastConnectDuration(), gotIp);
+  WiFiManager::ConnectTiming steps = wm.getLastConnectTiming();
+  CHECK_EQ(steps.connected, (int32_t)connected);
+  CHECK_EQ(steps.gotIp, (int32_t)gotIp);
+  CHECK_EQ(steps.disconnected, -1);
+  CHECK_EQ(steps.path, (uint8_t)WiFiManager::CONNECT_PATH_FULL);
+  CHECK_EQ(WiFi.status(), WL_CONNECTED);
+}
+
+TEST(reconnectGoesStraightToTheLastAP) {
+  host::addNetwork("home", "secret", 3);
+  const host::RadioTiming &timing = host::radioTiming();
+  {
+    WiFiManager wm;
+    setUp(wm);
+    wm.addNetwork("home", "secret");
+    CHECK(wm.autoConnect());
+  }
+  WiFi.disconnect(true);
+  host::advance(1000);
+
+  WiFiManager wm;
+  wm.setDebugOutput(false);
+  wm.configure("connect", nullptr);
+  unsigned long start = millis();
+  CHECK(wm.autoConnect());
+
+  // BSSID and channel of the first connect; only that channel is scanned
+  CHECK_EQ(millis() - start,
+           timing.scanChannel + timing.associate + timing.dhcp);
+  CHECK_EQ(wm.getLastConnectTiming().path,
+           (uint8_t)WiFiManager::CONNECT_PATH_FAST);
+  CHECK(host::getConnectRequests().back().directed);
+}
+
+TEST(wrongPasswordFailsWithoutWaitingForTheTimeout) {
+  host::addNetwork("home", "secret");
+  const host::RadioTiming &timing = host::radioTiming();
+  WiFiManager wm;
+  setUp(wm);
+  wm.addNetwork("home", "wrong");
+
+  // falls back to the portal, which times out after DEFAULT_TIMEOUT
+  CHECK(!wm.autoConnect());
+
+  // both attempts, newest first; each ends on the failed handshake
+  CHECK_EQ(wm.getConnectLogCount(), 2);
+  for (int i = 0; i < 2; i++) {
+    WiFiManagerConnectRecord record;
+    CHECK(wm.getConnectLog(i, &record));
+    CHECK_EQ(record.attempt, (uint8_t)(1 - i));
+    CHECK_EQ(record.result, (uint8_t)WL_CONNECT_FAILED);
+    CHECK_EQ(record.reason, (uint8_t)WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT);
+    CHECK_EQ(record.connected, -1);
+    CHECK_EQ(record.gotIp, -1);
+    CHECK_EQ(record.end,
+             (int32_t)(13 * timing.scanChannel + timing.associate));
+    CHECK_EQ(record.disconnected, record.end);
+  }
+}
+
+TEST(absentNetworkWaitsForTheConnectTimeout) {
+  WiFiManager wm;
+  setUp(wm);
+  wm.addNetwork("home", "secret");
+  wm.setConnectTimeout(5);
+
+  CHECK(!wm.autoConnect());
+
+  // the driver keeps retrying a network it did not find; only the timeout
+  // ends the attempt
+  WiFiManagerConnectRecord record = lastAttempt(wm);
+  CHECK_EQ(record.end, 5000);
+  CHECK_EQ(record.reason, (uint8_t)WIFI_REASON_NO_AP_FOUND);
+  CHECK(record.result != WL_CONNECTED);
+}
+
+TEST(eventHandlerIsRemovedWithTheManager) {
+  host::addNetwork("home", "secret");
+  {
+    WiFiManager wm;
+    setUp(wm);
+    wm.addNetwork("home", "secret");
+    CHECK(wm.autoConnect());
+    CHECK_EQ(host::getEventHandlerCount(), 1u);
+  }
+  CHECK_EQ(host::getEventHandlerCount(), 0u);
+
+  // events after the manager is gone must not reach it
+  WiFi.disconnect(true);
+  host::advance(100);
+}
@@ -0,0 +1,136 @@
+// The connect log, filled from the events of the simulated radio: one record
+// per attempt with the time of each step, kept in a ring buffer and shown on
+// the info page. The log lives in RTC memory on the device; on the host it is
+// a static that outlives the WiFiManager, so each test clears it first.
+
+#include <WiFiManager-esp32.h>
+
+#include <string>
+
+#include "test.h"
+
+namespace {
+
+void setUp(WiFiManager &wm) {
+  wm.setDebugOutput(false);
+  wm.configure("log", nullptr);
+  wm.clearConnectLog();
+}
+
+WiFiManagerConnectRecord attempt(WiFiManager &wm, int index) {
+  WiFiManagerConnectRecord record;
+  memset(&record, 0, sizeof(record));
+  CHECK(wm.getConnectLog(index, &record));
+  return record;
+}
+
+}  // namespace
+
+TEST(recordsTheStepsOfAnAttempt) {
+  host::addNetwork("office", "secret");
+  const host::RadioTiming &timing = host::radioTiming();
+  WiFiManager wm;
+  setUp(wm);
+  wm.addNetwork("office", "secret");
+  wm.addNetwork("home", "secret");
+
+  CHECK(wm.autoConnect());
+
+  CHECK_EQ(wm.getConnectLogCount(), 1);
+  WiFiManagerConnectRecord record = attempt(wm, 0);
+  // the scan that picked the network, then a directed connect: the channel
+  // of the AP, associate and DHCP
+  int32_t connected = timing.scanChannel + timing.associate;
+  CHECK_EQ(record.scan, (int32_t)(13 * timing.scanChannel));
+  CHECK_EQ(record.start, (uint32_t)record.scan);
+  CHECK_EQ(record.connected, connected);
+  CHECK_EQ(record.gotIp, (int32_t)(connected + timing.dhcp));
+  CHECK_EQ(record.end, record.gotIp);
+  CHECK_EQ(record.disconnected, -1);
+  CHECK_EQ(record.reason, 0);
+  CHECK_EQ(record.attempt, 0);
+  CHECK_EQ(record.path, (uint8_t)WiFiManager::CONNECT_PATH_FAST);
+  CHECK_EQ(record.result, (uint8_t)WL_CONNECTED);
+}
+
+TEST(recordsTheRetryWithTheReasonOfTheFailure) {
+  host::addNetwork("office", "secret");
+  const host::RadioTiming &timing = host::radioTiming();
+  WiFiManager wm;
+  setUp(wm);
+  wm.addNetwork("office", "wrong");
+  wm.setConfigPortalTimeout(1);
+
+  CHECK(!wm.autoConnect());
+
+  CHECK_EQ(wm.getConnectLogCount(), 2);
+  WiFiManagerConnectRecord retry = attempt(wm, 0);
+  WiFiManagerConnectRecord first = attempt(wm, 1);
+  CHECK_EQ(first.attempt, 0);
+  CHECK_EQ(retry.attempt, 1);
+  CHECK(retry.start >= first.start + (uint32_t)first.end);
+  for (const WiFiManagerConnectRecord &record : {first, retry}) {
+    // no scan of our own; the driver scans all channels
+    CHECK_EQ(record.scan, -1);
+    CHECK_EQ(record.path, (uint8_t)WiFiManager::CONNECT_PATH_FULL);
+    CHECK_EQ(record.connected, -1);
+    CHECK_EQ(record.disconnected,
+             (int32_t)(13 * timing.scanChannel + timing.associate));
+    CHECK_EQ(record.reason, WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT);
+    CHECK_EQ(record.result, (uint8_t)WL_CONNECT_FAILED);
+  }
+}
+
+TEST(keepsTheNewestAttempts) {
+  WiFiManager wm;
+  setUp(wm);
+  // hidden ones that are not around; one attempt each, so two rounds
+  const char *ssids[] = {"a", "b", "c", "d", "e"};
+  for (const char *ssid : ssids) {
+    wm.addNetwork(ssid, "secret", 0, true);
+  }
+  // long enough for the driver to report that it found none
+  wm.setConnectTimeout(2);
+  wm.setConfigPortalTimeout(1);
+
+  CHECK(!wm.autoConnect());
+  CHECK(!wm.autoConnect());
+
+  CHECK_EQ(wm.getConnectLogCount(), WIFI_MANAGER_CONNECT_LOG_SIZE);
+  WiFiManagerConnectRecord newer = attempt(wm, 0);
+  for (int i = 1; i < WIFI_MANAGER_CONNECT_LOG_SIZE; i++) {
+    WiFiManagerConnectRecord record = attempt(wm, i);
+    CHECK(record.start < newer.start);
+    CHECK_EQ(record.end, 2000);
+    CHECK_EQ(record.reason, WIFI_REASON_NO_AP_FOUND);
+    newer = record;
+  }
+  WiFiManagerConnectRecord record;
+  CHECK(!wm.getConnectLog(WIFI_MANAGER_CONNECT_LOG_SIZE, &record));
+}
+
+TEST(infoPageShowsTheLog) {
+  host::addNetwork("office", "secret");
+  WiFiManager wm;
+  setUp(wm);
+  wm.addNetwork("office", "secret");
+  wm.addNetwork("home", "secret");
+  CHECK(wm.autoConnect());
+  WiFiManagerConnectRecord record = attempt(wm, 0);
+
+  wm.beginConfigPortal();
+  host::advance(1000);
+  wm.processConfigPortal();
+  std::string body = host::get("/i").body;
+  wm.stopConfigPortal();
+
+  std::string row = "<tr><td>" + std::to_string(record.boot) +
+                    "</td><td>0</td><td>fast</td><td>" +
+                    std::to_string(record.scan) + "</td><td>" +
+                    std::to_string(record.connected) + "</td><td>" +
+                    std::to_string(record.gotIp) + "</td><td>" +
+                    std::to_string(record.end) + "</td><td>3</td><td>0</td>" +
+                    "</tr></table>";
+  CHECK(body.find("<h4>Connect log</h4>") != std::string::npos);
+  CHECK(body.find(row) != std::string::npos);
+}
@@ -0,0 +1,199 @@
+// The captive DNS responder of the portal, replaying the burst of lookups a
+// phone makes when it joins the AP: connectivity checks, push and time
+// servers, each as A and AAAA. The whole burst must be answered in one call of
+// processConfigPortal(), A queries with the portal's address, the rest with an
+// empty answer, and without the library allocating. The receive buffer that
+// WiFiUDP::parsePacket() of the core allocates per packet on the device is
+// not counted; see host.h.
+
+#include <WiFiManager-esp32.h>
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+const uint16_t TYPE_A = 1;
+const uint16_t TYPE_AAAA = 28;
+const uint16_t TYPE_HTTPS = 65;
+
+std::vector<uint8_t> query(uint16_t id, const char *name, uint16_t type) {
+  std::vector<uint8_t> packet = {
+      (uint8_t)(id >> 8), (uint8_t)id,
+      0x01, 0x00,  // standard query, recursion desired
+      0x00, 0x01,  // one question
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  };
+  const char *label = name;
+  while (*label) {
+    const char *dot = strchr(label, '.');
+    size_t length = dot ? dot - label : strlen(label);
+    packet.push_back(length);
+    packet.insert(packet.end(), label, label + length);
+    label += length + (dot ? 1 : 0);
+  }
+  packet.push_back(0);
+  packet.push_back(type >> 8);
+  packet.push_back(type);
+  packet.push_back(0x00);
+  packet.push_back(0x01);  // class IN
+  return packet;
+}
+
+// a phone joining the AP
+std::vector<std::vector<uint8_t>> joinBurst() {
+  const char *names[] = {
+      "connectivitycheck.gstatic.com", "www.google.com",
+      "captive.apple.com",             "mtalk.google.com",
+      "time.android.com",              "www.msftconnecttest.com",
+      "clients3.google.com",           "play.googleapis.com",
+      "android.clients.google.com",    "detectportal.firefox.com",
+  };
+  std::vector<std::vector<uint8_t>> burst;
+  uint16_t id = 0x1000;
+  for (const char *name : names) {
+    burst.push_back(query(id++, name, TYPE_A));
+    burst.push_back(query(id++, name, TYPE_AAAA));
+  }
+  return burst;
+}
+
+uint16_t read16(const std::vector<uint8_t> &packet, size_t offset) {
+  return packet[offset] << 8 | packet[offset + 1];
+}
+
+struct Portal {
+  WiFiManager wm;
+
+  Portal() {
+    wm.setDebugOutput(false);
+    wm.configure("dns", nullptr);
+    wm.beginConfigPortal();
+    // the DNS server starts once the AP has settled
+    for (int i = 0; i < 600; i++) {
+      wm.processConfigPortal();
+      host::advance(1);
+    }
+  }
+};
+
+}  // namespace
+
+TEST(wholeBurstIsAnsweredInOneCall) {
+  Portal portal;
+  std::vector<std::vector<uint8_t>> burst = joinBurst();
+  for (const std::vector<uint8_t> &packet : burst) {
+    host::sendPacket(53, packet);
+  }
+
+  uint32_t before = portal.wm.getMetrics().dnsQueries;
+  unsigned long allocations = host::heapStats().allocations;
+  portal.wm.processConfigPortal();
+
+  CHECK_EQ(host::heapStats().allocations, allocations);
+  CHECK_EQ(portal.wm.getMetrics().dnsQueries - before, burst.size());
+  std::vector<std::vector<uint8_t>> answers = host::receivePackets();
+  CHECK_EQ(answers.size(), burst.size());
+  for (size_t i = 0; i < answers.size() && i < burst.size(); i++) {
+    const std::vector<uint8_t> &q = burst[i];
+    const std::vector<uint8_t> &a = answers[i];
+    CHECK(a.size() >= q.size());
+    CHECK_EQ(read16(a, 0), read16(q, 0));  // ID
+    CHECK_EQ(a[2], 0x85);  // response, authoritative, recursion desired
+    CHECK_EQ(a[3], 0x00);  // no error
+    CHECK_EQ(read16(a, 4), 1);  // the question, as it was asked
+    CHECK(std::equal(q.begin() + 12, q.end(), a.begin() + 12));
+    CHECK_EQ(read16(a, 8), 0);
+    CHECK_EQ(read16(a, 10), 0);
+  }
+}
+
+TEST(aQueriesPointAtThePortal) {
+  Portal portal;
+  std::vector<uint8_t> q = query(0xbeef, "captive.apple.com", TYPE_A);
+  host::sendPacket(53, q, IPAddress(192, 168, 4, 3), 40000);
+  portal.wm.processConfigPortal();
+
+  CHECK(host::receivePackets().empty());
+  std::vector<std::vector<uint8_t>> answers = host::receivePackets(40000);
+  CHECK_EQ(answers.size(), 1u);
+  if (answers.size() != 1) {
+    return;
+  }
+  const std::vector<uint8_t> &a = answers[0];
+  CHECK_EQ(read16(a, 6), 1);  // one answer
+  CHECK_EQ(a.size(), q.size() + 16);
+  size_t answer = q.size();
+  CHECK_EQ(read16(a, answer), 0xc00c);  // the name of the question
+  CHECK_EQ(read16(a, answer + 2), TYPE_A);
+  CHECK_EQ(read16(a, answer + 4), 1);  // IN
+  CHECK_EQ(read16(a, answer + 8), 60);  // TTL
+  CHECK_EQ(read16(a, answer + 10), 4);
+  CHECK_EQ(IPAddress(a[answer + 12], a[answer + 13], a[answer + 14],
+                     a[answer + 15]),
+           WiFi.softAPIP());
+}
+
+TEST(otherTypesGetAnEmptyAnswer) {
+  Portal portal;
+  // no error and no records: the client stops asking, and does not retry
+  // as it would after a timeout
+  for (uint16_t type : {TYPE_AAAA, TYPE_HTTPS}) {
+    std::vector<uint8_t> q = query(0x4242, "www.google.com", type);
+    host::sendPacket(53, q);
+    portal.wm.processConfigPortal();
+
+    std::vector<std::vector<uint8_t>> answers = host::receivePackets();
+    CHECK_EQ(answers.size(), 1u);
+    if (answers.size() != 1) {
+      continue;
+    }
+    CHECK_EQ(answers[0].size(), q.size());
+    CHECK_EQ(answers[0][3] & 0x0f, 0);
+    CHECK_EQ(read16(answers[0], 6), 0);
+  }
+}
+
+TEST(malformedPacketsAreDropped) {
+  Portal portal;
+  std::vector<uint8_t> response = query(1, "www.google.com", TYPE_A);
+  response[2] |= 0x80;
+  std::vector<uint8_t> twoQuestions = query(2, "www.google.com", TYPE_A);
+  twoQuestions[5] = 2;
+  std::vector<uint8_t> truncated = query(3, "www.google.com", TYPE_A);
+  truncated.resize(truncated.size() - 3);
+  std::vector<uint8_t> compressed = query(4, "www.google.com", TYPE_A);
+  compressed[12] = 0xc0;
+  std::vector<uint8_t> shortHeader = {0x00, 0x05, 0x01};
+
+  for (const std::vector<uint8_t> &packet :
+       {response, twoQuestions, truncated, compressed, shortHeader}) {
+    host::sendPacket(53, packet);
+  }
+  host::sendPacket(53, query(6, "www.google.com", TYPE_A));
+  portal.wm.processConfigPortal();
+
+  // only the good one behind them is answered
+  std::vector<std::vector<uint8_t>> answers = host::receivePackets();
+  CHECK_EQ(answers.size(), 1u);
+  if (answers.size() == 1) {
+    CHECK_EQ(read16(answers[0], 0), 6);
+  }
+}
+
+TEST(longerBurstsAreSpreadOverCalls) {
+  Portal portal;
+  const int queries = WIFI_MANAGER_DNS_BURST + 8;
+  for (int i = 0; i < queries; i++) {
+    host::sendPacket(53, query(i, "www.google.com", TYPE_A));
+  }
+
+  portal.wm.processConfigPortal();
+  CHECK_EQ(host::receivePackets().size(), (size_t)WIFI_MANAGER_DNS_BURST);
+  portal.wm.processConfigPortal();
+  CHECK_EQ(host::receivePackets().size(), 8u);
+}
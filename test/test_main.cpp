@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+struct TestCase {
+  const char *name;
+  test::TestFunction function;
+};
+
+std::vector<TestCase> &testCases() {
+  static std::vector<TestCase> cases;
+  return cases;
+}
+
+int failures = 0;
+
+std::string path(const char *name) {
+  const char *dir = getenv("WM_TEST_DIR");
+  return std::string(dir != NULL ? dir : ".") + "/" + name;
+}
+
+}  // namespace
+
+namespace test {
+
+Registrar::Registrar(const char *name, TestFunction function) {
+  testCases().push_back({name, function});
+}
+
+void fail(const char *file, int line, const std::string &message) {
+  fprintf(stderr, "%s:%d: %s\n", file, line, message.c_str());
+  failures++;
+}
+
+std::string show(const std::string &value) { return "\"" + value + "\""; }
+
+std::string show(const char *value) {
+  return value == NULL ? "NULL" : show(std::string(value));
+}
+
+std::string show(char *value) { return show((const char *)value); }
+
+std::string show(bool value) { return value ? "true" : "false"; }
+
+bool readFile(const char *name, std::string *contents) {
+  std::ifstream file(path(name), std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  *contents = buffer.str();
+  return true;
+}
+
+bool updateGoldens() { return getenv("WM_UPDATE_GOLDEN") != NULL; }
+
+void writeFile(const char *name, const std::string &contents) {
+  std::ofstream file(path(name), std::ios::binary);
+  file << contents;
+}
+
+}  // namespace test
+
+int main(int argc, char **argv) {
+  int failed = 0;
+  for (size_t i = 0; i < testCases().size(); i++) {
+    const TestCase &testCase = testCases()[i];
+    if (argc > 1 && std::string(argv[1]) != testCase.name) {
+      continue;
+    }
+    host::reset();
+    int before = failures;
+    testCase.function();
+    bool passed = failures == before;
+    printf("%s %s\n", passed ? "PASS" : "FAIL", testCase.name);
+    failed += passed ? 0 : 1;
+  }
+  printf("%d of %zu tests failed\n", failed, testCases().size());
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+// Known networks against simulated scans: autoConnect() scans once, goes
+// straight to the strongest AP of the best visible network, and only then
+// tries the hidden known networks the scan did not see. The others are not
+// around and are skipped.
+
+#include <WiFiManager-esp32.h>
+
+#include "test.h"
+
+namespace {
+
+void addAp(const char *ssid, const char *pass, uint8_t id, uint8_t channel,
+           int8_t rssi, bool hidden = false) {
+  host::AccessPoint ap;
+  ap.ssid = ssid;
+  ap.pass = pass;
+  const uint8_t bssid[6] = {0x02, 0, 0, 0, 0, id};
+  memcpy(ap.bssid, bssid, 6);
+  ap.channel = channel;
+  ap.rssi = rssi;
+  ap.hidden = hidden;
+  host::addAccessPoint(ap);
+}
+
+void setUp(WiFiManager &wm) {
+  wm.setDebugOutput(false);
+  wm.configure("networks", nullptr);
+  wm.clearConnectLog();
+  wm.setConnectTimeout(5);
+}
+
+std::string ssid(WiFiManager &wm) { return wm.getSSIDCStr(); }
+
+}  // namespace
+
+TEST(bestVisibleNetworkIsTriedFirst) {
+  addAp("warehouse", "secret", 1, 1, -80);
+  addAp("office", "secret", 2, 6, -60);
+  WiFiManager wm;
+  setUp(wm);
+  wm.addNetwork("warehouse", "secret", 1);
+  wm.addNetwork("office", "secret", 0);
+  wm.addNetwork("home", "secret", 2);  // not around
+
+  CHECK(wm.autoConnect());
+
+  // priority first, among the visible ones; the absent one is not waited for
+  CHECK_EQ(ssid(wm), "warehouse");
+  CHECK_EQ(host::getScanCount(), 1);
+  CHECK_EQ(host::getConnectRequests().size(), 1u);
+  const host::ConnectRequest &request = host::getConnectRequests()[0];
+  CHECK_EQ(request.ssid, "warehouse");
+  CHECK(request.directed);
+  CHECK_EQ(request.channel, 1);
+}
+
+TEST(strongestAPOfANetworkIsUsed) {
+  addAp("warehouse", "secret", 1, 1, -80);
+  addAp("warehouse", "secret", 2, 11, -55);
+  addAp("warehouse", "secret", 3, 6, -70);
+  WiFiManager wm;
+  setUp(wm);
+  wm.addNetwork("warehouse", "secret");
+  wm.addNetwork("office", "secret");
+
+  CHECK(wm.autoConnect());
+
+  const host::ConnectRequest &request = host::getConnectRequests()[0];
+  CHECK(request.directed);
+  CHECK_EQ(request.bssid[5], 2);
+  CHECK_EQ(request.channel, 11);
+
+  // remembered for the next connect
+  WiFiManagerNetwork network;
+  CHECK(wm.getNetwork(0, &network));
+  CHECK_EQ(std::string(network.ssid), "warehouse");
+  CHECK_EQ(network.channel, 11);
+  CHECK_EQ(network.bssid[5], 2);
+  CHECK(network.lastSuccess > 0);
+}
+
+TEST(equalPriorityGoesToTheLastSuccessfulNetwork) {
+  addAp("warehouse", "secret", 1, 1, -50);
+  addAp("office", "secret", 2, 6, -80);
+  {
+    WiFiManager wm;
+    setUp(wm);
+    wm.addNetwork("office", "secret");
+    CHECK(wm.autoConnect());
+    wm.addNetwork("warehouse", "secret");
+  }
+  WiFi.disconnect(true);
+
+  WiFiManager wm;
+  setUp(wm);
+  CHECK(wm.autoConnect());
+
+  // the weaker AP, but the one that worked before
+  CHECK_EQ(ssid(wm), "office");
+}
+
+TEST(hiddenNetworksAreTriedAfterTheVisibleOnes) {
+  addAp("office", "secret", 1, 6, -60);
+  addAp("lab", "secret", 2, 11, -70, true);  // hidden
+  WiFiManager wm;
+  setUp(wm);
+  wm.addNetwork("office", "changed", 1);
+  wm.addNetwork("lab", "secret", 0, true);
+
+  CHECK(wm.autoConnect());
+
+  CHECK_EQ(ssid(wm), "lab");
+  CHECK_EQ(host::getScanCount(), 1);
+  const std::vector<host::ConnectRequest> &requests =
+      host::getConnectRequests();
+  CHECK(requests.size() >= 2u);
+  // office first, directed, with the wrong password; then lab, which the
+  // driver has to look for on all channels
+  CHECK_EQ(requests.front().ssid, "office");
+  CHECK(requests.front().directed);
+  CHECK_EQ(requests.back().ssid, "lab");
+  CHECK(!requests.back().directed);
+  CHECK_EQ(requests.back().channel, 0);
+
+  WiFiManagerNetwork office;
+  CHECK(wm.getNetwork(0, &office));
+  CHECK_EQ(std::string(office.ssid), "office");
+  CHECK_EQ(office.failures, 1);
+}
+
+TEST(noKnownNetworkAroundStartsThePortal) {
+  addAp("somebody-else", "secret", 1, 1, -40);
+  const host::RadioTiming &timing = host::radioTiming();
+  WiFiManager wm;
+  setUp(wm);
+  const char *ssids[] = {"office", "lab", "warehouse", "home", "shop"};
+  for (const char *ssid : ssids) {
+    wm.addNetwork(ssid, "secret");
+  }
+  static unsigned long portalStart;
+  portalStart = 0;
+  wm.setAPCallback([](WiFiManager *) { portalStart = millis(); });
+
+  CHECK(!wm.autoConnect());
+
+  // the portal right after the scan, without waiting for any timeout
+  CHECK_EQ(host::getConnectRequests().size(), 0u);
+  CHECK_EQ(wm.getConnectLogCount(), 0);
+  CHECK(portalStart > 0);
+  CHECK(portalStart < 13 * timing.scanChannel + 100);
+}
+
+TEST(hiddenNetworkGetsOneShortAttempt) {
+  WiFiManager wm;
+  setUp(wm);
+  wm.addNetwork("office", "secret");
+  wm.addNetwork("lab", "secret", 0, true);
+  wm.setConnectTimeout(30);
+
+  CHECK(!wm.autoConnect());
+
+  CHECK_EQ(host::getConnectRequests().size(), 1u);
+  CHECK_EQ(host::getConnectRequests()[0].ssid, "lab");
+  CHECK_EQ(wm.getConnectLogCount(), 1);
+  WiFiManagerConnectRecord record;
+  CHECK(wm.getConnectLog(0, &record));
+  CHECK_EQ(record.end, WIFI_MANAGER_HIDDEN_CONNECT_TIMEOUT);
+}
+
+TEST(networkTypedInThePortalIsHidden) {
+  addAp("office", "secret", 1, 6, -60);
+  WiFiManager wm;
+  setUp(wm);
+  wm.beginConfigPortal();
+  for (int i = 0; i < 3000; i++) {
+    wm.processConfigPortal();
+    host::advance(1);
+  }
+
+  // one from the list, one typed in
+  host::post("/wifisave", "s=office&p=secret");
+  host::post("/wifisave", "s=lab&p=secret");
+  wm.stopConfigPortal();
+
+  WiFiManagerNetwork network;
+  CHECK(wm.getNetwork(0, &network));
+  CHECK_EQ(std::string(network.ssid), "office");
+  CHECK_EQ(network.hidden, 0);
+  CHECK(wm.getNetwork(1, &network));
+  CHECK_EQ(std::string(network.ssid), "lab");
+  CHECK_EQ(network.hidden, 1);
+}
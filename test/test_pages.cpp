@@ -0,0 +1,262 @@
+// The portal pages, compared byte for byte with the goldens in pages/. Also
+// built with a page buffer of 17 bytes (test_pages_small_buffer), which must
+// stream the same bytes in many more chunks. Run with WM_UPDATE_GOLDEN set to
+// rewrite the goldens after an intended change of a page.
+//
+// The goldens of /, /wifi, /0wifi and /i are the pages of the library before
+// the page writer (baseline/render.sh), which never change: the changes made
+// to these pages since are listed with the request that made them, and
+// pagesAreTheBaselineWithTheListedChanges applies them.
+
+#include <WiFiManager-esp32.h>
+// after the header, which includes what the asset tables need
+#include <WiFiManager-esp32-assets.h>
+
+#include <string>
+
+#include "test.h"
+
+namespace {
+
+struct Page {
+  const char *uri;
+  const char *golden;  // NULL: a baseline page, see below
+  const char *form;    // POSTed if not NULL
+};
+
+const Page pages[] = {
+    {"/", NULL, NULL},
+    {"/wifi", NULL, NULL},
+    {"/0wifi", NULL, NULL},
+    {"/scan.json", "pages/scan.json", NULL},
+    {"/i", NULL, NULL},
+    {"/changename", "pages/changename.html", NULL},
+    {"/savename?n=not%20a%20name", "pages/savename-invalid.html", NULL},
+    {"/wifisave", "pages/wifisave.html",
+     "s=home&p=secret&server=broker.local&port=8883&token=&ip=192.168.1.50"
+     "&gw=192.168.1.1&sn=255.255.255.0"},
+    {"/r", "pages/reset.html", NULL},
+    {"/not-there", "pages/not-found.txt", NULL},
+};
+
+// a portal with parameters in a group, custom HTML, a static IP and a few
+// networks, two of them with characters that must be escaped
+struct Portal {
+  WiFiManager wm;
+  WiFiManagerParameter text{"<p>MQTT</p>"};
+  WiFiManagerParameter server{"server", "Server", "mqtt.local", 40};
+  WiFiManagerParameter port{"port", "Port", "1883", 6};
+  WiFiManagerParameter token{"token", "API token", "", 32,
+                             "type='password'"};
+
+  Portal() {
+    host::addNetwork("home", "secret", 2, -50);
+    host::addNetwork("office \"5G\"", "password", 1, -70);
+    host::addNetwork("cafe <free>", "", 1, -85);
+
+    wm.setDebugOutput(false);
+    wm.configure("pages", nullptr);
+    wm.clearConnectLog();
+    wm.addParameter(&text, "MQTT");
+    wm.addParameter(&server, "MQTT");
+    wm.addParameter(&port, "MQTT");
+    wm.addParameter(&token);
+    wm.setSTAStaticIPConfig(IPAddress(192, 168, 1, 50),
+                            IPAddress(192, 168, 1, 1),
+                            IPAddress(255, 255, 255, 0));
+    wm.beginConfigPortal();
+    // AP settled and first scan done
+    for (int i = 0; i < 3000; i++) {
+      wm.processConfigPortal();
+      host::advance(1);
+    }
+  }
+};
+
+host::Response fetch(const Page &page) {
+  if (page.form != NULL) {
+    return host::post(page.uri, page.form);
+  }
+  return host::get(page.uri);
+}
+
+std::string baseline(const char *golden) {
+  std::string page;
+  if (!test::readFile(golden, &page)) {
+    test::fail(__FILE__, __LINE__, std::string("no ") + golden);
+  }
+  return page;
+}
+
+// replaces every from in page; a change that no longer applies fails
+void change(std::string &page, const char *request, const std::string &from,
+            const std::string &to) {
+  size_t at = page.find(from);
+  if (at == std::string::npos) {
+    test::fail(__FILE__, __LINE__,
+               std::string(request) + ": not found: " + from);
+    return;
+  }
+  for (; at != std::string::npos; at = page.find(from, at + to.size())) {
+    page.replace(at, from.size(), to);
+  }
+}
+
+// the head of every page: the style and the script were inline
+void changeHead(std::string &page) {
+  // served as cached, compressed assets
+  change(page, "user-003", std::string(WM_HTTP_SCRIPT) + WM_HTTP_STYLE,
+         WM_HTTP_ASSETS);
+}
+
+// the pages of / and /0wifi: the list of networks and the form
+void changeNetworkPage(std::string &page) {
+  changeHead(page);
+  // lengths of two digits were cut to one, and the static IP fields showed
+  // the placeholder of the custom HTML
+  change(page, "user-002", "length=4 ", "length=40 ");
+  change(page, "user-002", "length=3 ", "length=32 ");
+  change(page, "user-002", "' {c}>", "' >");
+  // the list is rendered by the script from /scan.json; the names are
+  // escaped there
+  change(page, "user-010",
+         "Found the following networks:"
+         "<div><a href='#p' onclick='c(this)'>home</a>&nbsp;"
+         "<span class='q l'>100%</span></div>"
+         "<div><a href='#p' onclick='c(this)'>office \"5G\"</a>&nbsp;"
+         "<span class='q l'>60%</span></div>"
+         "<div><a href='#p' onclick='c(this)'>cafe <free></a>&nbsp;"
+         "<span class='q '>30%</span></div><br/>",
+         "<div id='n' data-scan='0'>Scanning...</div>");
+  // parameters in groups, each with its heading
+  change(page, "user-016", "<br/><p>MQTT</p>", "<br/><h4>MQTT</h4><p>MQTT</p>");
+}
+
+}  // namespace
+
+TEST(pagesMatchGoldens) {
+  Portal portal;
+
+  for (const Page &page : pages) {
+    if (page.golden == NULL) {
+      continue;
+    }
+    host::Response response = fetch(page);
+    if (test::updateGoldens()) {
+      test::writeFile(page.golden, response.body);
+      continue;
+    }
+    std::string golden;
+    CHECK(test::readFile(page.golden, &golden));
+    CHECK_EQ(response.body, golden);
+  }
+}
+
+TEST(pagesAreTheBaselineWithTheListedChanges) {
+  Portal portal;
+
+  std::string root = baseline("pages/root.html");
+  changeNetworkPage(root);
+  CHECK_EQ(host::get("/").body, root);
+
+  std::string noScan = baseline("pages/0wifi.html");
+  changeNetworkPage(noScan);
+  CHECK_EQ(host::get("/0wifi").body, noScan);
+
+  // a page that waited for the scan it started, then went on to /0wifi
+  std::string wifi = baseline("pages/wifi.html");
+  changeHead(wifi);
+  // the page of /0wifi right away; the script starts the scan
+  change(wifi, "user-010", "<meta http-equiv=\"refresh\" content=\"1; "
+                           "url=/0wifi\" />", "");
+  change(wifi, "user-010",
+         "Scan busy. Please wait.<p>Click <a href=\"/0wifi\">here</a> if "
+         "this page does not refresh after 5 seconds.</p>",
+         noScan.substr(noScan.find("<div id='n'"),
+                       noScan.find("</div></body>") -
+                           noScan.find("<div id='n'")));
+  change(wifi, "user-010", "data-scan='0'", "data-scan='1'");
+  CHECK_EQ(host::get("/wifi").body, wifi);
+
+  std::string info = baseline("pages/info.html");
+  changeHead(info);
+  // the connect log, empty here
+  change(info, "user-019", "</dl>",
+         "</dl><h4>Connect log</h4><table><tr><th>Boot</th><th>Try</th>"
+         "<th>Path</th><th>Scan</th><th>Conn</th><th>IP</th><th>End</th>"
+         "<th>Result</th><th>Reason</th></tr></table>");
+  CHECK_EQ(host::get("/i").body, info);
+}
+
+TEST(pagesAreStreamedThroughTheBuffer) {
+  Portal portal;
+
+  for (const Page &page : pages) {
+    host::Response response = fetch(page);
+    if (!response.chunked) {
+      continue;
+    }
+    // the chunk sizes only depend on the buffer; none is larger
+    for (size_t size : response.chunks) {
+      CHECK(size <= WIFI_MANAGER_PAGE_BUFFER_SIZE);
+    }
+    CHECK(response.chunks.size() >=
+          response.body.size() / WIFI_MANAGER_PAGE_BUFFER_SIZE);
+  }
+}
+
+TEST(cachedPagesMatchRenderedPages) {
+  Portal portal;
+
+  for (const char *uri : {"/wifi", "/0wifi", "/i"}) {
+    host::Response rendered = host::get(uri);
+    host::Response cached = host::get(uri);
+    CHECK(rendered.chunked);
+    CHECK(!cached.chunked);
+    CHECK_EQ(cached.header("Content-Length"),
+             std::to_string(rendered.body.size()));
+    CHECK_EQ(cached.body, rendered.body);
+  }
+  CHECK_EQ(portal.wm.getMetrics().pageCacheHits, 3u);
+}
+
+TEST(cachedPagesFollowTheHostname) {
+  Portal portal;
+  host::get("/wifi");
+  CHECK(host::get("/wifi").body.find("<h1>pages-") != std::string::npos);
+
+  portal.wm.appendMacToHostname(false);
+  CHECK(host::get("/wifi").body.find("<h1>pages</h1>") != std::string::npos);
+
+  portal.wm.setDefaultHostname("renamed");
+  portal.wm.resetSettings();
+  CHECK(host::get("/wifi").body.find("<h1>renamed</h1>") != std::string::npos);
+}
+
+TEST(peakHeapDoesNotGrowWithThePage) {
+  Portal portal;
+  // too little heap left for the page cache, so pages are rendered each time
+  host::setHeapSize(host::heapStats().inUse + 16 * 1024);
+
+  host::resetHeapPeak();
+  size_t small = host::get("/wifi").body.size();
+  size_t smallPeak = host::heapStats().peak - host::heapStats().inUse;
+
+  char ids[40][8];
+  WiFiManagerParameter *params[40];
+  for (int i = 0; i < 40; i++) {
+    snprintf(ids[i], sizeof(ids[i]), "x%d", i);
+    params[i] = new WiFiManagerParameter(ids[i], ids[i], "some value", 32);
+    portal.wm.addParameter(params[i]);
+  }
+  host::resetHeapPeak();
+  size_t large = host::get("/wifi").body.size();
+  size_t largePeak = host::heapStats().peak - host::heapStats().inUse;
+
+  CHECK(large > 3 * small);
+  CHECK_EQ(largePeak, smallPeak);
+  CHECK_EQ(largePeak, 0u);
+  for (int i = 0; i < 40; i++) {
+    delete params[i];
+  }
+}
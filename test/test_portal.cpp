@@ -0,0 +1,213 @@
+// The non-blocking portal on the simulated clock: no call of
+// processConfigPortal() may wait, whatever phase the portal is in, and the
+// delays of the blocking portal (AP settle, connect, reset) are kept as timers.
+
+#include <WiFiManager-esp32.h>
+
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+// the longest a single processConfigPortal() call may take on the device
+// clock; the library must not wait for the radio or call delay()
+const unsigned long MAX_CALL_MS = 0;
+
+struct Run {
+  WiFiManager::PortalResult result = WiFiManager::PORTAL_RUNNING;
+  unsigned long calls = 0;
+  unsigned long maxCallMs = 0;
+};
+
+// calls processConfigPortal() once per ms of the clock, for ms or until the
+// portal stops
+Run run(WiFiManager &wm, unsigned long ms, Run run = Run()) {
+  for (unsigned long i = 0; i < ms; i++) {
+    unsigned long start = millis();
+    run.result = wm.processConfigPortal();
+    run.calls++;
+    run.maxCallMs = std::max(run.maxCallMs, millis() - start);
+    if (run.result != WiFiManager::PORTAL_RUNNING) {
+      break;
+    }
+    host::advance(1);
+  }
+  return run;
+}
+
+void setUp(WiFiManager &wm) {
+  wm.setDebugOutput(false);
+  wm.configure("portal", nullptr);
+  wm.clearConnectLog();
+}
+
+host::Response getAsset(const char *uri, const std::string &ifNoneMatch) {
+  host::Request request;
+  request.uri = uri;
+  request.headers["If-None-Match"] = ifNoneMatch;
+  return host::request(request);
+}
+
+}  // namespace
+
+TEST(portalIsUpAfterTheAPHasSettled) {
+  host::addNetwork("home", "secret");
+  WiFiManager wm;
+  setUp(wm);
+
+  wm.beginConfigPortal();
+  CHECK_EQ(millis(), 0ul);
+  Run r = run(wm, 499);
+  CHECK_EQ(wm.getTimeToPortal(), 0ul);
+  r = run(wm, 2, r);
+  CHECK_EQ(wm.getTimeToPortal(), 500ul);
+  CHECK_EQ(host::get("/").code, 200);
+  CHECK(r.maxCallMs <= MAX_CALL_MS);
+  wm.stopConfigPortal();
+}
+
+TEST(savedNetworkIsConnectedAfterTheConnectDelay) {
+  host::addNetwork("home", "secret");
+  WiFiManager wm;
+  setUp(wm);
+
+  wm.beginConfigPortal();
+  Run r = run(wm, 3000);
+  unsigned long saved = millis();
+  CHECK_EQ(host::post("/wifisave", "s=home&p=secret").code, 200);
+  r = run(wm, 10000, r);
+
+  CHECK_EQ(r.result, WiFiManager::PORTAL_CONNECTED);
+  CHECK(r.maxCallMs <= MAX_CALL_MS);
+  // the save page goes out before the radio is taken away
+  CHECK(!host::getConnectRequests().empty());
+  CHECK(host::getConnectRequests().back().time >= saved + 2000);
+  CHECK_EQ(WiFi.status(), WL_CONNECTED);
+  CHECK_EQ(std::string(wm.getSSIDCStr()), "home");
+  // the driver's scan of all 13 channels, associate and DHCP, with nothing
+  // waited on top
+  const host::RadioTiming &timing = host::radioTiming();
+  CHECK_EQ(millis() - host::getConnectRequests().back().time,
+           13 * timing.scanChannel + timing.associate + timing.dhcp);
+}
+
+TEST(portalKeepsServingWhileConnecting) {
+  host::addNetwork("home", "secret");
+  WiFiManager wm;
+  setUp(wm);
+
+  wm.beginConfigPortal();
+  Run r = run(wm, 3000);
+  host::post("/wifisave", "s=home&p=wrong");
+  r = run(wm, 2100, r);
+  // connecting; pages are still answered in between
+  for (int i = 0; i < 10; i++) {
+    CHECK_EQ(host::get("/i").code, 200);
+    r = run(wm, 100, r);
+  }
+  r = run(wm, 30000, r);
+
+  CHECK_EQ(r.result, WiFiManager::PORTAL_RUNNING);
+  CHECK(r.maxCallMs <= MAX_CALL_MS);
+  CHECK(WiFi.status() != WL_CONNECTED);
+  CHECK_EQ(host::get("/").code, 200);
+  wm.stopConfigPortal();
+}
+
+TEST(resetRestartsAfterTheResetDelay) {
+  WiFiManager wm;
+  setUp(wm);
+
+  wm.beginConfigPortal();
+  Run r = run(wm, 1000);
+  unsigned long requested = millis();
+  CHECK_EQ(host::get("/r").code, 200);
+  r = run(wm, 4999, r);
+  CHECK_EQ(host::getRestartCount(), 0);
+  unsigned long restarted = 0;
+  while (restarted == 0 && millis() < requested + 6000) {
+    r = run(wm, 1, r);
+    if (host::getRestartCount() > 0) {
+      restarted = millis() - 1;  // run() has advanced the clock past the call
+    }
+  }
+
+  CHECK_EQ(host::getRestartCount(), 1);
+  CHECK_EQ(restarted - requested, 5000ul);
+  CHECK(r.maxCallMs <= MAX_CALL_MS);
+  wm.stopConfigPortal();
+}
+
+TEST(portalTimesOut) {
+  WiFiManager wm;
+  setUp(wm);
+  wm.setConfigPortalTimeout(60);
+
+  wm.beginConfigPortal();
+  Run r = run(wm, 120000);
+
+  CHECK_EQ(r.result, WiFiManager::PORTAL_TIMEOUT);
+  CHECK_EQ(millis(), 60001ul);
+  CHECK(r.maxCallMs <= MAX_CALL_MS);
+  CHECK_EQ(wm.processConfigPortal(), WiFiManager::PORTAL_IDLE);
+  CHECK_EQ(host::get("/").code, 0);
+}
+
+TEST(blockingPortalIsBuiltOnTheNonBlockingOne) {
+  WiFiManager wm;
+  setUp(wm);
+  wm.setConfigPortalTimeout(60);
+
+  // yield() is the only wait of the loop; 1 ms on the simulated clock
+  CHECK(!wm.startConfigPortal());
+  CHECK_EQ(millis(), 60001ul);
+}
+
+TEST(captivePortalChecksAreAlwaysRedirected) {
+  WiFiManager wm;
+  setUp(wm);
+  wm.beginConfigPortal();
+  run(wm, 1000);
+
+  // a phone syncing its apps in the background, then checking for a portal
+  // many times in the same second: each check must get the redirect, or the
+  // OS decides there is no captive portal
+  for (int i = 0; i < 20; i++) {
+    CHECK_EQ(host::get("/sync", "push.example.com").code, 302);
+  }
+  for (const char *uri : {"/generate_204", "/hotspot-detect.html"}) {
+    for (int i = 0; i < 10; i++) {
+      host::Response response = host::get(uri, "connectivitycheck.gstatic.com");
+      CHECK_EQ(response.code, 302);
+      CHECK_EQ(response.header("location"), "http://192.168.4.1");
+    }
+  }
+  wm.stopConfigPortal();
+}
+
+TEST(assetsAreNotSentAgainForAKnownETag) {
+  WiFiManager wm;
+  setUp(wm);
+  wm.beginConfigPortal();
+  run(wm, 1000);
+
+  std::string etag = host::get("/wm.js").header("etag");
+  CHECK(etag.size() > 2);
+  // as browsers and proxies send it: the cached ETag alone, in a list, or
+  // marked weak after recompressing the response
+  std::vector<std::string> known = {
+      etag, "\"other\", " + etag, "\"other\"," + etag + " ,\"more\"",
+      "W/" + etag, "*"};
+  std::vector<std::string> unknown = {
+      "\"other\"", "W/\"other\", \"more\"",
+      etag.substr(0, etag.size() - 2) + "\"", ""};
+  for (const std::string &header : known) {
+    CHECK_EQ(getAsset("/wm.js", header).code, 304);
+  }
+  for (const std::string &header : unknown) {
+    CHECK_EQ(getAsset("/wm.js", header).code, 200);
+  }
+  wm.stopConfigPortal();
+}
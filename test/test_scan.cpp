@@ -0,0 +1,93 @@
+// The list of networks the portal shows, from scans of many APs: APs of the
+// same SSID are merged while the results are collected, so the
+// WIFI_MANAGER_MAX_SCAN_RESULTS entries hold the strongest networks, each
+// with its strongest AP, whatever order the driver reports them in.
+
+#include <WiFiManager-esp32.h>
+
+#include <stdio.h>
+
+#include <string>
+
+#include "test.h"
+
+namespace {
+
+// networks SSIDs with apsPerNetwork APs each, reported network by network
+// with the strongest AP last. Network k is at -30 - k / 2 dBm at best
+void addAccessPoints(int networks, int apsPerNetwork) {
+  int id = 0;
+  for (int k = 0; k < networks; k++) {
+    for (int i = apsPerNetwork - 1; i >= 0; i--) {
+      host::AccessPoint ap;
+      char ssid[16];
+      snprintf(ssid, sizeof(ssid), "net-%03d", k);
+      ap.ssid = ssid;
+      ap.pass = "secret";
+      const uint8_t bssid[6] = {0x02, 0, 0, 0, (uint8_t)(id >> 8),
+                                (uint8_t)id};
+      memcpy(ap.bssid, bssid, 6);
+      ap.channel = 1 + (k + i) % 13;
+      ap.rssi = -30 - k / 2 - 5 * i;
+      ap.hidden = false;
+      host::addAccessPoint(ap);
+      id++;
+    }
+  }
+}
+
+std::string scanJSON() {
+  WiFiManager wm;
+  wm.setDebugOutput(false);
+  wm.configure("scan", nullptr);
+  wm.beginConfigPortal();
+  for (int i = 0; i < 5000; i++) {
+    wm.processConfigPortal();
+    host::advance(1);
+  }
+  std::string json = host::get("/scan.json").body;
+  wm.stopConfigPortal();
+  return json;
+}
+
+size_t count(const std::string &text, const std::string &part) {
+  size_t n = 0;
+  for (size_t i = text.find(part); i != std::string::npos;
+       i = text.find(part, i + 1)) {
+    n++;
+  }
+  return n;
+}
+
+// the entry of network k with its strongest AP
+std::string entry(int k) {
+  char text[64];
+  snprintf(text, sizeof(text), "{\"ssid\":\"net-%03d\",\"rssi\":%d,", k,
+           -30 - k / 2);
+  return text;
+}
+
+}  // namespace
+
+TEST(everyNetworkOfAFewAPsIsListed) {
+  addAccessPoints(10, 4);
+  std::string json = scanJSON();
+
+  CHECK_EQ(count(json, "{\"ssid\":"), 10u);
+  for (int k = 0; k < 10; k++) {
+    CHECK_EQ(count(json, entry(k)), 1u);
+  }
+}
+
+TEST(manyAPsListTheStrongestNetworks) {
+  // 500 APs: far more than fit, but only 125 networks
+  addAccessPoints(125, 4);
+  std::string json = scanJSON();
+
+  CHECK_EQ(count(json, "{\"ssid\":"), (size_t)WIFI_MANAGER_MAX_SCAN_RESULTS);
+  for (int k = 0; k < WIFI_MANAGER_MAX_SCAN_RESULTS; k++) {
+    if (count(json, entry(k)) != 1) {
+      test::fail(__FILE__, __LINE__, "missing " + entry(k));
+    }
+  }
+}